@@ -3,20 +3,167 @@
 //
 
 #include "buffer.h"
+#include "buffer_pool.h"
 #include <sys/uio.h>
 #include <assert.h>
 #include <errno.h>
 #include <unistd.h>
+#include <algorithm>
 /*
  * Buffer应该提供的两个最重要的功能:
  * 1. 从sockfd中读
  * 2. 向sockfd中写
  */
 const size_t Buffer::kInitialSize;
+std::atomic<size_t> Buffer::total_bytes_{0};
+std::atomic<size_t> Buffer::max_idle_capacity_{64 * 1024};
+std::atomic<size_t> Buffer::shrink_rounds_{16};
 
-Buffer::Buffer(size_t initial_size) :buffer_(initial_size),
+Buffer::Buffer(size_t initial_size) :buffer_(nullptr),
+                                    capacity_(0),
                                     read_pos_(0),
-                                    write_pos_(0) {
+                                    write_pos_(0),
+                                    high_water_(0),
+                                    drained_rounds_(0),
+                                    lazy_(initial_size == 0) {
+    reallocate(initial_size);
+}
+
+Buffer::Buffer(const Buffer &other) :buffer_(nullptr),
+                                     capacity_(0),
+                                     read_pos_(0),
+                                     write_pos_(0),
+                                     high_water_(other.high_water_),
+                                     drained_rounds_(0),
+                                     lazy_(other.lazy_) {
+    reallocate(lazy_ ? 0 : other.capacity_);
+    *this = other;
+}
+
+// 移动后存储归新对象所有, 总字节数不变, 原对象为空
+Buffer::Buffer(Buffer &&other) noexcept :buffer_(other.buffer_),
+                                          capacity_(other.capacity_),
+                                          read_pos_(other.read_pos_),
+                                          write_pos_(other.write_pos_),
+                                          high_water_(other.high_water_),
+                                          drained_rounds_(other.drained_rounds_),
+                                          lazy_(other.lazy_) {
+    other.buffer_ = nullptr;
+    other.capacity_ = 0;
+    other.read_pos_ = other.write_pos_ = other.high_water_ = other.drained_rounds_ = 0;
+}
+
+Buffer &Buffer::operator=(const Buffer &other) {
+    if (this != &other) {
+        // 只复制可读数据
+        read_pos_ = write_pos_ = 0;
+        size_t readable = other.readableBytes();
+        if (readable > capacity_) {
+            reallocate(roundCapacity(readable));
+        }
+        std::copy(other.peek(), other.peek() + readable, begin());
+        write_pos_ = readable;
+        high_water_ = other.high_water_;
+        drained_rounds_ = 0;
+        lazy_ = other.lazy_;
+    }
+    return *this;
+}
+
+Buffer &Buffer::operator=(Buffer &&other) noexcept {
+    if (this != &other) {
+        read_pos_ = write_pos_ = 0;
+        reallocate(0);
+        std::swap(buffer_, other.buffer_);
+        std::swap(capacity_, other.capacity_);
+        read_pos_ = other.read_pos_;
+        write_pos_ = other.write_pos_;
+        high_water_ = other.high_water_;
+        drained_rounds_ = other.drained_rounds_;
+        lazy_ = other.lazy_;
+        other.read_pos_ = other.write_pos_ = other.high_water_ = other.drained_rounds_ = 0;
+    }
+    return *this;
+}
+
+Buffer::~Buffer() {
+    read_pos_ = write_pos_ = 0;
+    reallocate(0);
+}
+
+void Buffer::setShrinkPolicy(size_t max_idle_capacity, size_t shrink_rounds) {
+    max_idle_capacity_ = max_idle_capacity;
+    shrink_rounds_ = shrink_rounds;
+}
+
+size_t Buffer::roundCapacity(size_t size) {
+    static const size_t LARGE_CLASS = 64 * 1024;
+    if (size <= kInitialSize) {
+        return kInitialSize;
+    }
+    size_t chunk = BufferPool::chunkSize(size);
+    if (chunk > 0) {
+        return chunk;
+    }
+    return (size + LARGE_CLASS - 1) / LARGE_CLASS * LARGE_CLASS;
+}
+
+void Buffer::reallocate(size_t capacity) {
+    size_t readable = readableBytes();
+    assert(readable <= capacity);
+    // 4KB/16KB/64KB的存储从BufferPool取得, 收缩或释放时还给池
+    char *buffer = capacity > 0 ? BufferPool::getInstance()->allocate(capacity) : nullptr;
+    std::copy(begin() + read_pos_, begin() + write_pos_, buffer);
+    BufferPool::getInstance()->deallocate(buffer_, capacity_);
+    total_bytes_.fetch_add(capacity, std::memory_order_relaxed);
+    total_bytes_.fetch_sub(capacity_, std::memory_order_relaxed);
+    buffer_ = buffer;
+    capacity_ = capacity;
+    read_pos_ = 0;
+    write_pos_ = readable;
+}
+
+void Buffer::shrink() {
+    // 按需借用存储的Buffer没有数据时不持有任何存储
+    size_t capacity = lazy_ && readableBytes() == 0 ? 0 : roundCapacity(readableBytes());
+    if (capacity < capacity_) {
+        reallocate(capacity);
+    }
+    high_water_ = readableBytes();
+    drained_rounds_ = 0;
+}
+
+void Buffer::onDrained() {
+    size_t capacity = capacity_;
+    if (lazy_) {
+        // 数据取完立即归还, 空闲的连接不占用缓冲区
+        reallocate(0);
+        high_water_ = 0;
+        return;
+    }
+    if (capacity <= kInitialSize) {
+        high_water_ = 0;
+        drained_rounds_ = 0;
+        return;
+    }
+    // 一次大请求之后, 长连接不会一直持有大块内存
+    size_t max_idle = max_idle_capacity_.load(std::memory_order_relaxed);
+    if (max_idle > 0 && capacity > max_idle) {
+        reallocate(std::min(roundCapacity(high_water_), roundCapacity(max_idle)));
+        high_water_ = 0;
+        drained_rounds_ = 0;
+        return;
+    }
+    // 一定次数内使用量都远小于容量, 缩小到使用量
+    size_t rounds = shrink_rounds_.load(std::memory_order_relaxed);
+    if (rounds == 0 || ++drained_rounds_ < rounds) {
+        return;
+    }
+    if (high_water_ < capacity / 4) {
+        reallocate(roundCapacity(high_water_));
+    }
+    high_water_ = 0;
+    drained_rounds_ = 0;
 }
 // 可读的数据量
 size_t Buffer::readableBytes() const {
@@ -24,7 +171,7 @@ size_t Buffer::readableBytes() const {
 }
 // 还能写入的数据量
 size_t Buffer::writableBytes() const {
-    return buffer_.size() - write_pos_;
+    return capacity_ - write_pos_;
 }
 // 预留空间, 已经读过的数据就没用了
 size_t Buffer::prependableBytes() const {
@@ -62,6 +209,7 @@ void Buffer::retrieveUntil(const char *end) {
 void Buffer::retrieveAll() {
     read_pos_ = 0;
     write_pos_ = 0;
+    onDrained();
 }
 
 std::string Buffer::retrieveAllAsString() {
@@ -71,13 +219,13 @@ std::string Buffer::retrieveAllAsString() {
 }
 
 void Buffer::append(const char *str, size_t len) {
-    // TODO: 一定次数内未超过则缩小buffer空间
+    // 缩小buffer空间见onDrained
     ensureWritable(len);
     std::copy(str, str + len, beginWrite());
     hasWritten(len);
 }
 
-void Buffer::append(const std::string &str) {
+void Buffer::append(std::string_view str) {
     append(str.data(), str.size());
 }
 
@@ -92,7 +240,13 @@ void Buffer::append(const Buffer &buff) {
 ssize_t Buffer::readFd(int fd, int *err_flag) {
     // 能一次性读完吗? - 不能, 尽量的去读, 由更上层封装 while循环读取直到读完
     // 读到的数据放到buffer_的什么位置? - writePos及之后
-    char extrabuf[65536];   // 64KB
+    if (capacity_ == 0) {
+        // 按需借用存储的Buffer, 有数据可读时才取一块
+        reallocate(BufferPool::CHUNK_SIZES[0]);
+    }
+    // 溢出缓冲不放在栈上, 从BufferPool的本线程链表取64KB的块
+    const size_t extra_size = BufferPool::CHUNK_SIZES[BufferPool::CLASS_NUM - 1];
+    char *extrabuf = BufferPool::getInstance()->allocate(extra_size);
     iovec vec[2] = {};
     const size_t writable = writableBytes();
     // why not use the beginWrite?
@@ -100,7 +254,7 @@ ssize_t Buffer::readFd(int fd, int *err_flag) {
     vec[0].iov_base = beginWrite();
     vec[0].iov_len = writable;
     vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof(extrabuf);
+    vec[1].iov_len = extra_size;
 
     const int iovcnt = 2;
     ssize_t len = readv(fd, vec, iovcnt);
@@ -109,11 +263,16 @@ ssize_t Buffer::readFd(int fd, int *err_flag) {
         *err_flag = errno;
     } else if (len <= writable) {
         // read读出的数据可以直接写到buffer_中, 直接移动指针
-        write_pos_ += len;
+        hasWritten(len);
     } else {
         // read读出了溢出的数据, 扩大buffer_, 等下一次读
-        write_pos_ = buffer_.size();
+        hasWritten(writable);
         append(extrabuf, len - writable);
     }
+    BufferPool::getInstance()->deallocate(extrabuf, extra_size);
+    if (readableBytes() == 0) {
+        // 没有读到数据(EAGAIN或对端关闭), 归还按需借用的存储
+        onDrained();
+    }
     return len;
 }
\ No newline at end of file
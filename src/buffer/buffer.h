@@ -5,7 +5,11 @@
 #ifndef BUFFER_H
 #define BUFFER_H
 #include <atomic>
+#include <charconv>
+#include <limits>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <cassert>
 
@@ -13,8 +17,13 @@ class Buffer {
 public:
     static const size_t kInitialSize = 1024;
 
+    // initial_size为0时不预先分配, 有数据时才从BufferPool借用存储, 数据取完立即归还
     Buffer(size_t initial_size = kInitialSize);
-    ~Buffer() = default;
+    Buffer(const Buffer &other);
+    Buffer(Buffer &&other) noexcept;
+    Buffer &operator=(const Buffer &other);
+    Buffer &operator=(Buffer &&other) noexcept;
+    ~Buffer();
 
     size_t readableBytes() const;
     size_t writableBytes() const;
@@ -31,19 +40,49 @@ public:
     std::string retrieveAllAsString();
 
     void append(const char* str, size_t len);
-    void append(const std::string& str);
+    void append(std::string_view str);
     void append(const void* data, size_t len);
     void append(const Buffer& buff);
 
+    // 整数用std::to_chars直接格式化到可写空间, 不产生临时字符串
+    template<typename T>
+    void appendNumber(T value) {
+        static_assert(std::is_integral_v<T>, "appendNumber only accepts integers");
+        ensureWritable(std::numeric_limits<T>::digits10 + 2);
+        std::to_chars_result result = std::to_chars(beginWrite(), beginWrite() + writableBytes(), value);
+        hasWritten(result.ptr - beginWrite());
+    }
+
     ssize_t readFd(int fd, int *err_flag);
     // void writeFd(int fd, int *err_flag);
+
+    // 当前容量(不是可读数据量)
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    // 把容量缩小到刚好放下可读数据(不小于kInitialSize, 按需借用的Buffer没有数据时释放全部存储)
+    void shrink();
+
+    /// 收缩策略: 数据被取完时检查容量
+    /// @param max_idle_capacity 取完后容量超过该值时立即收缩, 0表示不限制
+    /// @param shrink_rounds 连续该次数取完, 期间使用量都不到容量的1/4时收缩, 0表示关闭
+    static void setShrinkPolicy(size_t max_idle_capacity, size_t shrink_rounds);
+
+    // 进程内所有Buffer占用的字节数
+    static size_t totalBytes() {
+        return total_bytes_.load(std::memory_order_relaxed);
+    }
+
+    // 按大小类取整: 1KB, BufferPool的4KB/16KB/64KB块, 以上按64KB取整
+    static size_t roundCapacity(size_t size);
 private:
     char* begin() {
-        return &buffer_[0];
+        return buffer_;
     }
 
     const char *begin() const {
-        return &buffer_[0];
+        return buffer_;
     }
     // 确保至少有len大小的可写空间
     void ensureWritable(size_t len) {
@@ -55,8 +94,8 @@ private:
     // 扩大空间
     void expandSpace(size_t size) {
         if (writableBytes() + prependableBytes() < size) {
-            // 如果剩余空间放不下size大小的数据, 需要扩大
-            buffer_.resize(write_pos_ + size + 1);
+            // 如果剩余空间放不下size大小的数据, 需要扩大; 只保留可读数据, 容量按大小类取整
+            reallocate(roundCapacity(readableBytes() + size));
         } else {
             size_t readable = readableBytes();
             // 放的下, 把readable的数据移至开头
@@ -69,12 +108,28 @@ private:
     // 向buffer写入数据后改变写指针
     void hasWritten(size_t len) {
         write_pos_ += len;
+        if (write_pos_ - read_pos_ > high_water_) {
+            high_water_ = write_pos_ - read_pos_;
+        }
     }
-    std::vector<char> buffer_;
-    std::atomic<size_t> read_pos_;
-    std::atomic<size_t> write_pos_;
-    // 为什么要使用atomic包装pos?
-    // 如果是为了线程安全, 那么应该出现两个以上的线程操作同一个buffer实例的情况
+    // 换成capacity大小的存储(0表示释放), 可读数据移到开头
+    void reallocate(size_t capacity);
+    // 数据被取完时按收缩策略检查容量
+    void onDrained();
+
+    char *buffer_;
+    size_t capacity_;
+    // 同一时刻只有一个线程操作一个连接的Buffer(EPOLLONESHOT), 线程间的交接由epoll和线程池队列同步,
+    // 读写位置不需要atomic
+    size_t read_pos_;
+    size_t write_pos_;
+    size_t high_water_; // 上次收缩检查以来的最大可读数据量
+    size_t drained_rounds_; // 上次收缩检查以来数据被取完的次数
+    bool lazy_; // 按需从BufferPool借用存储
+
+    static std::atomic<size_t> total_bytes_;
+    static std::atomic<size_t> max_idle_capacity_;
+    static std::atomic<size_t> shrink_rounds_;
 };
 
 
@@ -0,0 +1,148 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "buffer_pool.h"
+
+#include <stdlib.h>
+#include <algorithm>
+
+const size_t BufferPool::CHUNK_SIZES[CLASS_NUM] = {4 * 1024, 16 * 1024, 64 * 1024};
+
+namespace {
+// 线程退出(或进程结束)时本线程的链表已经析构, 之后析构的Buffer直接归还到全局链表
+thread_local bool local_destroyed = false;
+} // namespace
+
+BufferPool::BufferPool() {
+    global_bytes_ = 0;
+    max_global_bytes_ = 32 * 1024 * 1024;
+    allocated_bytes_ = 0;
+    hits_ = 0;
+    misses_ = 0;
+}
+
+BufferPool::~BufferPool() {
+    for (auto &chunks: global_) {
+        for (char *chunk: chunks) {
+            free(chunk);
+        }
+    }
+}
+
+BufferPool *BufferPool::getInstance() {
+    static BufferPool instance;
+    return &instance;
+}
+
+BufferPool::LocalCache &BufferPool::localCache() {
+    thread_local LocalCache cache;
+    return cache;
+}
+
+BufferPool::LocalCache::~LocalCache() {
+    // 本线程的链表正在析构, 空闲块全部放回全局链表
+    for (size_t i = 0; i < CLASS_NUM; ++i) {
+        BufferPool::getInstance()->spill(*this, static_cast<int>(i), chunks[i].size());
+    }
+    local_destroyed = true;
+}
+
+int BufferPool::classIndex(size_t size) {
+    for (size_t i = 0; i < CLASS_NUM; ++i) {
+        if (size == CHUNK_SIZES[i]) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+size_t BufferPool::chunkSize(size_t size) {
+    for (size_t chunk: CHUNK_SIZES) {
+        if (size <= chunk) {
+            return chunk;
+        }
+    }
+    return 0;
+}
+
+char *BufferPool::allocate(size_t size) {
+    int index = classIndex(size);
+    if (index < 0) {
+        return static_cast<char *>(malloc(size));
+    }
+    if (local_destroyed) {
+        ++misses_;
+        allocated_bytes_ += size;
+        return static_cast<char *>(aligned_alloc(4096, size));
+    }
+    LocalCache &cache = localCache();
+    std::vector<char *> &chunks = cache.chunks[index];
+    if (chunks.empty() && !refill(cache, index)) {
+        ++misses_;
+        allocated_bytes_ += size;
+        // 按页对齐, 4KB的块正好占一页
+        return static_cast<char *>(aligned_alloc(4096, size));
+    }
+    ++hits_;
+    char *chunk = chunks.back();
+    chunks.pop_back();
+    return chunk;
+}
+
+void BufferPool::deallocate(char *chunk, size_t size) {
+    if (chunk == nullptr) {
+        return;
+    }
+    int index = classIndex(size);
+    if (index < 0) {
+        free(chunk);
+        return;
+    }
+    if (local_destroyed) {
+        free(chunk);
+        allocated_bytes_ -= size;
+        return;
+    }
+    LocalCache &cache = localCache();
+    cache.chunks[index].push_back(chunk);
+    if (cache.chunks[index].size() * size > LOCAL_BYTES) {
+        spill(cache, index, cache.chunks[index].size() / 2);
+    }
+}
+
+bool BufferPool::refill(LocalCache &cache, int index) {
+    size_t size = CHUNK_SIZES[index];
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<char *> &global = global_[index];
+    if (global.empty()) {
+        return false;
+    }
+    // 一次取本线程上限的一半, 减少加锁次数
+    size_t count = std::min(global.size(), std::max<size_t>(1, LOCAL_BYTES / size / 2));
+    cache.chunks[index].insert(cache.chunks[index].end(), global.end() - count, global.end());
+    global.resize(global.size() - count);
+    global_bytes_ -= count * size;
+    return true;
+}
+
+void BufferPool::spill(LocalCache &cache, int index, size_t count) {
+    size_t size = CHUNK_SIZES[index];
+    std::vector<char *> &chunks = cache.chunks[index];
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < count; ++i) {
+        char *chunk = chunks.back();
+        chunks.pop_back();
+        if (global_bytes_ + size > max_global_bytes_) {
+            free(chunk);
+            allocated_bytes_ -= size;
+            continue;
+        }
+        global_[index].push_back(chunk);
+        global_bytes_ += size;
+    }
+}
+
+BufferPool::Stats BufferPool::getStats() const {
+    return {hits_, misses_, allocated_bytes_, global_bytes_};
+}
@@ -0,0 +1,80 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// 固定大小内存块(4KB/16KB/64KB)的全局池, Buffer的存储和readFd的溢出缓冲都从这里分配
+// 每个线程有自己的空闲链表, 分配和归还通常不加锁; 线程的空闲块过多时放回全局链表, 全局链表也满了才释放
+// 一个线程分配的块可以由另一个线程归还(连接在不同工作线程之间迁移)
+class BufferPool {
+public:
+    struct Stats {
+        uint64_t hits; // 从空闲链表取得
+        uint64_t misses; // 向系统申请
+        size_t allocated_bytes; // 向系统申请且还没有释放的块的字节数
+        size_t global_bytes; // 全局空闲链表中的字节数
+    };
+
+    static const size_t CLASS_NUM = 3;
+    static const size_t CHUNK_SIZES[CLASS_NUM];
+
+    static BufferPool *getInstance();
+
+    /// 分配size字节, size为块大小时从池中取, 否则直接malloc
+    char *allocate(size_t size);
+
+    // 归还allocate得到的内存, size必须和分配时相同
+    void deallocate(char *chunk, size_t size);
+
+    // 大于size的最小块大小, 超过最大块时返回0
+    static size_t chunkSize(size_t size);
+
+    /// 全局空闲链表最多保留的字节数, 超过的块直接释放
+    void setMaxGlobalBytes(size_t bytes) { max_global_bytes_ = bytes; }
+
+    Stats getStats() const;
+
+private:
+    BufferPool();
+
+    ~BufferPool();
+
+    // 线程的空闲链表, 线程退出时归还到全局链表
+    struct LocalCache {
+        std::vector<char *> chunks[CLASS_NUM];
+
+        ~LocalCache();
+    };
+
+    static LocalCache &localCache();
+
+    static int classIndex(size_t size);
+
+    // 从全局链表取一批块放入本线程的链表
+    bool refill(LocalCache &cache, int index);
+
+    // 把本线程链表中的count个块放回全局链表
+    void spill(LocalCache &cache, int index, size_t count);
+
+    static const size_t LOCAL_BYTES = 256 * 1024; // 每个线程每种大小最多缓存的字节数
+
+    std::mutex mutex_; // 保护global_
+    std::vector<char *> global_[CLASS_NUM];
+    std::atomic<size_t> global_bytes_;
+    std::atomic<size_t> max_global_bytes_;
+    std::atomic<size_t> allocated_bytes_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+};
+
+
+#endif //BUFFER_POOL_H
@@ -0,0 +1,154 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "chain_buffer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <algorithm>
+
+void ChainBuffer::append(Buffer &&buffer) {
+    size_t len = buffer.readableBytes();
+    if (len == 0) {
+        return;
+    }
+    segments_.emplace_back().owned = std::move(buffer);
+    bytes_ += len;
+}
+
+void ChainBuffer::append(const char *data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    // 小块数据(分隔行, 分块头部等)合并到链尾, 不单独占用iovec
+    if (empty() || segments_.back().type != SEGMENT_OWNED) {
+        segments_.emplace_back();
+    }
+    segments_.back().owned.append(data, len);
+    bytes_ += len;
+}
+
+void ChainBuffer::appendRef(const char *data, size_t len, Keeper keeper) {
+    if (len == 0) {
+        return;
+    }
+    Segment &segment = segments_.emplace_back();
+    segment.type = SEGMENT_REF;
+    segment.data = data;
+    segment.len = len;
+    segment.keeper = std::move(keeper);
+    bytes_ += len;
+}
+
+void ChainBuffer::appendFile(int fd, off_t offset, size_t len, Keeper keeper) {
+    if (len == 0) {
+        return;
+    }
+    Segment &segment = segments_.emplace_back();
+    segment.type = SEGMENT_FILE;
+    segment.fd = fd;
+    segment.offset = offset;
+    segment.len = len;
+    segment.keeper = std::move(keeper);
+    bytes_ += len;
+}
+
+void ChainBuffer::clear() {
+    segments_.clear();
+    bytes_ = 0;
+}
+
+int ChainBuffer::peekIov(struct iovec *iov, int max_iov, size_t max_bytes) const {
+    int count = 0;
+    size_t total = 0;
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        const Segment &segment = segments_[i];
+        if (segment.type == SEGMENT_FILE || count == max_iov || total >= max_bytes) {
+            break;
+        }
+        size_t len = std::min(segment.size(), max_bytes - total);
+        iov[count].iov_base = const_cast<char *>(segment.type == SEGMENT_OWNED ? segment.owned.peek() : segment.data);
+        iov[count].iov_len = len;
+        total += len;
+        ++count;
+    }
+    return count;
+}
+
+void ChainBuffer::consume(size_t len) {
+    assert(len <= bytes_);
+    bytes_ -= len;
+    size_t done = 0;
+    while (len > 0) {
+        Segment &segment = segments_[done];
+        size_t n = std::min(len, segment.size());
+        if (segment.type == SEGMENT_OWNED) {
+            segment.owned.retrieve(n);
+        } else if (segment.type == SEGMENT_REF) {
+            segment.data += n;
+            segment.len -= n;
+        } else {
+            segment.offset += n;
+            segment.len -= n;
+        }
+        len -= n;
+        if (segment.size() == 0) {
+            ++done;
+        }
+    }
+    // 写完的段立即移出, 释放引用(归还自有段的存储, 释放缓存条目的引用计数)
+    // 剩下的段前移, 通常只有几个
+    segments_.erase(segments_.begin(), segments_.begin() + done);
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *save_errno, size_t max_bytes) {
+    if (empty() || max_bytes == 0) {
+        return 0;
+    }
+    if (segments_[0].type == SEGMENT_FILE) {
+        return sendFile(segments_[0], fd, save_errno, max_bytes);
+    }
+    struct iovec iov[MAX_IOV];
+    int count = peekIov(iov, MAX_IOV, max_bytes);
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    // 后面紧跟文件内容时, MSG_MORE让响应头和文件开头合并到同一个报文
+    int flags = MSG_NOSIGNAL;
+    if (static_cast<size_t>(count) < segments_.size() && segments_[count].type == SEGMENT_FILE) {
+        flags |= MSG_MORE;
+    }
+    ssize_t len = sendmsg(fd, &msg, flags);
+    if (len < 0) {
+        *save_errno = errno;
+        return len;
+    }
+    consume(len);
+    return len;
+}
+
+ssize_t ChainBuffer::sendFile(Segment &segment, int fd, int *save_errno, size_t max_bytes) {
+    size_t chunk = std::min(segment.len, max_bytes);
+    if (!segment.hinted) {
+        // 顺序读取, 让内核加大预读窗口
+        posix_fadvise(segment.fd, segment.offset, segment.len, POSIX_FADV_SEQUENTIAL);
+        segment.hinted = true;
+    }
+    if (segment.len > chunk) {
+        // 本次之后要发送的内容提前异步读入页缓存, 慢速磁盘上不阻塞下一次发送
+        posix_fadvise(segment.fd, segment.offset + chunk, std::min(segment.len - chunk, READAHEAD_WINDOW),
+                      POSIX_FADV_WILLNEED);
+    }
+    // 内核直接从页缓存发送, 偏移由consume更新
+    off_t offset = segment.offset;
+    ssize_t len = sendfile(fd, segment.fd, &offset, chunk);
+    if (len < 0) {
+        *save_errno = errno;
+        return len;
+    }
+    consume(len);
+    return len;
+}
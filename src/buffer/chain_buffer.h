@@ -0,0 +1,98 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef CHAIN_BUFFER_H
+#define CHAIN_BUFFER_H
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "buffer.h"
+
+// 由若干段组成的发送缓冲, 每段是以下之一:
+// 1. 自有内存: 一个Buffer, 追加的小块数据合并到链尾的自有段
+// 2. 借用的内存: 如缓存中的文件内容, 由keeper持有引用计数, 发送完之前不会被释放
+// 3. 文件范围: 通过sendfile发送, keeper持有打开的文件描述符
+// 发送时链头部连续的内存段组成iovec一次发送, 部分写入后的偏移由链统一维护
+class ChainBuffer {
+public:
+    using Keeper = std::shared_ptr<const void>;
+
+    ChainBuffer() = default;
+
+    // 把buffer中的可读数据整个移入链尾, 不复制, buffer变为空
+    void append(Buffer &&buffer);
+
+    // 复制数据到链尾的自有段
+    void append(const char *data, size_t len);
+
+    void append(std::string_view data) {
+        append(data.data(), data.size());
+    }
+
+    // 借用[data, data + len), keeper为空时由调用者保证发送完之前有效
+    void appendRef(const char *data, size_t len, Keeper keeper);
+
+    // 文件中[offset, offset + len)的内容, keeper为空时由调用者保证发送完之前fd有效
+    void appendFile(int fd, off_t offset, size_t len, Keeper keeper);
+
+    size_t readableBytes() const { return bytes_; }
+
+    bool empty() const { return segments_.empty(); }
+
+    void clear();
+
+    /// 发送链头部的数据: 连续的内存段合并成iovec一次sendmsg, 文件段用sendfile
+    /// @param max_bytes 本次最多发送的字节数
+    /// @return 发送的字节数, 出错时返回-1并设置save_errno
+    ssize_t writeFd(int fd, int *save_errno, size_t max_bytes);
+
+    /// 链头部的内存段组成的iovec, 遇到文件段时停止
+    /// @return iovec的个数
+    int peekIov(struct iovec *iov, int max_iov, size_t max_bytes) const;
+
+    // 丢弃链头部已经发送的len字节, 弹出写完的段
+    void consume(size_t len);
+
+    static constexpr size_t READAHEAD_WINDOW = 1024 * 1024; // sendfile时提前读入页缓存的范围
+
+private:
+    enum SEGMENT_TYPE {
+        SEGMENT_OWNED = 0,
+        SEGMENT_REF,
+        SEGMENT_FILE,
+    };
+
+    struct Segment {
+        SEGMENT_TYPE type = SEGMENT_OWNED;
+        Buffer owned{0}; // 自有段的数据, 其他段不分配存储
+        const char *data = nullptr; // 借用段的剩余数据
+        int fd = -1; // 文件段
+        off_t offset = 0;
+        size_t len = 0; // 借用段和文件段的剩余字节数
+        bool hinted = false; // 文件段是否已经设置顺序读取
+        Keeper keeper;
+
+        size_t size() const {
+            return type == SEGMENT_OWNED ? owned.readableBytes() : len;
+        }
+    };
+
+    // 发送链头部的文件段
+    ssize_t sendFile(Segment &segment, int fd, int *save_errno, size_t max_bytes);
+
+    static const int MAX_IOV = 64;
+
+    // 链头部在segments_[0], 写完的段在每次consume时移出, 长连接上一直有数据排队时段数也不会增长
+    // vector保留容量, 稳定后不再分配内存
+    std::vector<Segment> segments_;
+    size_t bytes_ = 0;
+};
+
+
+#endif //CHAIN_BUFFER_H
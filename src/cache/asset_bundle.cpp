@@ -0,0 +1,124 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "asset_bundle.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "logger/logger.h"
+
+AssetBundle::AssetBundle() {
+    base_ = nullptr;
+    size_ = 0;
+    missing_ = std::make_shared<FdEntry>();
+}
+
+AssetBundle::~AssetBundle() {
+    close();
+}
+
+AssetBundle *AssetBundle::getInstance() {
+    static AssetBundle instance;
+    return &instance;
+}
+
+bool AssetBundle::open(const std::string &path) {
+    close();
+    int fd = ::open(path.data(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("open asset bundle %s error: %d", path.data(), errno);
+        return false;
+    }
+    struct stat st = {};
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        LOG_ERROR("invalid asset bundle %s", path.data());
+        ::close(fd);
+        return false;
+    }
+    void *base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // 映射建立后不再需要文件描述符
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        LOG_ERROR("mmap asset bundle %s error: %d", path.data(), errno);
+        return false;
+    }
+    base_ = static_cast<char *>(base);
+    size_ = st.st_size;
+    path_ = path;
+    // 启动时整个读入页缓存, 请求时不会因为缺页读盘
+    madvise(base_, size_, MADV_WILLNEED);
+    if (!load()) {
+        LOG_ERROR("invalid asset bundle %s", path.data());
+        close();
+        return false;
+    }
+    LOG_INFO("asset bundle %s: %zu files, %zu bytes", path.data(), assets_.size(), size_);
+    return true;
+}
+
+bool AssetBundle::load() {
+    Header header;
+    memcpy(&header, base_, sizeof(header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.total_size != size_ || header.index_offset > size_ ||
+        (size_ - header.index_offset) / sizeof(Index) < header.count) {
+        return false;
+    }
+    assets_.reserve(header.count);
+    for (uint32_t i = 0; i < header.count; ++i) {
+        Index index;
+        memcpy(&index, base_ + header.index_offset + i * sizeof(Index), sizeof(index));
+        // 路径和内容都必须在资源包内
+        if (index.path_offset > size_ || index.path_len > size_ - index.path_offset ||
+            index.data_offset > size_ || index.size > size_ - index.data_offset) {
+            return false;
+        }
+        std::string_view path(base_ + index.path_offset, index.path_len);
+        struct stat st = {};
+        st.st_mode = index.mode;
+        st.st_size = index.size;
+        st.st_mtim.tv_sec = index.mtime_sec;
+        st.st_mtim.tv_nsec = index.mtime_nsec;
+        st.st_ino = i + 1;
+        st.st_nlink = 1;
+
+        auto fd_entry = std::make_shared<FdEntry>();
+        fd_entry->path = path_ + ":" + std::string(path);
+        fd_entry->file_stat = st;
+        fd_entry->exists = true;
+        auto file_entry = std::make_shared<FileEntry>();
+        file_entry->path = fd_entry->path;
+        file_entry->body = std::string_view(base_ + index.data_offset, index.size);
+        file_entry->file_stat = st;
+        assets_[path] = {std::move(fd_entry), std::move(file_entry)};
+    }
+    return true;
+}
+
+void AssetBundle::close() {
+    assets_.clear();
+    if (base_) {
+        munmap(base_, size_);
+        base_ = nullptr;
+        size_ = 0;
+    }
+}
+
+FdEntryPtr AssetBundle::find(const std::string &path, FileEntryPtr *file_entry) const {
+    auto it = assets_.find(path);
+    if (it == assets_.end()) {
+        if (file_entry) {
+            file_entry->reset();
+        }
+        return missing_;
+    }
+    if (file_entry) {
+        *file_entry = it->second.file_entry;
+    }
+    return it->second.fd_entry;
+}
@@ -0,0 +1,85 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef ASSET_BUNDLE_H
+#define ASSET_BUNDLE_H
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "fd_cache.h"
+#include "file_cache.h"
+
+// 打包后的静态资源: 整个资源目录打成一个文件, 启动时只mmap一次
+// 打开后所有静态文件都从资源包读取, 请求处理不再访问文件系统(不stat, 不open, 不read)
+// 格式(本机字节序): 文件头 | 各文件内容(8字节对齐) | 按路径排序的索引 | 路径字符串
+// 可压缩的文本文件在打包时额外生成.gz版本, 和预压缩文件一样按Accept-Encoding发送
+class AssetBundle {
+public:
+    static AssetBundle *getInstance();
+
+    /// 映射资源包并建立索引, 只在启动时调用
+    /// @return 文件不存在或格式错误时返回false, 此时仍从资源目录读取
+    bool open(const std::string &path);
+
+    bool isOpen() const { return base_ != nullptr; }
+
+    size_t size() const { return assets_.size(); }
+
+    /// 查找资源路径(如/index.html), 不会返回nullptr, 不存在时返回负条目
+    /// @param file_entry 文件内容, 指向资源包的映射
+    FdEntryPtr find(const std::string &path, FileEntryPtr *file_entry) const;
+
+    // 资源包格式, 由tools/pack_resources生成
+    static constexpr char MAGIC[8] = {'W', 'S', 'B', 'U', 'N', 'D', 'L', 'E'};
+    static const uint32_t VERSION = 1;
+    static const size_t ALIGN = 8; // 文件内容的对齐
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t count; // 文件数
+        uint64_t index_offset; // 索引的偏移
+        uint64_t total_size; // 整个资源包的大小, 用于发现被截断的文件
+    };
+
+    // 一个文件的索引, 按路径排序
+    struct Index {
+        uint64_t path_offset;
+        uint64_t data_offset;
+        uint64_t size;
+        int64_t mtime_sec;
+        int64_t mtime_nsec;
+        uint32_t path_len;
+        uint32_t mode;
+    };
+
+private:
+    AssetBundle();
+
+    ~AssetBundle();
+
+    // 检查文件头和索引, 为每个文件生成缓存条目
+    bool load();
+
+    void close();
+
+    struct Asset {
+        FdEntryPtr fd_entry;
+        FileEntryPtr file_entry;
+    };
+
+    char *base_; // 资源包的映射
+    size_t size_;
+    std::string path_;
+    std::unordered_map<std::string_view, Asset> assets_; // 键指向映射中的路径字符串
+    FdEntryPtr missing_; // 所有不存在的路径共用的负条目
+};
+
+
+#endif //ASSET_BUNDLE_H
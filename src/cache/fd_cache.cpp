@@ -0,0 +1,293 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "fd_cache.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <chrono>
+#include <functional>
+
+#include "file_cache.h"
+#include "logger/logger.h"
+
+namespace {
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 文件内容, 属性改变, 以及目录中的文件增删和改名
+const uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+                            IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+} // namespace
+
+FdEntry::~FdEntry() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+FdCache::FdCache() {
+    max_entries_ = 0;
+    shard_entries_ = 0;
+    revalidate_ms_ = 0;
+    notify_fd_ = -1;
+    hits_ = 0;
+    misses_ = 0;
+    evictions_ = 0;
+    invalidations_ = 0;
+}
+
+FdCache::~FdCache() {
+    if (notify_fd_ >= 0) {
+        close(notify_fd_);
+    }
+}
+
+FdCache *FdCache::getInstance() {
+    static FdCache instance;
+    return &instance;
+}
+
+void FdCache::init(size_t max_entries, int revalidate_ms) {
+    clear();
+    max_entries_ = max_entries;
+    shard_entries_ = (max_entries + SHARD_NUM - 1) / SHARD_NUM;
+    revalidate_ms_ = revalidate_ms;
+}
+
+std::string FdCache::normalize(const std::string &path) {
+    std::string result = path;
+    normalizeInPlace(result);
+    return result;
+}
+
+void FdCache::normalizeInPlace(std::string &path) {
+    size_t pos = path.find("//");
+    if (pos == std::string::npos) {
+        return;
+    }
+    size_t out = pos + 1;
+    for (size_t i = pos + 1; i < path.size(); ++i) {
+        if (path[i] != '/' || path[out - 1] != '/') {
+            path[out++] = path[i];
+        }
+    }
+    path.resize(out);
+}
+
+FdCache::Shard &FdCache::getShard(const std::string &path) {
+    return shards_[std::hash<std::string>()(path) % SHARD_NUM];
+}
+
+FdEntryPtr FdCache::get(const std::string &path) {
+    if (max_entries_ == 0) {
+        ++misses_;
+        return open(path);
+    }
+    Shard &shard = getShard(path);
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        generation = shard.generation;
+        auto it = shard.index.find(path);
+        if (it != shard.index.end()) {
+            FdEntryPtr entry = *it->second;
+            int64_t now = nowMs();
+            // 有inotify时revalidate_ms_ < 0, 命中不需要任何系统调用
+            if (revalidate_ms_ < 0 || now - entry->checked_ms < revalidate_ms_ || !isStale(*entry)) {
+                entry->checked_ms = now;
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                ++hits_;
+                return entry;
+            }
+            shard.lru.erase(it->second);
+            shard.index.erase(it);
+        }
+    }
+    ++misses_;
+    FdEntryPtr entry = open(path);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.generation != generation) {
+        // stat之后文件可能又被改变, 有inotify时不会再校验, 只给本次请求使用
+        return entry;
+    }
+    auto it = shard.index.find(path);
+    if (it != shard.index.end()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+    shard.lru.push_front(entry);
+    shard.index[path] = shard.lru.begin();
+    // 淘汰最久未使用的路径, 扫描器大量探测不存在的路径时也不会无限增长
+    while (shard.lru.size() > shard_entries_) {
+        shard.index.erase(shard.lru.back()->path);
+        shard.lru.pop_back();
+        ++evictions_;
+    }
+    return entry;
+}
+
+FdEntryPtr FdCache::open(const std::string &path) {
+    auto entry = std::make_shared<FdEntry>();
+    entry->path = path;
+    entry->checked_ms = nowMs();
+    if (stat(path.data(), &entry->file_stat) < 0) {
+        entry->file_stat = {};
+        return entry;
+    }
+    entry->exists = true;
+    if (S_ISREG(entry->file_stat.st_mode)) {
+        entry->fd = ::open(path.data(), O_RDONLY | O_CLOEXEC);
+    }
+    return entry;
+}
+
+bool FdCache::isStale(const FdEntry &entry) {
+    struct stat st = {};
+    if (stat(entry.path.data(), &st) < 0) {
+        return entry.exists;
+    }
+    return !entry.exists || st.st_ino != entry.file_stat.st_ino || st.st_size != entry.file_stat.st_size ||
+           st.st_mtim.tv_sec != entry.file_stat.st_mtim.tv_sec ||
+           st.st_mtim.tv_nsec != entry.file_stat.st_mtim.tv_nsec ||
+           st.st_mode != entry.file_stat.st_mode;
+}
+
+void FdCache::invalidate(const std::string &path) {
+    Shard &shard = getShard(path);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    // 路径不在缓存中也要加1, 它可能正在被get在锁外stat
+    ++shard.generation;
+    auto it = shard.index.find(path);
+    if (it != shard.index.end()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        ++invalidations_;
+    }
+}
+
+void FdCache::invalidateAll(const std::string &path) {
+    invalidate(path);
+    FileCache::getInstance()->invalidate(path);
+}
+
+void FdCache::clear() {
+    for (Shard &shard: shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        ++shard.generation;
+        shard.lru.clear();
+        shard.index.clear();
+    }
+}
+
+int FdCache::watch(const std::string &dir) {
+    if (notify_fd_ < 0) {
+        notify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (notify_fd_ < 0) {
+            LOG_WARN("inotify init error: %d", errno);
+            return -1;
+        }
+    }
+    if (!addWatch(normalize(dir + "/"))) {
+        close(notify_fd_);
+        notify_fd_ = -1;
+        std::lock_guard<std::mutex> lock(watch_mutex_);
+        watch_dirs_.clear();
+        return -1;
+    }
+    // 文件改变会收到通知, 不再需要定期stat
+    revalidate_ms_ = -1;
+    return notify_fd_;
+}
+
+bool FdCache::addWatch(const std::string &dir) {
+    int wd = inotify_add_watch(notify_fd_, dir.data(), WATCH_MASK | IN_ONLYDIR);
+    if (wd < 0) {
+        LOG_WARN("inotify watch %s error: %d", dir.data(), errno);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(watch_mutex_);
+        watch_dirs_[wd] = dir;
+    }
+    // inotify不会递归, 子目录需要分别监听
+    DIR *dp = opendir(dir.data());
+    if (dp == nullptr) {
+        return true;
+    }
+    bool ok = true;
+    while (struct dirent *ent = readdir(dp)) {
+        std::string name = ent->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        struct stat st = {};
+        if (lstat((dir + name).data(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            ok = addWatch(dir + name + "/") && ok;
+        }
+    }
+    closedir(dp);
+    return ok;
+}
+
+void FdCache::onNotify() {
+    // 按inotify_event对齐
+    alignas(struct inotify_event) char buf[4096];
+    while (true) {
+        ssize_t len = read(notify_fd_, buf, sizeof(buf));
+        if (len <= 0) {
+            break;
+        }
+        for (char *ptr = buf; ptr < buf + len;) {
+            auto *event = reinterpret_cast<const struct inotify_event *>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                // 丢失了事件, 无法知道哪些文件改变
+                LOG_WARN("inotify queue overflow, clear file caches");
+                clear();
+                FileCache::getInstance()->clear();
+                continue;
+            }
+            std::string dir;
+            {
+                std::lock_guard<std::mutex> lock(watch_mutex_);
+                auto it = watch_dirs_.find(event->wd);
+                if (it == watch_dirs_.end()) {
+                    continue;
+                }
+                dir = it->second;
+                if (event->mask & IN_IGNORED) {
+                    watch_dirs_.erase(it);
+                    continue;
+                }
+            }
+            if ((event->mask & IN_ISDIR) || event->len == 0) {
+                // 目录的增删和改名会影响其下所有路径(包括负缓存), 目录事件很少, 直接清空
+                if ((event->mask & (IN_CREATE | IN_MOVED_TO)) && event->len > 0) {
+                    addWatch(dir + event->name + "/");
+                }
+                ++invalidations_;
+                clear();
+                FileCache::getInstance()->clear();
+                continue;
+            }
+            LOG_DEBUG("inotify: %s%s changed", dir.data(), event->name);
+            invalidateAll(dir + event->name);
+        }
+    }
+}
+
+FdCache::Stats FdCache::getStats() const {
+    Stats stats = {hits_, misses_, evictions_, invalidations_, 0};
+    for (const Shard &shard: shards_) {
+        std::lock_guard<std::mutex> lock(const_cast<std::mutex &>(shard.mutex));
+        stats.entries += shard.lru.size();
+    }
+    return stats;
+}
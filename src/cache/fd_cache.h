@@ -0,0 +1,122 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef FD_CACHE_H
+#define FD_CACHE_H
+#pragma once
+
+#include <sys/stat.h>
+#include <stdint.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "file_cache.h"
+
+// 路径解析结果: 打开的文件描述符和文件状态, 或者文件不存在(负缓存)
+// 文件描述符在条目析构时关闭, 正在sendfile/mmap的连接持有引用, 不会被提前关闭
+struct FdEntry {
+    std::string path; // 完整路径
+    int fd = -1; // 只有普通文件才打开
+    struct stat file_stat = {};
+    bool exists = false; // false表示路径不存在
+    mutable std::atomic<int64_t> checked_ms{0}; // 上次校验的时间
+    mutable HeaderSlot headers[HEADER_SLOT_NUM];
+
+    ~FdEntry();
+};
+
+using FdEntryPtr = std::shared_ptr<const FdEntry>;
+
+// 文件描述符和元数据缓存, 省去每个请求的stat/open, 包括对不存在路径的探测
+// 资源目录通过inotify监听, 文件改变时使本缓存和FileCache中的条目失效;
+// inotify不可用时退化为每隔revalidate_ms重新stat
+class FdCache {
+public:
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t invalidations;
+        size_t entries;
+    };
+
+    static FdCache *getInstance();
+
+    /// 初始化缓存
+    /// @param max_entries 最多缓存的路径数, 0表示关闭缓存(每次都stat/open)
+    /// @param revalidate_ms 没有inotify时, 命中后最多每隔多久stat一次
+    void init(size_t max_entries, int revalidate_ms = 1000);
+
+    // 查找路径, 不会返回nullptr; 关闭缓存时返回不缓存的条目
+    FdEntryPtr get(const std::string &path);
+
+    void invalidate(const std::string &path);
+
+    void clear();
+
+    /// 递归监听目录, 成功后不再定期stat
+    /// @return inotify的文件描述符, 由调用者注册到Epoller; 失败返回-1
+    int watch(const std::string &dir);
+
+    int getWatchFd() const { return notify_fd_; }
+
+    // inotify可读时调用, 使改变的文件失效
+    void onNotify();
+
+    Stats getStats() const;
+
+    // 合并路径中连续的'/'. 请求路径已经由HttpRequest::normalizePath规范化(解码, 去掉点段),
+    // 这里只处理和资源目录拼接产生的"//", 保证同一个文件的键相同
+    static std::string normalize(const std::string &path);
+
+    // 原地合并, 不分配内存
+    static void normalizeInPlace(std::string &path);
+
+private:
+    FdCache();
+
+    ~FdCache();
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<FdEntryPtr> lru; // 最近使用的在前
+        std::unordered_map<std::string, std::list<FdEntryPtr>::iterator> index;
+        // 每次失效加1; 未命中时在锁外stat, 期间发生过失效则结果可能已经过时, 不放入缓存
+        uint64_t generation = 0;
+    };
+
+    Shard &getShard(const std::string &path);
+
+    static FdEntryPtr open(const std::string &path);
+
+    static bool isStale(const FdEntry &entry);
+
+    bool addWatch(const std::string &dir);
+
+    // 使路径失效, 同时使FileCache中的内容失效
+    void invalidateAll(const std::string &path);
+
+    static const size_t SHARD_NUM = 16;
+
+    size_t max_entries_;
+    size_t shard_entries_;
+    std::atomic<int> revalidate_ms_;
+    Shard shards_[SHARD_NUM];
+
+    int notify_fd_;
+    std::mutex watch_mutex_; // 保护watch_dirs_
+    std::unordered_map<int, std::string> watch_dirs_; // wd -> 目录路径(以'/'结尾)
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> evictions_;
+    std::atomic<uint64_t> invalidations_;
+};
+
+
+#endif //FD_CACHE_H
@@ -0,0 +1,240 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "file_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+#include <zlib.h>
+
+namespace {
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+FileCache::FileCache() {
+    capacity_ = 0;
+    shard_capacity_ = 0;
+    max_file_size_ = 0;
+    revalidate_ms_ = 0;
+    compress_ = false;
+    hits_ = 0;
+    misses_ = 0;
+    evictions_ = 0;
+}
+
+FileCache *FileCache::getInstance() {
+    static FileCache instance;
+    return &instance;
+}
+
+void FileCache::init(size_t capacity, size_t max_file_size, int revalidate_ms, bool compress) {
+    clear();
+    capacity_ = capacity;
+    shard_capacity_ = capacity / SHARD_NUM;
+    // 单个文件最多占一个分片
+    max_file_size_ = std::min(max_file_size, shard_capacity_);
+    revalidate_ms_ = revalidate_ms;
+    compress_ = compress;
+}
+
+FileCache::Shard &FileCache::getShard(const std::string &path) {
+    return shards_[std::hash<std::string>()(path) % SHARD_NUM];
+}
+
+FileEntryPtr FileCache::get(const std::string &path) {
+    if (!isOpen()) {
+        return nullptr;
+    }
+    Shard &shard = getShard(path);
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        generation = shard.generation;
+        auto it = shard.index.find(path);
+        if (it != shard.index.end()) {
+            FileEntryPtr entry = *it->second;
+            int64_t now = nowMs();
+            // 命中且在校验间隔内(或由inotify负责失效), 不需要任何文件系统调用
+            if (revalidate_ms_ < 0 || now - entry->checked_ms < revalidate_ms_) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                ++hits_;
+                return entry;
+            }
+            if (!isStale(*entry)) {
+                entry->checked_ms = now;
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                ++hits_;
+                return entry;
+            }
+            erase(shard, it->second);
+        }
+    }
+    ++misses_;
+    // 加载文件时不持有锁, 同一个文件可能被并发加载, 后插入的覆盖先插入的
+    FileEntryPtr entry = load(path);
+    if (entry) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        // 有inotify时命中不再校验, 旧内容一旦放入会一直发送到被淘汰, 只给本次请求使用
+        if (shard.generation == generation) {
+            insert(shard, entry);
+        }
+    }
+    return entry;
+}
+
+FileEntryPtr FileCache::load(const std::string &path) const {
+    int fd = open(path.data(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    auto entry = std::make_shared<FileEntry>();
+    if (fstat(fd, &entry->file_stat) < 0 || !S_ISREG(entry->file_stat.st_mode) ||
+        static_cast<size_t>(entry->file_stat.st_size) > max_file_size_) {
+        close(fd);
+        return nullptr;
+    }
+    entry->path = path;
+    entry->content.resize(entry->file_stat.st_size);
+    size_t total = 0;
+    while (total < entry->content.size()) {
+        ssize_t len = read(fd, entry->content.data() + total, entry->content.size() - total);
+        if (len <= 0) {
+            if (len < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        total += len;
+    }
+    close(fd);
+    // 读取过程中文件被截断
+    if (total != entry->content.size()) {
+        return nullptr;
+    }
+    entry->body = entry->content;
+    entry->checked_ms = nowMs();
+    return entry;
+}
+
+bool FileCache::isStale(const FileEntry &entry) {
+    struct stat st = {};
+    if (stat(entry.path.data(), &st) < 0) {
+        return true;
+    }
+    return st.st_ino != entry.file_stat.st_ino || st.st_size != entry.file_stat.st_size ||
+           st.st_mtim.tv_sec != entry.file_stat.st_mtim.tv_sec ||
+           st.st_mtim.tv_nsec != entry.file_stat.st_mtim.tv_nsec ||
+           st.st_mode != entry.file_stat.st_mode;
+}
+
+void FileCache::insert(Shard &shard, const FileEntryPtr &entry) {
+    auto it = shard.index.find(entry->path);
+    if (it != shard.index.end()) {
+        erase(shard, it->second);
+    }
+    shard.lru.push_front(entry);
+    shard.index[entry->path] = shard.lru.begin();
+    shard.bytes += entry->content.size();
+    // 淘汰最久未使用的文件, 正在发送的连接仍然持有引用
+    while (shard.bytes > shard_capacity_ && shard.lru.size() > 1) {
+        erase(shard, std::prev(shard.lru.end()));
+        ++evictions_;
+    }
+}
+
+void FileCache::erase(Shard &shard, std::list<FileEntryPtr>::iterator it) {
+    shard.bytes -= entrySize(**it);
+    shard.index.erase((*it)->path);
+    shard.lru.erase(it);
+}
+
+size_t FileCache::entrySize(const FileEntry &entry) {
+    return entry.content.size() + (entry.gzip_charged ? entry.gzip.size() : 0);
+}
+
+const std::string *FileCache::getGzip(const FileEntryPtr &entry) {
+    if (!compress_ || !entry) {
+        return nullptr;
+    }
+    std::call_once(entry->gzip_once, [&entry]() {
+        // 压缩后不变小的文件(如已经压缩过的格式)直接发送原内容
+        std::string out;
+        if (gzip(entry->body, out)) {
+            entry->gzip = std::move(out);
+        }
+    });
+    if (entry->gzip.empty()) {
+        return nullptr;
+    }
+    // 压缩内容同样占用缓存空间, 条目仍在缓存中时计入分片大小
+    Shard &shard = getShard(entry->path);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(entry->path);
+    if (!entry->gzip_charged && it != shard.index.end() && *it->second == entry) {
+        entry->gzip_charged = true;
+        shard.bytes += entry->gzip.size();
+    }
+    return &entry->gzip;
+}
+
+bool FileCache::gzip(std::string_view src, std::string &out) {
+    z_stream stream = {};
+    // windowBits + 16: 生成gzip格式
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    out.assign(deflateBound(&stream, src.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(src.data()));
+    stream.avail_in = src.size();
+    stream.next_out = reinterpret_cast<Bytef *>(out.data());
+    stream.avail_out = out.size();
+    int ret = deflate(&stream, Z_FINISH);
+    size_t len = stream.total_out;
+    deflateEnd(&stream);
+    if (ret != Z_STREAM_END || len >= src.size()) {
+        out.clear();
+        return false;
+    }
+    out.resize(len);
+    return true;
+}
+
+void FileCache::invalidate(const std::string &path) {
+    Shard &shard = getShard(path);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    // 路径不在缓存中也要加1, 它可能正在被get在锁外加载
+    ++shard.generation;
+    auto it = shard.index.find(path);
+    if (it != shard.index.end()) {
+        erase(shard, it->second);
+    }
+}
+
+void FileCache::clear() {
+    for (Shard &shard: shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        ++shard.generation;
+        shard.lru.clear();
+        shard.index.clear();
+        shard.bytes = 0;
+    }
+}
+
+FileCache::Stats FileCache::getStats() const {
+    Stats stats = {hits_, misses_, evictions_, 0, 0};
+    for (const Shard &shard: shards_) {
+        std::lock_guard<std::mutex> lock(const_cast<std::mutex &>(shard.mutex));
+        stats.bytes += shard.bytes;
+        stats.entries += shard.lru.size();
+    }
+    return stats;
+}
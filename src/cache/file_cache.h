@@ -0,0 +1,139 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+#pragma once
+
+#include <sys/stat.h>
+#include <stdint.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// 同一个文件的不同发送方式, 各自有预先生成的响应头
+enum HEADER_SLOT {
+    HEADER_IDENTITY = 0, // 按原文件发送
+    HEADER_SIBLING, // 作为另一个文件的预压缩版本(.gz/.br)发送
+    HEADER_COMPRESSED, // 发送内存中压缩后的内容
+    HEADER_SLOT_NUM,
+};
+
+// 预先生成的响应头, 由使用者第一次使用时生成, 随条目一起失效
+struct HeaderSlot {
+    std::once_flag once;
+    std::string value; // 完整的实体头部
+    std::string etag;
+    std::string validators; // ETag, Last-Modified等304响应也要发送的头部
+};
+
+// 缓存中的一个文件, 内容只读
+// 通过shared_ptr引用计数, 被淘汰后正在发送的连接仍然可以安全使用
+struct FileEntry {
+    std::string path; // 完整路径
+    std::string content; // 文件内容
+    std::string_view body; // 发送的内容, 指向content或资源包的映射
+    struct stat file_stat; // 加载时的文件状态
+    mutable std::atomic<int64_t> checked_ms{0}; // 上次校验文件是否改变的时间
+    mutable HeaderSlot headers[HEADER_SLOT_NUM];
+    // gzip压缩后的内容, 第一次需要时生成, 压缩后不变小时为空
+    mutable std::once_flag gzip_once;
+    mutable std::string gzip;
+    mutable bool gzip_charged = false; // 压缩内容是否已计入分片大小, 由分片锁保护
+};
+
+using FileEntryPtr = std::shared_ptr<const FileEntry>;
+
+// 静态文件内容缓存, 按字节数限制大小, LRU淘汰
+// 按路径哈希分片, 每个分片一把锁
+class FileCache {
+public:
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        size_t bytes; // 缓存的文件内容总字节数
+        size_t entries;
+    };
+
+    static FileCache *getInstance();
+
+    /// 初始化缓存
+    /// @param capacity 缓存总字节数, 0表示关闭缓存
+    /// @param max_file_size 超过该大小的文件不缓存
+    /// @param revalidate_ms 命中时最多每隔多久stat一次文件检查是否改变, < 0表示只通过invalidate失效
+    /// @param compress 是否允许缓存gzip压缩后的内容
+    void init(size_t capacity, size_t max_file_size = 1024 * 1024, int revalidate_ms = 1000,
+              bool compress = false);
+
+    bool isOpen() const { return capacity_ > 0; }
+
+    // 超过该大小的文件不会被缓存
+    size_t maxFileSize() const { return max_file_size_; }
+
+    // 查找文件, 未命中时加载; 文件不存在, 不是普通文件或过大时返回nullptr
+    FileEntryPtr get(const std::string &path);
+
+    // 获取条目gzip压缩后的内容, 只压缩一次; 没有开启压缩或压缩后不变小时返回nullptr
+    const std::string *getGzip(const FileEntryPtr &entry);
+
+    // gzip压缩, 压缩失败或结果不比原内容小时返回false
+    static bool gzip(std::string_view src, std::string &out);
+
+    // 文件改变或删除时使缓存失效
+    void invalidate(const std::string &path);
+
+    void clear();
+
+    Stats getStats() const;
+
+private:
+    FileCache();
+
+    ~FileCache() = default;
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<FileEntryPtr> lru; // 最近使用的在前
+        std::unordered_map<std::string, std::list<FileEntryPtr>::iterator> index;
+        size_t bytes = 0;
+        // 每次失效加1; 加载在锁外进行, 期间发生过失效则读到的可能是旧内容, 不放入缓存
+        uint64_t generation = 0;
+    };
+
+    Shard &getShard(const std::string &path);
+
+    // 读取整个文件, 失败或不满足缓存条件时返回nullptr
+    FileEntryPtr load(const std::string &path) const;
+
+    // 文件在磁盘上是否已经改变
+    static bool isStale(const FileEntry &entry);
+
+    void insert(Shard &shard, const FileEntryPtr &entry);
+
+    void erase(Shard &shard, std::list<FileEntryPtr>::iterator it);
+
+    // 条目占用的字节数, 包括已计入的压缩内容
+    static size_t entrySize(const FileEntry &entry);
+
+    static const size_t SHARD_NUM = 16;
+
+    size_t capacity_;
+    size_t shard_capacity_;
+    size_t max_file_size_;
+    int revalidate_ms_;
+    bool compress_;
+    Shard shards_[SHARD_NUM];
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> evictions_;
+};
+
+
+#endif //FILE_CACHE_H
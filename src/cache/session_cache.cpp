@@ -0,0 +1,117 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "session_cache.h"
+
+#include <sys/random.h>
+#include <chrono>
+#include <functional>
+
+namespace {
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+SessionCache::SessionCache() {
+    max_sessions_ = 0;
+    shard_sessions_ = 0;
+    ttl_s_ = 0;
+}
+
+SessionCache *SessionCache::getInstance() {
+    static SessionCache instance;
+    return &instance;
+}
+
+void SessionCache::init(size_t max_sessions, int ttl_s) {
+    clear();
+    max_sessions_ = max_sessions;
+    shard_sessions_ = (max_sessions + SHARD_NUM - 1) / SHARD_NUM;
+    ttl_s_ = ttl_s;
+}
+
+SessionCache::Shard &SessionCache::getShard(const std::string &id) {
+    return shards_[std::hash<std::string>()(id) % SHARD_NUM];
+}
+
+std::string SessionCache::create(const std::string &name) {
+    if (max_sessions_ == 0) {
+        return "";
+    }
+    // 会话号相当于密码, 必须不可预测
+    unsigned char bytes[ID_BYTES];
+    if (getrandom(bytes, sizeof(bytes), 0) != static_cast<ssize_t>(sizeof(bytes))) {
+        return "";
+    }
+    static const char HEX[] = "0123456789abcdef";
+    std::string id(ID_BYTES * 2, '\0');
+    for (size_t i = 0; i < ID_BYTES; ++i) {
+        id[i * 2] = HEX[bytes[i] >> 4];
+        id[i * 2 + 1] = HEX[bytes[i] & 0xf];
+    }
+    Shard &shard = getShard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.lru.push_front({id, name, nowMs() + static_cast<int64_t>(ttl_s_) * 1000});
+    shard.index[id] = shard.lru.begin();
+    while (shard.lru.size() > shard_sessions_) {
+        shard.index.erase(shard.lru.back().id);
+        shard.lru.pop_back();
+    }
+    return id;
+}
+
+bool SessionCache::check(const std::string &id, const std::string &name) {
+    // 格式不对的会话号不需要查找
+    if (max_sessions_ == 0 || id.size() != ID_BYTES * 2) {
+        return false;
+    }
+    Shard &shard = getShard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(id);
+    if (it == shard.index.end()) {
+        return false;
+    }
+    if (nowMs() >= it->second->expire_ms) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return it->second->name == name;
+}
+
+void SessionCache::remove(const std::string &id) {
+    Shard &shard = getShard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(id);
+    if (it != shard.index.end()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+}
+
+std::string SessionCache::makeCookie(const std::string &id) const {
+    // HttpOnly: 脚本读不到会话号; SameSite=Lax: 其他站点的POST不会带上
+    return std::string(COOKIE_NAME) + "=" + id + "; Max-Age=" + std::to_string(ttl_s_) +
+           "; Path=/; HttpOnly; SameSite=Lax";
+}
+
+void SessionCache::clear() {
+    for (Shard &shard: shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.lru.clear();
+        shard.index.clear();
+    }
+}
+
+size_t SessionCache::size() {
+    size_t size = 0;
+    for (Shard &shard: shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size += shard.lru.size();
+    }
+    return size;
+}
@@ -0,0 +1,75 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef SESSION_CACHE_H
+#define SESSION_CACHE_H
+#pragma once
+
+#include <stdint.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// 登录会话: 验证成功后生成随机的会话号, 通过Cookie交给客户端
+// 之后带着有效会话号登录同一个用户的请求不再验证密码
+// 会话只保存在内存中, 按会话号哈希分片, 超过数量上限时淘汰最久未使用的会话, 重启后全部失效
+class SessionCache {
+public:
+    static SessionCache *getInstance();
+
+    /// 初始化
+    /// @param max_sessions 最多保存的会话数, 0表示关闭会话
+    /// @param ttl_s 会话从创建开始的有效期, 也是Cookie的Max-Age
+    void init(size_t max_sessions, int ttl_s = 1800);
+
+    bool isOpen() const { return max_sessions_ > 0; }
+
+    // 为用户创建会话, 返回会话号; 关闭会话或者无法生成随机数时返回空串
+    std::string create(const std::string &name);
+
+    // 会话号有效且属于该用户
+    bool check(const std::string &id, const std::string &name);
+
+    void remove(const std::string &id);
+
+    // 响应中Set-Cookie的值
+    std::string makeCookie(const std::string &id) const;
+
+    void clear();
+
+    size_t size();
+
+    static constexpr const char *COOKIE_NAME = "session";
+
+private:
+    SessionCache();
+
+    ~SessionCache() = default;
+
+    struct Session {
+        std::string id;
+        std::string name;
+        int64_t expire_ms;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Session> lru; // 最近使用的在前
+        std::unordered_map<std::string, std::list<Session>::iterator> index;
+    };
+
+    Shard &getShard(const std::string &id);
+
+    static const size_t SHARD_NUM = 16;
+    static const size_t ID_BYTES = 16; // 会话号的随机字节数, 十六进制表示为32个字符
+
+    size_t max_sessions_;
+    size_t shard_sessions_;
+    int ttl_s_;
+    Shard shards_[SHARD_NUM];
+};
+
+
+#endif //SESSION_CACHE_H
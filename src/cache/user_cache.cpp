@@ -0,0 +1,177 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "user_cache.h"
+
+#include <chrono>
+
+namespace {
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+UserCache::UserCache() {
+    max_entries_ = 0;
+    shard_entries_ = 0;
+    ttl_ms_ = 0;
+    negative_ttl_ms_ = 0;
+    hits_ = 0;
+    negative_hits_ = 0;
+    misses_ = 0;
+    coalesced_ = 0;
+    invalidations_ = 0;
+}
+
+UserCache *UserCache::getInstance() {
+    static UserCache instance;
+    return &instance;
+}
+
+void UserCache::init(const Options &options) {
+    clear();
+    max_entries_ = options.max_entries;
+    shard_entries_ = (options.max_entries + SHARD_NUM - 1) / SHARD_NUM;
+    ttl_ms_ = options.ttl_ms;
+    negative_ttl_ms_ = options.negative_ttl_ms;
+}
+
+UserCache::Shard &UserCache::getShard(const std::string &name) {
+    return shards_[std::hash<std::string>()(name) % SHARD_NUM];
+}
+
+bool UserCache::find(Shard &shard, const std::string &name, Result &result) {
+    auto it = shard.index.find(name);
+    if (it == shard.index.end()) {
+        return false;
+    }
+    const Entry &entry = *it->second;
+    if (nowMs() >= entry.expire_ms) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    if (entry.found) {
+        ++hits_;
+        result = {FOUND, entry.password};
+    } else {
+        ++negative_hits_;
+        result = {NOT_FOUND, ""};
+    }
+    return true;
+}
+
+UserCache::Result UserCache::get(const std::string &name) {
+    Result result{MISS, ""};
+    if (max_entries_ == 0) {
+        return result;
+    }
+    Shard &shard = getShard(name);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    find(shard, name, result);
+    return result;
+}
+
+UserCache::Result UserCache::lookup(const std::string &name, Waiter waiter) {
+    Result result{LOAD, ""};
+    // 关闭缓存时每个请求都查询数据库, 也不合并
+    if (max_entries_ == 0) {
+        ++misses_;
+        return result;
+    }
+    Shard &shard = getShard(name);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (find(shard, name, result)) {
+        return result;
+    }
+    auto it = shard.flights.find(name);
+    if (it != shard.flights.end()) {
+        it->second.waiters.push_back(std::move(waiter));
+        ++coalesced_;
+        return {WAIT, ""};
+    }
+    shard.flights.emplace(name, Flight());
+    ++misses_;
+    return result;
+}
+
+std::vector<UserCache::Waiter> UserCache::land(const std::string &name, const Entry *entry) {
+    Shard &shard = getShard(name);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.flights.find(name);
+    if (it == shard.flights.end()) {
+        return {};
+    }
+    std::vector<Waiter> waiters = std::move(it->second.waiters);
+    bool stale = it->second.stale;
+    shard.flights.erase(it);
+    if (entry == nullptr || stale) {
+        return waiters;
+    }
+    auto old = shard.index.find(name);
+    if (old != shard.index.end()) {
+        shard.lru.erase(old->second);
+        shard.index.erase(old);
+    }
+    shard.lru.push_front(*entry);
+    shard.index[name] = shard.lru.begin();
+    // 淘汰最久未使用的用户名, 大量随机用户名的登录请求也不会让缓存无限增长
+    while (shard.lru.size() > shard_entries_) {
+        shard.index.erase(shard.lru.back().name);
+        shard.lru.pop_back();
+    }
+    return waiters;
+}
+
+void UserCache::fill(const std::string &name, bool found, const std::string &password) {
+    Entry entry{name, found, found ? password : "", nowMs() + (found ? ttl_ms_ : negative_ttl_ms_)};
+    Result result{found ? FOUND : NOT_FOUND, entry.password};
+    // 回调在锁外调用, 等待者可以再次访问缓存
+    for (Waiter &waiter: land(name, &entry)) {
+        waiter(result);
+    }
+}
+
+void UserCache::fail(const std::string &name) {
+    Result result{ERROR, ""};
+    for (Waiter &waiter: land(name, nullptr)) {
+        waiter(result);
+    }
+}
+
+void UserCache::invalidate(const std::string &name) {
+    Shard &shard = getShard(name);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(name);
+    if (it != shard.index.end()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+    // 查询可能在注册之前读到了旧的结果
+    auto flight = shard.flights.find(name);
+    if (flight != shard.flights.end()) {
+        flight->second.stale = true;
+    }
+    ++invalidations_;
+}
+
+void UserCache::clear() {
+    // 正在进行的查询保留, 等待者仍然会得到结果
+    for (Shard &shard: shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.lru.clear();
+        shard.index.clear();
+    }
+}
+
+UserCache::Stats UserCache::getStats() {
+    Stats stats = {hits_, negative_hits_, misses_, coalesced_, invalidations_, 0};
+    for (Shard &shard: shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        stats.entries += shard.lru.size();
+    }
+    return stats;
+}
@@ -0,0 +1,131 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef USER_CACHE_H
+#define USER_CACHE_H
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 用户名到密码的缓存, 放在登录验证的数据库查询之前
+// - 存在的用户缓存ttl_ms, 不存在的用户名(负缓存)缓存negative_ttl_ms, 按用户名哈希分片, 每个分片LRU淘汰
+// - 未命中时同一个用户名只有一个请求(加载者)查询数据库, 其他请求登记回调, 查询完成后一起得到结果
+// - 注册后调用invalidate, 正在进行的查询结果只通知等待者, 不放入缓存
+class UserCache {
+public:
+    enum STATUS {
+        FOUND, // 用户存在, password有效
+        NOT_FOUND, // 用户不存在
+        MISS, // 未命中(只由get返回)
+        LOAD, // 未命中, 调用者成为加载者, 查询后必须调用fill或fail
+        WAIT, // 其他请求正在查询, 结果通过回调通知
+        ERROR, // 查询失败(只在回调中出现)
+    };
+
+    struct Result {
+        STATUS status;
+        std::string password;
+    };
+
+    // 等待查询结果的回调, 在加载者的线程中调用
+    using Waiter = std::function<void(const Result &)>;
+
+    struct Options {
+        size_t max_entries = 65536; // 最多缓存的用户名数(包括不存在的), 0表示关闭缓存
+        int ttl_ms = 60000; // 存在的用户的有效期, 数据库中修改的密码最多这么久后生效
+        int negative_ttl_ms = 10000; // 不存在的用户名的有效期
+    };
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t negative_hits; // 命中不存在的用户名
+        uint64_t misses; // 查询数据库的次数
+        uint64_t coalesced; // 等待其他请求查询结果的次数
+        uint64_t invalidations;
+        size_t entries;
+    };
+
+    static UserCache *getInstance();
+
+    void init(const Options &options);
+
+    bool isOpen() const { return max_entries_ > 0; }
+
+    // 只查找缓存, 不会成为加载者
+    Result get(const std::string &name);
+
+    /// 查找缓存, 未命中时返回LOAD或WAIT
+    /// @param waiter 返回WAIT时, 查询完成后以结果调用; 其他情况不会调用
+    Result lookup(const std::string &name, Waiter waiter);
+
+    // 加载者查询成功, 缓存结果并通知等待者
+    void fill(const std::string &name, bool found, const std::string &password);
+
+    // 加载者查询失败, 不缓存, 等待者得到ERROR
+    void fail(const std::string &name);
+
+    // 用户注册或修改后使缓存失效
+    void invalidate(const std::string &name);
+
+    void clear();
+
+    Stats getStats();
+
+private:
+    UserCache();
+
+    ~UserCache() = default;
+
+    struct Entry {
+        std::string name;
+        bool found;
+        std::string password;
+        int64_t expire_ms;
+    };
+
+    // 正在查询的用户名
+    struct Flight {
+        std::vector<Waiter> waiters;
+        bool stale = false; // 查询期间被invalidate, 结果不放入缓存
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru; // 最近使用的在前
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        std::unordered_map<std::string, Flight> flights;
+    };
+
+    Shard &getShard(const std::string &name);
+
+    // 在分片锁内查找未过期的条目, 过期的条目删除
+    bool find(Shard &shard, const std::string &name, Result &result);
+
+    // 结束查询, 返回等待者
+    std::vector<Waiter> land(const std::string &name, const Entry *entry);
+
+    static const size_t SHARD_NUM = 16;
+
+    size_t max_entries_;
+    size_t shard_entries_;
+    int ttl_ms_;
+    int negative_ttl_ms_;
+    Shard shards_[SHARD_NUM];
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> negative_hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> coalesced_;
+    std::atomic<uint64_t> invalidations_;
+};
+
+
+#endif //USER_CACHE_H
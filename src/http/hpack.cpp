@@ -0,0 +1,428 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "hpack.h"
+
+#include <array>
+#include <unordered_map>
+
+namespace {
+// 静态表(RFC 7541 Appendix A), 下标从1开始
+const HeaderField STATIC_TABLE[] = {
+    {"", ""},
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+const size_t STATIC_TABLE_LEN = sizeof(STATIC_TABLE) / sizeof(STATIC_TABLE[0]) - 1;
+// 每个动态表条目的额外开销
+const size_t ENTRY_OVERHEAD = 32;
+
+struct HuffmanCode {
+    uint32_t code;
+    uint8_t len;
+};
+// 0-255为字节, 256为EOS
+const HuffmanCode HUFFMAN_CODES[257] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+    {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+    {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+    {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+    {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+    {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+    {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+    {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+    {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+    {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+    {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+    {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+    {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+    {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+    {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+    {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+    {0x3fffffff, 30},
+};
+
+// Huffman解码树, 叶子结点保存符号
+struct HuffmanTree {
+    struct Node {
+        int child[2] = {-1, -1};
+        int symbol = -1;
+    };
+    std::vector<Node> nodes;
+
+    HuffmanTree() {
+        nodes.reserve(512);
+        nodes.emplace_back();
+        for (int sym = 0; sym < 257; ++sym) {
+            int cur = 0;
+            for (int i = HUFFMAN_CODES[sym].len - 1; i >= 0; --i) {
+                int bit = (HUFFMAN_CODES[sym].code >> i) & 1;
+                if (nodes[cur].child[bit] < 0) {
+                    nodes[cur].child[bit] = static_cast<int>(nodes.size());
+                    nodes.emplace_back();
+                }
+                cur = nodes[cur].child[bit];
+            }
+            nodes[cur].symbol = sym;
+        }
+    }
+};
+
+const HuffmanTree &huffmanTree() {
+    static const HuffmanTree tree;
+    return tree;
+}
+} // namespace
+
+bool huffmanDecode(const uint8_t *data, size_t len, std::string &out) {
+    const auto &nodes = huffmanTree().nodes;
+    int cur = 0;
+    // 自上一个符号以来读入的位数, 以及这些位是否全为1(填充必须是EOS的前缀)
+    int pending_bits = 0;
+    bool all_ones = true;
+    for (size_t i = 0; i < len; ++i) {
+        for (int b = 7; b >= 0; --b) {
+            int bit = (data[i] >> b) & 1;
+            cur = nodes[cur].child[bit];
+            if (cur < 0) {
+                return false;
+            }
+            ++pending_bits;
+            all_ones = all_ones && bit == 1;
+            if (nodes[cur].symbol >= 0) {
+                // 字符串中出现EOS是解码错误
+                if (nodes[cur].symbol == 256) {
+                    return false;
+                }
+                out.push_back(static_cast<char>(nodes[cur].symbol));
+                cur = 0;
+                pending_bits = 0;
+                all_ones = true;
+            }
+        }
+    }
+    // 填充最多7位且全为1
+    return pending_bits < 8 && all_ones;
+}
+
+HPackDecoder::HPackDecoder(size_t max_table_size, size_t max_list_size) {
+    table_size_ = 0;
+    table_capacity_ = max_table_size;
+    max_table_size_ = max_table_size;
+    max_list_size_ = max_list_size;
+}
+
+void HPackDecoder::setMaxTableSize(size_t size) {
+    max_table_size_ = size;
+    if (table_capacity_ > size) {
+        table_capacity_ = size;
+        evict(table_capacity_);
+    }
+}
+
+bool HPackDecoder::decode(const uint8_t *data, size_t len, HeaderList &headers) {
+    const uint8_t *pos = data;
+    const uint8_t *end = data + len;
+    // 表大小更新只能出现在header block开头
+    bool allow_size_update = true;
+    // 一个字节的索引可以引用接近表大小的条目, 只限制header block的长度不够, 按解码结果计算
+    size_t list_size = 0;
+    auto withinLimit = [&](const HeaderField &field) {
+        list_size += field.first.size() + field.second.size() + 32;
+        return list_size <= max_list_size_;
+    };
+    while (pos < end) {
+        uint8_t first = *pos;
+        HeaderField field;
+        uint64_t index = 0;
+        if (first & 0x80) {
+            // 1xxxxxxx: 索引头部字段
+            if (!decodeInteger(pos, end, 7, index) || index == 0 || !getField(index, field) ||
+                !withinLimit(field)) {
+                return false;
+            }
+            headers.push_back(std::move(field));
+            allow_size_update = false;
+            continue;
+        }
+        if ((first & 0xe0) == 0x20) {
+            // 001xxxxx: 动态表大小更新
+            if (!allow_size_update || !decodeInteger(pos, end, 5, index) || index > max_table_size_) {
+                return false;
+            }
+            table_capacity_ = index;
+            evict(table_capacity_);
+            continue;
+        }
+        // 01xxxxxx: 增量索引的字面量
+        // 0000xxxx: 不索引的字面量, 0001xxxx: 永不索引的字面量
+        bool incremental = (first & 0xc0) == 0x40;
+        if (!decodeInteger(pos, end, incremental ? 6 : 4, index)) {
+            return false;
+        }
+        if (index == 0) {
+            if (!decodeString(pos, end, field.first)) {
+                return false;
+            }
+        } else {
+            HeaderField named;
+            if (!getField(index, named)) {
+                return false;
+            }
+            field.first = std::move(named.first);
+        }
+        if (!decodeString(pos, end, field.second) || !withinLimit(field)) {
+            return false;
+        }
+        if (incremental) {
+            addField(field);
+        }
+        headers.push_back(std::move(field));
+        allow_size_update = false;
+    }
+    return true;
+}
+
+bool HPackDecoder::decodeInteger(const uint8_t *&pos, const uint8_t *end, int prefix_bits, uint64_t &value) {
+    if (pos >= end) {
+        return false;
+    }
+    const uint64_t prefix_max = (1u << prefix_bits) - 1;
+    value = *pos & prefix_max;
+    ++pos;
+    if (value < prefix_max) {
+        return true;
+    }
+    // 超出前缀的部分每字节7位, 最高位表示后面还有
+    int shift = 0;
+    while (pos < end) {
+        uint8_t byte = *pos++;
+        value += static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+        shift += 7;
+        // 防止溢出, 合法的头部不可能这么大
+        if (shift > 28) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool HPackDecoder::decodeString(const uint8_t *&pos, const uint8_t *end, std::string &str) {
+    if (pos >= end) {
+        return false;
+    }
+    bool huffman = (*pos & 0x80) != 0;
+    uint64_t len = 0;
+    if (!decodeInteger(pos, end, 7, len) || len > static_cast<uint64_t>(end - pos)) {
+        return false;
+    }
+    str.clear();
+    if (huffman) {
+        if (!huffmanDecode(pos, len, str)) {
+            return false;
+        }
+    } else {
+        str.assign(reinterpret_cast<const char *>(pos), len);
+    }
+    pos += len;
+    return true;
+}
+
+bool HPackDecoder::getField(uint64_t index, HeaderField &field) const {
+    if (index == 0) {
+        return false;
+    }
+    if (index <= STATIC_TABLE_LEN) {
+        field = STATIC_TABLE[index];
+        return true;
+    }
+    index -= STATIC_TABLE_LEN + 1;
+    if (index >= dynamic_table_.size()) {
+        return false;
+    }
+    field = dynamic_table_[index];
+    return true;
+}
+
+void HPackDecoder::addField(const HeaderField &field) {
+    size_t entry_size = field.first.size() + field.second.size() + ENTRY_OVERHEAD;
+    // 条目比整个表还大时, 清空表且不插入
+    if (entry_size > table_capacity_) {
+        evict(0);
+        return;
+    }
+    evict(table_capacity_ - entry_size);
+    dynamic_table_.push_front(field);
+    table_size_ += entry_size;
+}
+
+void HPackDecoder::evict(size_t limit) {
+    while (table_size_ > limit && !dynamic_table_.empty()) {
+        const HeaderField &oldest = dynamic_table_.back();
+        table_size_ -= oldest.first.size() + oldest.second.size() + ENTRY_OVERHEAD;
+        dynamic_table_.pop_back();
+    }
+}
+
+void HPackEncoder::encode(const HeaderList &headers, Buffer &buffer) {
+    // 静态表查找: 完全匹配 -> 下标, 名称匹配 -> 第一个同名下标
+    static const auto lookup = []() {
+        std::unordered_map<std::string, size_t> full, name;
+        for (size_t i = STATIC_TABLE_LEN; i >= 1; --i) {
+            full[STATIC_TABLE[i].first + '\0' + STATIC_TABLE[i].second] = i;
+            name[STATIC_TABLE[i].first] = i;
+        }
+        return std::make_pair(full, name);
+    }();
+    for (const auto &[key, value]: headers) {
+        auto full_it = lookup.first.find(key + '\0' + value);
+        if (full_it != lookup.first.end()) {
+            encodeInteger(full_it->second, 7, 0x80, buffer);
+            continue;
+        }
+        // 0000xxxx: 不索引的字面量
+        auto name_it = lookup.second.find(key);
+        if (name_it != lookup.second.end()) {
+            encodeInteger(name_it->second, 4, 0x00, buffer);
+        } else {
+            encodeInteger(0, 4, 0x00, buffer);
+            encodeString(key, buffer);
+        }
+        encodeString(value, buffer);
+    }
+}
+
+void HPackEncoder::encodeInteger(uint64_t value, int prefix_bits, uint8_t first_byte, Buffer &buffer) {
+    const uint64_t prefix_max = (1u << prefix_bits) - 1;
+    uint8_t bytes[16];
+    size_t n = 0;
+    if (value < prefix_max) {
+        bytes[n++] = first_byte | static_cast<uint8_t>(value);
+    } else {
+        bytes[n++] = first_byte | static_cast<uint8_t>(prefix_max);
+        value -= prefix_max;
+        while (value >= 0x80) {
+            bytes[n++] = static_cast<uint8_t>((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        bytes[n++] = static_cast<uint8_t>(value);
+    }
+    buffer.append(bytes, n);
+}
+
+void HPackEncoder::encodeString(const std::string &str, Buffer &buffer) {
+    // 不使用Huffman编码, 响应头部都很短
+    encodeInteger(str.size(), 7, 0x00, buffer);
+    buffer.append(str);
+}
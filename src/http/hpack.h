@@ -0,0 +1,74 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef HPACK_H
+#define HPACK_H
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer.h"
+
+// HTTP/2头部压缩(RFC 7541)
+using HeaderField = std::pair<std::string, std::string>;
+using HeaderList = std::vector<HeaderField>;
+
+// 解码器: 每个连接一个, 维护对端(客户端)的动态表
+class HPackDecoder {
+public:
+    /// @param max_table_size 本端SETTINGS_HEADER_TABLE_SIZE
+    /// @param max_list_size 解码后头部列表的大小上限(按RFC计算, 每个字段额外32字节)
+    explicit HPackDecoder(size_t max_table_size = 4096, size_t max_list_size = 64 * 1024);
+
+    ~HPackDecoder() = default;
+
+    /// 解码一个完整的header block
+    /// @param data header block起始位置
+    /// @param len header block长度
+    /// @param headers 解码出的头部, 按出现顺序追加
+    /// @return 失败或解码结果超过max_list_size时返回false, 对应COMPRESSION_ERROR, 连接必须关闭
+    bool decode(const uint8_t *data, size_t len, HeaderList &headers);
+
+    // 本端SETTINGS_HEADER_TABLE_SIZE, 对端的表大小更新不能超过该值
+    void setMaxTableSize(size_t size);
+
+private:
+    bool decodeInteger(const uint8_t *&pos, const uint8_t *end, int prefix_bits, uint64_t &value);
+
+    bool decodeString(const uint8_t *&pos, const uint8_t *end, std::string &str);
+
+    bool getField(uint64_t index, HeaderField &field) const;
+
+    void addField(const HeaderField &field);
+
+    // 淘汰最老的条目直到表大小不超过limit
+    void evict(size_t limit);
+
+    std::deque<HeaderField> dynamic_table_; // 动态表, 新条目在前
+    size_t table_size_; // 动态表当前大小(按RFC计算, 每个条目额外32字节)
+    size_t table_capacity_; // 动态表当前容量(对端通过size update调整)
+    size_t max_table_size_; // 容量上限(本端SETTINGS)
+    size_t max_list_size_; // 一个header block解码后的大小上限
+};
+
+// 编码器: 只使用静态表和不索引的字面量, 不维护动态表,
+// 因此无需关心对端的SETTINGS_HEADER_TABLE_SIZE
+class HPackEncoder {
+public:
+    static void encode(const HeaderList &headers, Buffer &buffer);
+
+private:
+    static void encodeInteger(uint64_t value, int prefix_bits, uint8_t first_byte, Buffer &buffer);
+
+    static void encodeString(const std::string &str, Buffer &buffer);
+};
+
+// Huffman解码(RFC 7541 Appendix B), 失败返回false
+bool huffmanDecode(const uint8_t *data, size_t len, std::string &out);
+
+#endif //HPACK_H
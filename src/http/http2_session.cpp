@@ -0,0 +1,705 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "http2_session.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "cache/session_cache.h"
+#include "logger/logger.h"
+
+namespace {
+// 客户端连接序言
+const char PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+const size_t PREFACE_LEN = sizeof(PREFACE) - 1;
+const size_t FRAME_HEADER_LEN = 9;
+const int64_t MAX_WINDOW = 0x7fffffff;
+
+// SETTINGS参数
+const uint16_t SETTINGS_ENABLE_PUSH = 0x2;
+const uint16_t SETTINGS_MAX_CONCURRENT_STREAMS = 0x3;
+const uint16_t SETTINGS_INITIAL_WINDOW_SIZE = 0x4;
+const uint16_t SETTINGS_MAX_FRAME_SIZE = 0x5;
+const uint16_t SETTINGS_MAX_HEADER_LIST_SIZE = 0x6;
+
+uint32_t readUint32(const uint8_t *p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+void writeUint32(uint8_t *p, uint32_t value) {
+    p[0] = static_cast<uint8_t>(value >> 24);
+    p[1] = static_cast<uint8_t>(value >> 16);
+    p[2] = static_cast<uint8_t>(value >> 8);
+    p[3] = static_cast<uint8_t>(value);
+}
+
+// HTTP2-Settings使用base64url编码且不带填充
+bool base64Decode(const std::string &src, std::string &dst) {
+    int value = 0, bits = 0;
+    for (char ch: src) {
+        int digit;
+        if (ch >= 'A' && ch <= 'Z') {
+            digit = ch - 'A';
+        } else if (ch >= 'a' && ch <= 'z') {
+            digit = ch - 'a' + 26;
+        } else if (ch >= '0' && ch <= '9') {
+            digit = ch - '0' + 52;
+        } else if (ch == '-' || ch == '+') {
+            digit = 62;
+        } else if (ch == '_' || ch == '/') {
+            digit = 63;
+        } else if (ch == '=') {
+            break;
+        } else {
+            return false;
+        }
+        value = (value << 6) | digit;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            dst.push_back(static_cast<char>((value >> bits) & 0xff));
+        }
+    }
+    return true;
+}
+
+// HTTP/2的头部都是小写, 转换成HttpRequest使用的形式: content-type -> Content-Type
+std::string canonicalKey(const std::string &key) {
+    std::string res = key;
+    bool upper = true;
+    for (char &ch: res) {
+        if (upper) {
+            ch = static_cast<char>(toupper(ch));
+        }
+        upper = (ch == '-');
+    }
+    return res;
+}
+
+// HttpResponse生成的HTTP/1.1头部("Name: value\r\n")转换成HTTP/2的字段, 名称改为小写
+void appendFields(std::string_view block, HeaderList &headers) {
+    while (!block.empty()) {
+        size_t end = block.find("\r\n");
+        std::string_view line = block.substr(0, end);
+        size_t colon = line.find(": ");
+        if (colon != std::string_view::npos) {
+            std::string name(line.substr(0, colon));
+            for (char &ch: name) {
+                ch = static_cast<char>(tolower(ch));
+            }
+            headers.emplace_back(std::move(name), std::string(line.substr(colon + 2)));
+        }
+        if (end == std::string_view::npos) {
+            break;
+        }
+        block.remove_prefix(end + 2);
+    }
+}
+} // namespace
+
+Http2Session::Http2Session(const std::string &src_dir) : src_dir_(src_dir), decoder_(4096, MAX_HEADER_LIST) {
+    preface_received_ = false;
+    goaway_ = false;
+    broken_ = false;
+    last_stream_id_ = 0;
+    continuation_stream_ = 0;
+    next_stream_ = 0;
+    peer_initial_window_ = 65535;
+    peer_max_frame_size_ = 16384;
+    send_window_ = 65535;
+}
+
+int Http2Session::checkPreface(const Buffer &buffer) {
+    size_t len = std::min(buffer.readableBytes(), PREFACE_LEN);
+    if (memcmp(buffer.peek(), PREFACE, len) != 0) {
+        return -1;
+    }
+    return len == PREFACE_LEN ? 1 : 0;
+}
+
+void Http2Session::start(Buffer &out) {
+    uint8_t payload[12];
+    payload[0] = 0;
+    payload[1] = SETTINGS_MAX_CONCURRENT_STREAMS;
+    writeUint32(payload + 2, MAX_CONCURRENT_STREAMS);
+    // 只是提示, 超过时解码器仍会以COMPRESSION_ERROR关闭连接
+    payload[6] = 0;
+    payload[7] = SETTINGS_MAX_HEADER_LIST_SIZE;
+    writeUint32(payload + 8, MAX_HEADER_LIST);
+    writeFrameHeader(out, sizeof(payload), SETTINGS, 0, 0);
+    out.append(payload, sizeof(payload));
+}
+
+bool Http2Session::startUpgrade(const std::string &settings, const HttpRequest &request, Buffer &out) {
+    std::string payload;
+    if (!base64Decode(settings, payload) || payload.size() % 6 != 0 ||
+        applySettings(reinterpret_cast<const uint8_t *>(payload.data()), payload.size()) != NO_ERROR) {
+        return false;
+    }
+    start(out);
+    // 升级前的请求隐式地成为stream 1, 且对端已经半关闭
+    auto stream = std::make_unique<Stream>();
+    stream->id = 1;
+    stream->send_window = peer_initial_window_;
+    stream->end_stream = true;
+    stream->headers_done = true;
+    Stream &s = *stream;
+    streams_[1] = std::move(stream);
+    last_stream_id_ = 1;
+    dispatch(s, request, true, out);
+    return true;
+}
+
+bool Http2Session::isAlive() const {
+    return !broken_ && !(goaway_ && streams_.empty());
+}
+
+void Http2Session::onRead(Buffer &in, Buffer &out) {
+    if (!preface_received_ && !broken_) {
+        int ret = checkPreface(in);
+        if (ret == 0) {
+            return;
+        } else if (ret < 0) {
+            connectionError(out, PROTOCOL_ERROR);
+        } else {
+            in.retrieve(PREFACE_LEN);
+            preface_received_ = true;
+        }
+    }
+    while (!broken_ && in.readableBytes() >= FRAME_HEADER_LEN) {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(in.peek());
+        size_t len = (static_cast<size_t>(p[0]) << 16) | (static_cast<size_t>(p[1]) << 8) | p[2];
+        uint8_t type = p[3];
+        uint8_t flags = p[4];
+        uint32_t stream_id = readUint32(p + 5) & 0x7fffffff;
+        if (len > MAX_FRAME_SIZE) {
+            connectionError(out, FRAME_SIZE_ERROR);
+            break;
+        }
+        // 帧不完整, 等待下一次读
+        if (in.readableBytes() < FRAME_HEADER_LEN + len) {
+            break;
+        }
+        bool ok = handleFrame(type, flags, stream_id, p + FRAME_HEADER_LEN, len, out);
+        in.retrieve(FRAME_HEADER_LEN + len);
+        if (!ok) {
+            break;
+        }
+    }
+    if (broken_) {
+        in.retrieveAll();
+    }
+}
+
+bool Http2Session::handleFrame(uint8_t type, uint8_t flags, uint32_t stream_id,
+                               const uint8_t *payload, size_t len, Buffer &out) {
+    // 头部块必须连续, 中间不能插入其他帧
+    if (continuation_stream_ != 0 && (type != CONTINUATION || stream_id != continuation_stream_)) {
+        return connectionError(out, PROTOCOL_ERROR);
+    }
+    switch (type) {
+        case DATA:
+            return handleData(flags, stream_id, payload, len, out);
+        case HEADERS:
+            return handleHeaders(flags, stream_id, payload, len, out);
+        case PRIORITY:
+            // 不支持优先级, 只做合法性检查
+            if (stream_id == 0) {
+                return connectionError(out, PROTOCOL_ERROR);
+            }
+            if (len != 5) {
+                return connectionError(out, FRAME_SIZE_ERROR);
+            }
+            return true;
+        case RST_STREAM:
+            if (stream_id == 0 || stream_id > last_stream_id_) {
+                return connectionError(out, PROTOCOL_ERROR);
+            }
+            if (len != 4) {
+                return connectionError(out, FRAME_SIZE_ERROR);
+            }
+            streams_.erase(stream_id);
+            return true;
+        case SETTINGS:
+            return handleSettings(flags, stream_id, payload, len, out);
+        case PUSH_PROMISE:
+            // 客户端不能推送
+            return connectionError(out, PROTOCOL_ERROR);
+        case PING:
+            if (stream_id != 0) {
+                return connectionError(out, PROTOCOL_ERROR);
+            }
+            if (len != 8) {
+                return connectionError(out, FRAME_SIZE_ERROR);
+            }
+            if (!(flags & FLAG_ACK)) {
+                writeFrameHeader(out, 8, PING, FLAG_ACK, 0);
+                out.append(payload, 8);
+            }
+            return true;
+        case GOAWAY:
+            if (stream_id != 0) {
+                return connectionError(out, PROTOCOL_ERROR);
+            }
+            goaway_ = true;
+            return true;
+        case WINDOW_UPDATE:
+            return handleWindowUpdate(stream_id, payload, len, out);
+        case CONTINUATION:
+            return handleContinuation(flags, stream_id, payload, len, out);
+        default:
+            // 未知类型的帧必须忽略
+            return true;
+    }
+}
+
+bool Http2Session::handleHeaders(uint8_t flags, uint32_t stream_id,
+                                 const uint8_t *payload, size_t len, Buffer &out) {
+    // 客户端发起的流id必须是奇数
+    if (stream_id == 0 || (stream_id & 1) == 0) {
+        return connectionError(out, PROTOCOL_ERROR);
+    }
+    size_t pad = 0;
+    if (flags & FLAG_PADDED) {
+        if (len < 1) {
+            return connectionError(out, FRAME_SIZE_ERROR);
+        }
+        pad = payload[0];
+        payload += 1;
+        len -= 1;
+    }
+    if (flags & FLAG_PRIORITY) {
+        if (len < 5) {
+            return connectionError(out, FRAME_SIZE_ERROR);
+        }
+        payload += 5;
+        len -= 5;
+    }
+    if (pad > len) {
+        return connectionError(out, PROTOCOL_ERROR);
+    }
+    len -= pad;
+
+    Stream *s = nullptr;
+    auto it = streams_.find(stream_id);
+    if (it != streams_.end()) {
+        // 已有流上的HEADERS只能是带END_STREAM的trailer
+        s = it->second.get();
+        if (s->end_stream) {
+            return connectionError(out, STREAM_CLOSED);
+        }
+        if (!(flags & FLAG_END_STREAM)) {
+            return connectionError(out, PROTOCOL_ERROR);
+        }
+    } else {
+        // 流id只能递增, 否则是在复用已关闭的流
+        if (stream_id <= last_stream_id_) {
+            return connectionError(out, STREAM_CLOSED);
+        }
+        last_stream_id_ = stream_id;
+        auto stream = std::make_unique<Stream>();
+        stream->id = stream_id;
+        stream->send_window = peer_initial_window_;
+        // 即使要拒绝也必须解码头部块, 保持HPACK动态表同步
+        stream->refused = goaway_ || streams_.size() >= MAX_CONCURRENT_STREAMS;
+        s = stream.get();
+        streams_[stream_id] = std::move(stream);
+    }
+    s->end_stream = (flags & FLAG_END_STREAM) != 0;
+    s->header_block.assign(reinterpret_cast<const char *>(payload), len);
+    if (flags & FLAG_END_HEADERS) {
+        return endHeaders(*s, out);
+    }
+    continuation_stream_ = stream_id;
+    return true;
+}
+
+bool Http2Session::handleContinuation(uint8_t flags, uint32_t stream_id,
+                                      const uint8_t *payload, size_t len, Buffer &out) {
+    if (continuation_stream_ == 0 || stream_id != continuation_stream_) {
+        return connectionError(out, PROTOCOL_ERROR);
+    }
+    Stream &s = *streams_[stream_id];
+    s.header_block.append(reinterpret_cast<const char *>(payload), len);
+    if (s.header_block.size() > MAX_HEADER_BLOCK) {
+        return connectionError(out, ENHANCE_YOUR_CALM);
+    }
+    if (flags & FLAG_END_HEADERS) {
+        continuation_stream_ = 0;
+        return endHeaders(s, out);
+    }
+    return true;
+}
+
+bool Http2Session::endHeaders(Stream &stream, Buffer &out) {
+    HeaderList fields;
+    bool ok = decoder_.decode(reinterpret_cast<const uint8_t *>(stream.header_block.data()),
+                              stream.header_block.size(), fields);
+    std::string().swap(stream.header_block);
+    if (!ok) {
+        return connectionError(out, COMPRESSION_ERROR);
+    }
+    if (stream.refused) {
+        writeRstStream(out, stream.id, REFUSED_STREAM);
+        streams_.erase(stream.id);
+        return true;
+    }
+    if (!stream.headers_done) {
+        stream.headers_done = true;
+        for (auto &[key, value]: fields) {
+            if (key == ":method") {
+                stream.method = std::move(value);
+            } else if (key == ":path") {
+                stream.path = std::move(value);
+            } else if (key == "cookie" && stream.headers.count("Cookie")) {
+                // HTTP/2可以把Cookie拆成多个字段发送, 按"; "拼回一个, 总长度受解码器的MAX_HEADER_LIST限制
+                stream.headers["Cookie"] += "; " + value;
+            } else if (!key.empty() && key[0] != ':') {
+                stream.headers[canonicalKey(key)] = std::move(value);
+            }
+        }
+    }
+    if (stream.end_stream) {
+        finishRequest(stream, out);
+    }
+    return true;
+}
+
+bool Http2Session::handleData(uint8_t flags, uint32_t stream_id,
+                              const uint8_t *payload, size_t len, Buffer &out) {
+    if (stream_id == 0) {
+        return connectionError(out, PROTOCOL_ERROR);
+    }
+    // 整个载荷(包括填充)都计入流控, 连接级窗口立即归还
+    if (len > 0) {
+        writeWindowUpdate(out, 0, len);
+    }
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end() || it->second->end_stream) {
+        if (stream_id > last_stream_id_) {
+            return connectionError(out, PROTOCOL_ERROR);
+        }
+        writeRstStream(out, stream_id, STREAM_CLOSED);
+        return true;
+    }
+    Stream &s = *it->second;
+    size_t pad = 0;
+    const size_t flow_len = len;
+    if (flags & FLAG_PADDED) {
+        if (len < 1) {
+            return connectionError(out, FRAME_SIZE_ERROR);
+        }
+        pad = payload[0];
+        payload += 1;
+        len -= 1;
+    }
+    if (pad > len) {
+        return connectionError(out, PROTOCOL_ERROR);
+    }
+    s.body.append(reinterpret_cast<const char *>(payload), len - pad);
+    if (s.body.size() > MAX_REQUEST_BODY) {
+        writeRstStream(out, stream_id, CANCEL);
+        streams_.erase(it);
+        return true;
+    }
+    if (flags & FLAG_END_STREAM) {
+        s.end_stream = true;
+        finishRequest(s, out);
+    } else if (flow_len > 0) {
+        writeWindowUpdate(out, stream_id, flow_len);
+    }
+    return true;
+}
+
+bool Http2Session::handleSettings(uint8_t flags, uint32_t stream_id,
+                                  const uint8_t *payload, size_t len, Buffer &out) {
+    if (stream_id != 0) {
+        return connectionError(out, PROTOCOL_ERROR);
+    }
+    if (flags & FLAG_ACK) {
+        if (len != 0) {
+            return connectionError(out, FRAME_SIZE_ERROR);
+        }
+        return true;
+    }
+    if (len % 6 != 0) {
+        return connectionError(out, FRAME_SIZE_ERROR);
+    }
+    ERROR_CODE code = applySettings(payload, len);
+    if (code != NO_ERROR) {
+        return connectionError(out, code);
+    }
+    writeFrameHeader(out, 0, SETTINGS, FLAG_ACK, 0);
+    return true;
+}
+
+Http2Session::ERROR_CODE Http2Session::applySettings(const uint8_t *payload, size_t len) {
+    for (size_t i = 0; i + 6 <= len; i += 6) {
+        uint16_t id = static_cast<uint16_t>((payload[i] << 8) | payload[i + 1]);
+        uint32_t value = readUint32(payload + i + 2);
+        switch (id) {
+            case SETTINGS_ENABLE_PUSH:
+                if (value > 1) {
+                    return PROTOCOL_ERROR;
+                }
+                break;
+            case SETTINGS_INITIAL_WINDOW_SIZE: {
+                if (value > MAX_WINDOW) {
+                    return FLOW_CONTROL_ERROR;
+                }
+                // 初始窗口的变化作用于所有已打开的流
+                int64_t delta = static_cast<int64_t>(value) - peer_initial_window_;
+                for (auto &entry: streams_) {
+                    entry.second->send_window += delta;
+                    if (entry.second->send_window > MAX_WINDOW) {
+                        return FLOW_CONTROL_ERROR;
+                    }
+                }
+                peer_initial_window_ = value;
+                break;
+            }
+            case SETTINGS_MAX_FRAME_SIZE:
+                if (value < 16384 || value > 16777215) {
+                    return PROTOCOL_ERROR;
+                }
+                peer_max_frame_size_ = value;
+                break;
+            default:
+                // 编码器不使用动态表, HEADER_TABLE_SIZE无需处理; 未知参数忽略
+                break;
+        }
+    }
+    return NO_ERROR;
+}
+
+bool Http2Session::handleWindowUpdate(uint32_t stream_id, const uint8_t *payload, size_t len, Buffer &out) {
+    if (len != 4) {
+        return connectionError(out, FRAME_SIZE_ERROR);
+    }
+    uint32_t increment = readUint32(payload) & 0x7fffffff;
+    if (stream_id == 0) {
+        if (increment == 0) {
+            return connectionError(out, PROTOCOL_ERROR);
+        }
+        send_window_ += increment;
+        if (send_window_ > MAX_WINDOW) {
+            return connectionError(out, FLOW_CONTROL_ERROR);
+        }
+        return true;
+    }
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end()) {
+        // 已关闭的流上可能还会收到WINDOW_UPDATE
+        return true;
+    }
+    Stream &s = *it->second;
+    s.send_window += increment;
+    if (increment == 0 || s.send_window > MAX_WINDOW) {
+        writeRstStream(out, stream_id, increment == 0 ? PROTOCOL_ERROR : FLOW_CONTROL_ERROR);
+        streams_.erase(it);
+    }
+    return true;
+}
+
+void Http2Session::finishRequest(Stream &stream, Buffer &out) {
+    auto request = std::make_unique<HttpRequest>();
+    bool parsed = request->parse(stream.method, stream.path, stream.headers, stream.body);
+    if (parsed && request->needVerify() && !request->tryVerify()) {
+        // 登录/注册要访问用户存储, 不在当前线程等待, 流先挂起, 其他流照常处理
+        stream.request = std::move(request);
+        verifying_.push_back(stream.id);
+        return;
+    }
+    dispatch(stream, *request, parsed, out);
+}
+
+CoTask<> Http2Session::verifyAsync(Buffer &out) {
+    std::vector<uint32_t> ids;
+    ids.swap(verifying_);
+    for (uint32_t id: ids) {
+        auto it = streams_.find(id);
+        if (it == streams_.end() || !it->second->request) {
+            continue;
+        }
+        Stream &stream = *it->second;
+        co_await stream.request->verifyAsync();
+        dispatch(stream, *stream.request, true, out);
+        stream.request.reset();
+    }
+}
+
+void Http2Session::dispatch(Stream &stream, const HttpRequest &request, bool parsed, Buffer &out) {
+    std::string path = request.path();
+    HttpResponse &response = stream.response;
+    response.init(src_dir_, path, true, parsed ? 200 : 400);
+    response.setAcceptEncoding(request.getHeader("accept-encoding"));
+    // 条件请求和范围请求只对GET有意义
+    if (request.method() == "GET") {
+        response.setRange(request.getHeader("range"), request.getHeader("if-range"));
+        response.setConditional(request.getHeader("if-none-match"), request.getHeader("if-modified-since"));
+    }
+    if (response.makeFile()) {
+        // 304/416没有响应体; 206只有一个范围
+        const auto &parts = response.getBodyParts();
+        off_t offset = parts.empty() ? 0 : parts[0].offset;
+        stream.data_left = parts.empty() ? 0 : parts[0].len;
+        // 大文件不映射, 发送时按帧读取, 每个流占用的内存和文件大小无关
+        stream.fd = response.getFileFd();
+        stream.offset = offset;
+        stream.data = response.getFile() ? response.getFile() + offset : nullptr;
+        if (stream.fd >= 0) {
+            posix_fadvise(stream.fd, offset, stream.data_left, POSIX_FADV_SEQUENTIAL);
+        }
+    } else {
+        stream.error_body = response.errorBody("File Not Found!");
+        stream.data = stream.error_body.data();
+        stream.data_left = stream.error_body.size();
+    }
+    int code = response.getStatusCode();
+    LOG_DEBUG("h2 stream[%u] %s %d", stream.id, path.c_str(), code);
+    HeaderList headers{{":status", std::to_string(code)}};
+    // 304只发送验证器
+    if (code != 304) {
+        headers.emplace_back("content-type", std::string(response.getFileType()));
+        headers.emplace_back("content-length", std::to_string(stream.data_left));
+    }
+    if (response.getContentEncoding()) {
+        headers.emplace_back("content-encoding", response.getContentEncoding());
+    }
+    appendFields(response.getValidators(), headers);
+    // 和HTTP/1.1相同, 只有原文件支持范围请求
+    if ((code == 200 && !response.getContentEncoding()) || code == 206) {
+        headers.emplace_back("accept-ranges", "bytes");
+    }
+    if (code == 206 || code == 416) {
+        headers.emplace_back("content-range", response.getContentRange());
+    }
+    if (!request.getNewSession().empty()) {
+        headers.emplace_back("set-cookie", SessionCache::getInstance()->makeCookie(request.getNewSession()));
+    }
+    writeHeaders(out, stream.id, headers, stream.data_left == 0);
+    stream.responding = true;
+}
+
+void Http2Session::flush(Buffer &out) {
+    // Upgrade时先只发送101和HEADERS, 等客户端序言(及其SETTINGS)到达后再发送DATA
+    if (broken_ || !preface_received_) {
+        return;
+    }
+    const size_t start = out.readableBytes();
+    bool progress = true;
+    // 每一轮给每个可发送的流一个DATA帧, 直到窗口耗尽或达到本次的发送量
+    while (progress && send_window_ > 0 && out.readableBytes() - start < SEND_QUANTUM) {
+        progress = false;
+        auto it = streams_.lower_bound(next_stream_);
+        for (size_t i = 0; i < streams_.size() && send_window_ > 0; ++i, ++it) {
+            if (it == streams_.end()) {
+                it = streams_.begin();
+            }
+            Stream &s = *it->second;
+            if (!s.responding || s.data_left == 0 || s.send_window <= 0) {
+                continue;
+            }
+            size_t len = std::min({s.data_left, static_cast<size_t>(peer_max_frame_size_),
+                                   static_cast<size_t>(s.send_window), static_cast<size_t>(send_window_)});
+            char chunk[FILE_CHUNK];
+            if (s.fd >= 0) {
+                len = std::min(len, FILE_CHUNK);
+                ssize_t n = pread(s.fd, chunk, len, s.offset);
+                if (n != static_cast<ssize_t>(len)) {
+                    // 文件在发送过程中被截断
+                    LOG_WARN("h2 stream[%u] read file error", s.id);
+                    writeRstStream(out, s.id, INTERNAL_ERROR);
+                    s.data_left = 0;
+                    continue;
+                }
+                s.offset += len;
+            }
+            bool last = (len == s.data_left);
+            writeFrameHeader(out, len, DATA, last ? FLAG_END_STREAM : 0, s.id);
+            if (s.fd >= 0) {
+                out.append(chunk, len);
+            } else {
+                out.append(s.data, len);
+                s.data += len;
+            }
+            s.data_left -= len;
+            s.send_window -= len;
+            send_window_ -= len;
+            next_stream_ = s.id + 1;
+            progress = true;
+            if (out.readableBytes() - start >= SEND_QUANTUM) {
+                break;
+            }
+        }
+    }
+    // 响应已发送完毕的流可以关闭了, 同时释放文件映射
+    for (auto it = streams_.begin(); it != streams_.end();) {
+        if (it->second->responding && it->second->data_left == 0) {
+            it = streams_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void Http2Session::writeFrameHeader(Buffer &out, size_t len, uint8_t type, uint8_t flags, uint32_t stream_id) {
+    uint8_t header[FRAME_HEADER_LEN];
+    header[0] = static_cast<uint8_t>(len >> 16);
+    header[1] = static_cast<uint8_t>(len >> 8);
+    header[2] = static_cast<uint8_t>(len);
+    header[3] = type;
+    header[4] = flags;
+    writeUint32(header + 5, stream_id & 0x7fffffff);
+    out.append(header, FRAME_HEADER_LEN);
+}
+
+void Http2Session::writeHeaders(Buffer &out, uint32_t stream_id, const HeaderList &headers, bool end_stream) {
+    Buffer block;
+    HPackEncoder::encode(headers, block);
+    // 头部块超过对端的最大帧时拆分为HEADERS + CONTINUATION
+    uint8_t type = HEADERS;
+    uint8_t flags = end_stream ? FLAG_END_STREAM : 0;
+    do {
+        size_t len = std::min(block.readableBytes(), static_cast<size_t>(peer_max_frame_size_));
+        bool last = (len == block.readableBytes());
+        writeFrameHeader(out, len, type, flags | (last ? FLAG_END_HEADERS : 0), stream_id);
+        out.append(block.peek(), len);
+        block.retrieve(len);
+        type = CONTINUATION;
+        flags = 0;
+    } while (block.readableBytes() > 0);
+}
+
+void Http2Session::writeRstStream(Buffer &out, uint32_t stream_id, ERROR_CODE code) {
+    uint8_t payload[4];
+    writeUint32(payload, code);
+    writeFrameHeader(out, sizeof(payload), RST_STREAM, 0, stream_id);
+    out.append(payload, sizeof(payload));
+}
+
+void Http2Session::writeWindowUpdate(Buffer &out, uint32_t stream_id, uint32_t increment) {
+    uint8_t payload[4];
+    writeUint32(payload, increment);
+    writeFrameHeader(out, sizeof(payload), WINDOW_UPDATE, 0, stream_id);
+    out.append(payload, sizeof(payload));
+}
+
+bool Http2Session::connectionError(Buffer &out, ERROR_CODE code) {
+    LOG_WARN("h2 connection error: %u", static_cast<uint32_t>(code));
+    uint8_t payload[8];
+    writeUint32(payload, last_stream_id_);
+    writeUint32(payload + 4, code);
+    writeFrameHeader(out, sizeof(payload), GOAWAY, 0, 0);
+    out.append(payload, sizeof(payload));
+    goaway_ = true;
+    broken_ = true;
+    streams_.clear();
+    continuation_stream_ = 0;
+    return false;
+}
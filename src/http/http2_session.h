@@ -0,0 +1,182 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef HTTP2_SESSION_H
+#define HTTP2_SESSION_H
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/buffer.h"
+#include "hpack.h"
+#include "http_request.h"
+#include "http_response.h"
+
+// HTTP/2明文(h2c)会话, 一个连接上复用多个流
+// 只负责帧的编解码和流状态, 读写仍由HttpConnection通过Buffer完成
+class Http2Session {
+public:
+    enum FRAME_TYPE : uint8_t {
+        DATA = 0,
+        HEADERS,
+        PRIORITY,
+        RST_STREAM,
+        SETTINGS,
+        PUSH_PROMISE,
+        PING,
+        GOAWAY,
+        WINDOW_UPDATE,
+        CONTINUATION,
+    };
+
+    enum ERROR_CODE : uint32_t {
+        NO_ERROR = 0,
+        PROTOCOL_ERROR,
+        INTERNAL_ERROR,
+        FLOW_CONTROL_ERROR,
+        SETTINGS_TIMEOUT,
+        STREAM_CLOSED,
+        FRAME_SIZE_ERROR,
+        REFUSED_STREAM,
+        CANCEL,
+        COMPRESSION_ERROR,
+        CONNECT_ERROR,
+        ENHANCE_YOUR_CALM,
+    };
+
+    enum FRAME_FLAG : uint8_t {
+        FLAG_END_STREAM = 0x1,
+        FLAG_ACK = 0x1,
+        FLAG_END_HEADERS = 0x4,
+        FLAG_PADDED = 0x8,
+        FLAG_PRIORITY = 0x20,
+    };
+
+    explicit Http2Session(const std::string &src_dir);
+
+    ~Http2Session() = default;
+
+    /// 判断buffer开头是否是客户端的连接序言(prior knowledge)
+    /// @return 1: 完整的序言, 0: 数据不够还无法判断, -1: 不是HTTP/2
+    static int checkPreface(const Buffer &buffer);
+
+    // prior knowledge方式: 发送服务端的SETTINGS
+    void start(Buffer &out);
+
+    /// Upgrade方式: 应用HTTP2-Settings, 升级前的请求作为stream 1处理
+    /// @param settings HTTP2-Settings头部(base64url编码的SETTINGS载荷)
+    /// @param request 已解析完成的HTTP/1.1请求
+    /// @param out 写缓冲, 101响应之后紧跟服务端SETTINGS
+    bool startUpgrade(const std::string &settings, const HttpRequest &request, Buffer &out);
+
+    // 解析in中所有完整的帧, 需要回复的帧写入out
+    void onRead(Buffer &in, Buffer &out);
+
+    // 有流的登录/注册请求在等待验证
+    bool isVerifyPending() const { return !verifying_.empty(); }
+
+    // 依次验证等待中的流, 响应的HEADERS写入out. 期间不能调用onRead和flush
+    CoTask<> verifyAsync(Buffer &out);
+
+    // 在流控窗口内把各个流的响应体轮流写成DATA帧, 每次最多写SEND_QUANTUM字节
+    void flush(Buffer &out);
+
+    // 发送或收到GOAWAY后不再接受新流, 所有流结束后连接即可关闭
+    bool isAlive() const;
+
+    static const size_t SEND_QUANTUM = 256 * 1024;
+    static constexpr size_t FILE_CHUNK = 16 * 1024; // 从文件读取时每个DATA帧的最大长度
+
+private:
+    struct Stream {
+        uint32_t id = 0;
+        int64_t send_window = 0; // 对端给该流的发送窗口
+        bool end_stream = false; // 对端已发送END_STREAM
+        bool headers_done = false; // 已收到请求头部, 之后的HEADERS是trailer
+        bool refused = false; // 超出并发限制, 解码头部后拒绝
+        bool responding = false; // 已发送HEADERS, 正在发送响应体
+        std::string header_block; // 尚未收齐CONTINUATION的头部块
+        std::string method;
+        std::string path;
+        std::unordered_map<std::string, std::string> headers;
+        std::string body; // 请求体
+        std::unique_ptr<HttpRequest> request; // 等待验证的请求
+        HttpResponse response; // 持有映射的资源文件
+        std::string error_body; // 文件映射失败时的错误页面
+        const char *data = nullptr; // 待发送的响应体
+        int fd = -1; // 大文件不映射, 从该文件描述符逐帧读取, 由response持有
+        off_t offset = 0; // fd的读取偏移
+        size_t data_left = 0;
+    };
+
+    bool handleFrame(uint8_t type, uint8_t flags, uint32_t stream_id,
+                     const uint8_t *payload, size_t len, Buffer &out);
+
+    bool handleHeaders(uint8_t flags, uint32_t stream_id,
+                       const uint8_t *payload, size_t len, Buffer &out);
+
+    bool handleContinuation(uint8_t flags, uint32_t stream_id,
+                            const uint8_t *payload, size_t len, Buffer &out);
+
+    bool handleData(uint8_t flags, uint32_t stream_id,
+                    const uint8_t *payload, size_t len, Buffer &out);
+
+    bool handleSettings(uint8_t flags, uint32_t stream_id,
+                        const uint8_t *payload, size_t len, Buffer &out);
+
+    bool handleWindowUpdate(uint32_t stream_id, const uint8_t *payload, size_t len, Buffer &out);
+
+    // 收齐头部块后解码
+    bool endHeaders(Stream &stream, Buffer &out);
+
+    // 请求接收完毕, 复用HttpRequest解析路径和表单
+    void finishRequest(Stream &stream, Buffer &out);
+
+    // 复用HttpResponse的静态文件逻辑生成响应
+    void dispatch(Stream &stream, const HttpRequest &request, bool parsed, Buffer &out);
+
+    ERROR_CODE applySettings(const uint8_t *payload, size_t len);
+
+    void writeFrameHeader(Buffer &out, size_t len, uint8_t type, uint8_t flags, uint32_t stream_id);
+
+    void writeHeaders(Buffer &out, uint32_t stream_id, const HeaderList &headers, bool end_stream);
+
+    void writeRstStream(Buffer &out, uint32_t stream_id, ERROR_CODE code);
+
+    void writeWindowUpdate(Buffer &out, uint32_t stream_id, uint32_t increment);
+
+    // 连接错误: 发送GOAWAY, 之后连接只等待写完后关闭
+    bool connectionError(Buffer &out, ERROR_CODE code);
+
+    std::string src_dir_;
+    bool preface_received_; // 已收到客户端序言
+    bool goaway_; // 已发送或收到GOAWAY
+    bool broken_; // 发生连接错误, 不再解析输入
+    uint32_t last_stream_id_; // 已处理的最大客户端流id
+    uint32_t continuation_stream_; // 正在等待CONTINUATION的流, 0表示没有
+    uint32_t next_stream_; // 轮转发送DATA时下一个优先的流
+
+    // 对端SETTINGS
+    uint32_t peer_initial_window_;
+    uint32_t peer_max_frame_size_;
+    int64_t send_window_; // 连接级发送窗口
+
+    HPackDecoder decoder_;
+    std::map<uint32_t, std::unique_ptr<Stream>> streams_;
+    std::vector<uint32_t> verifying_; // 等待验证的流
+
+    static const uint32_t MAX_CONCURRENT_STREAMS = 100;
+    static const uint32_t MAX_FRAME_SIZE = 16384; // 本端接收的最大帧(协议默认值)
+    static const size_t MAX_HEADER_BLOCK = 64 * 1024;
+    static const size_t MAX_HEADER_LIST = 64 * 1024; // 解码后的头部列表上限, SETTINGS_MAX_HEADER_LIST_SIZE
+    static const size_t MAX_REQUEST_BODY = 1024 * 1024;
+};
+
+
+#endif //HTTP2_SESSION_H
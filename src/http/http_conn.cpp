@@ -3,12 +3,18 @@
 //
 
 #include "http_conn.h"
+
+#include <strings.h>
+
+#include "cache/session_cache.h"
+
 const char* HttpConnection::SRC_DIR;
 std::atomic<int> HttpConnection::user_count;
 // ET: 事件发生时, 只通知一次
 bool HttpConnection::isET = true;
 
-HttpConnection::HttpConnection() {
+// 读写缓冲区按需从BufferPool借用, 空闲的长连接不持有缓冲区
+HttpConnection::HttpConnection() : read_buffer_(0), write_buffer_(0) {
     sock_fd_ = -1;
     addr_ = {};
     is_close_ = true;
@@ -26,19 +32,33 @@ void HttpConnection::init(int sock_fd, const sockaddr_in &addr) {
     // 清空读写缓冲
     read_buffer_.retrieveAll();
     write_buffer_.retrieveAll();
+    send_chain_.clear();
+    http2_.reset();
+    websocket_.reset();
     is_close_ = false;
     LOG_INFO("Client[%d](%s:%d) in, user_count: %d", sock_fd_, getIp(), getPort(), static_cast<int>(user_count));
 }
 
 void HttpConnection::close() {
+    // 发送链可能引用内存映射的文件, 先于取消映射释放
+    send_chain_.clear();
     // 取消文件到内存的映射
     response_.unmapFile();
+    http2_.reset();
+    // 关闭套接字前注销WebSocket, 防止广播操作已复用的fd
+    websocket_.reset();
     if (is_close_ == false) {
         is_close_ = true;
         user_count -= 1;
         // 关闭套接字
         ::close(sock_fd_);
-        LOG_INFO("Client[%d](%s:%d) quit, user_count: %d", sock_fd_, getIp(), getPort(), static_cast<int>(user_count));
+        // 连接对象会被复用, 归还之前请求扩大的缓冲区
+        read_buffer_.retrieveAll();
+        write_buffer_.retrieveAll();
+        read_buffer_.shrink();
+        write_buffer_.shrink();
+        LOG_INFO("Client[%d](%s:%d) quit, user_count: %d, buffer bytes: %zu", sock_fd_, getIp(), getPort(),
+                 static_cast<int>(user_count), Buffer::totalBytes());
     }
 }
 
@@ -76,58 +96,156 @@ ssize_t HttpConnection::read(int *save_errno) {
 
 ssize_t HttpConnection::write(int *save_errno) {
     ssize_t len = -1;
+    size_t written = 0; // 本次已经发送的字节数
     do {
-        len = writev(sock_fd_, iov_, iov_cnt_);
-        if (len <= 0) {
-            *save_errno = errno;
+        if (send_chain_.empty()) {
             break;
         }
-        // 两块都写完毕
-        if (iov_[0].iov_len + iov_[1].iov_len == 0) {
+        // 链头部的内存段(响应头, 缓存内容, 多范围的分隔行)一次sendmsg, 文件范围用sendfile, 部分写入由链维护
+        len = send_chain_.writeFd(sock_fd_, save_errno, WRITE_QUANTUM - written);
+        if (len <= 0) {
             break;
-        } else if (static_cast<size_t>(len) > iov_[0].iov_len) {
-            // 写完了第一块, 开始写第二块
-            // 1. 第一次写就写完了iov_[0]
-            // 2. 后续写才写完
-            iov_[1].iov_base = (uint8_t *)iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if (iov_[0].iov_len > 0) {
-                write_buffer_.retrieveAll();
-                iov_[0].iov_len = 0;
-            }
-        } else {
-            // 第一块还没写完
-            iov_[0].iov_base = (uint8_t *)iov_[0].iov_base + len;
-            iov_[0].iov_len -= len;
-            write_buffer_.retrieve(len);
         }
-
-    } while (isET || toWriteBytes() > 10240);   // 10kb
+        written += len;
+        // 达到本次的发送量后返回, 由onWrite重新注册EPOLLOUT, 让其他连接有机会被处理
+    } while ((isET || toWriteBytes() > 10240) && written < WRITE_QUANTUM);   // 10kb
     return len;
 }
 
 bool HttpConnection::process() {
+    if (websocket_) {
+        return processWebSocket();
+    }
+    if (http2_) {
+        return processHttp2();
+    }
+    // prior knowledge: 客户端直接发送HTTP/2连接序言
+    int preface = Http2Session::checkPreface(read_buffer_);
+    if (preface == 1) {
+        http2_ = std::make_unique<Http2Session>(SRC_DIR);
+        http2_->start(write_buffer_);
+        return processHttp2();
+    } else if (preface == 0 && read_buffer_.readableBytes() > 0) {
+        // 序言还没收全
+        return false;
+    }
     // 初始化请求
     request_.init();
     if (read_buffer_.readableBytes() <= 0) {
         return false;
     } else if (request_.parse(read_buffer_)) {
         LOG_DEBUG("%s", request_.path().c_str());
-        response_.init(SRC_DIR, request_.path(), request_.isKeepAlive(), 200);
+        if (request_.getHeader("Upgrade") == "h2c" && request_.method() == "GET" &&
+            !request_.getHeader("HTTP2-Settings").empty() && upgradeHttp2()) {
+            return processHttp2();
+        }
+        if (strcasecmp(request_.getHeader("Upgrade").c_str(), "websocket") == 0 && upgradeWebSocket()) {
+            return processWebSocket();
+        }
+        if (request_.needVerify() && !request_.tryVerify()) {
+            // 登录/注册要查询数据库, 不在当前线程等待, 由WebServer交给阻塞执行器
+            // 带有会话或者命中用户缓存的登录在当前线程完成
+            return false;
+        }
+        makeResponse();
     } else {
         response_.init(SRC_DIR, request_.path(), false, 400);
+        response_.makeResponse(write_buffer_);
+        appendResponse();
+    }
+    LOG_DEBUG("file size: %zu, to %zu", response_.getFileSize(), toWriteBytes());
+    return true;
+}
+
+CoTask<> HttpConnection::verifyAsync() {
+    if (http2_) {
+        // 验证完成的流和之前已生成的响应一起发送
+        co_await http2_->verifyAsync(write_buffer_);
+        http2_->flush(write_buffer_);
+        send_chain_.append(std::move(write_buffer_));
+        co_return;
+    }
+    co_await request_.verifyAsync();
+    makeResponse();
+}
+
+void HttpConnection::makeResponse() {
+    response_.init(SRC_DIR, request_.path(), request_.isKeepAlive(), 200);
+    response_.setAcceptEncoding(request_.getHeader("Accept-Encoding"));
+    if (!request_.getNewSession().empty()) {
+        response_.setCookie(SessionCache::getInstance()->makeCookie(request_.getNewSession()));
+    }
+    // 条件请求和范围请求只对GET有意义
+    if (request_.method() == "GET") {
+        response_.setRange(request_.getHeader("Range"), request_.getHeader("If-Range"));
+        response_.setConditional(request_.getHeader("If-None-Match"), request_.getHeader("If-Modified-Since"));
     }
     // 将response写到write_buffer_
     response_.makeResponse(write_buffer_);
-    iov_[0].iov_base = const_cast<char *>(write_buffer_.peek());
-    iov_[0].iov_len = write_buffer_.readableBytes();
-    iov_cnt_ =  1;
-    // 有文件要传输的话, 额外传输
-    if (response_.getFile() != nullptr && response_.getFileSize() > 0) {
-        iov_[1].iov_base = response_.getFile();
-        iov_[1].iov_len = response_.getFileSize();
-        iov_cnt_ = 2;
+    appendResponse();
+}
+
+void HttpConnection::appendResponse() {
+    send_chain_.append(std::move(write_buffer_));
+    // 有文件要传输的话, 额外传输: 缓存/映射的内容直接引用, 大文件记录文件范围由sendfile发送
+    // 引用计数保证发送完之前缓存条目和文件描述符不会被释放
+    std::shared_ptr<const void> keeper = response_.getKeeper();
+    for (const HttpResponse::BodyPart &part: response_.getBodyParts()) {
+        send_chain_.append(part.head);
+        if (part.len == 0) {
+            continue;
+        }
+        if (response_.getFileFd() >= 0) {
+            send_chain_.appendFile(response_.getFileFd(), part.offset, part.len, keeper);
+        } else if (response_.getFile() != nullptr) {
+            send_chain_.appendRef(response_.getFile() + part.offset, part.len, keeper);
+        }
     }
-    LOG_DEBUG("file size: %d, %d to %d", response_.getFileSize(), iov_cnt_, toWriteBytes());
+}
+
+bool HttpConnection::upgradeHttp2() {
+    Buffer upgrade;
+    upgrade.append("HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n");
+    auto session = std::make_unique<Http2Session>(SRC_DIR);
+    if (!session->startUpgrade(request_.getHeader("HTTP2-Settings"), request_, upgrade)) {
+        // HTTP2-Settings不合法, 忽略升级按HTTP/1.1处理
+        LOG_WARN("Client[%d] invalid HTTP2-Settings", sock_fd_);
+        return false;
+    }
+    LOG_DEBUG("Client[%d] upgrade to h2c", sock_fd_);
+    http2_ = std::move(session);
+    write_buffer_.append(upgrade);
     return true;
 }
+
+bool HttpConnection::processHttp2() {
+    // 解析已收到的帧, 再在流控窗口内填充响应数据
+    http2_->onRead(read_buffer_, write_buffer_);
+    http2_->flush(write_buffer_);
+    send_chain_.append(std::move(write_buffer_));
+    return !send_chain_.empty();
+}
+
+bool HttpConnection::upgradeWebSocket() {
+    std::string key = request_.getHeader("Sec-WebSocket-Key");
+    if (request_.method() != "GET" || key.empty() || request_.getHeader("Sec-WebSocket-Version") != "13") {
+        LOG_WARN("Client[%d] invalid WebSocket handshake", sock_fd_);
+        return false;
+    }
+    write_buffer_.append("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n");
+    write_buffer_.append("Sec-WebSocket-Accept: " + WebSocket::acceptKey(key) + "\r\n\r\n");
+    websocket_ = std::make_unique<WebSocket>(sock_fd_, request_.path());
+    LOG_DEBUG("Client[%d] upgrade to WebSocket, path: %s", sock_fd_, request_.path().c_str());
+    return true;
+}
+
+bool HttpConnection::processWebSocket() {
+    // 控制帧的回复(pong, close)直接写入write_buffer_, 数据帧引用广播共享的帧零拷贝发送
+    websocket_->onRead(read_buffer_, write_buffer_);
+    send_chain_.append(std::move(write_buffer_));
+    // 排队的帧一次全部放入发送链, 由一次sendmsg批量发送
+    while (WebSocket::Frame frame = websocket_->nextFrame()) {
+        send_chain_.appendRef(frame->data(), frame->size(), frame);
+    }
+    return toWriteBytes() > 0;
+}
@@ -14,8 +14,11 @@
 #include "logger/logger.h"
 #include "pool/sqlconnpool.h"
 #include "buffer/buffer.h"
+#include "buffer/chain_buffer.h"
 #include "http_request.h"
 #include "http_response.h"
+#include "http2_session.h"
+#include "websocket.h"
 
 class HttpConnection {
 public:
@@ -39,33 +42,75 @@ public:
 
     sockaddr_in getAddress() const;
 
+    // 生成了要发送的数据返回true; 返回false时数据不完整, 或者请求在等待数据库验证(isVerifyPending)
     bool process();
 
-    int toWriteBytes() {
-        // 两块内存大小加起来就是要写入fd的大小
-        return iov_[0].iov_len + iov_[1].iov_len;
+    // 请求已解析(HTTP/2时是某个流的请求), 等待调用verifyAsync
+    bool isVerifyPending() const {
+        if (http2_) {
+            return http2_->isVerifyPending();
+        }
+        return request_.needVerify();
+    }
+
+    // 通过UserStore验证用户后生成响应, 存储阻塞时只在阻塞执行器中调用
+    CoTask<> verifyAsync();
+
+    size_t toWriteBytes() {
+        // 发送链中的响应头, 缓存内容和文件范围加起来, 就是要写入fd的大小
+        return send_chain_.readableBytes();
     }
 
     bool isKeepAlive() const {
+        if (websocket_) {
+            return !websocket_->isClosed();
+        }
+        if (http2_) {
+            return http2_->isAlive();
+        }
         return request_.isKeepAlive();
     }
 
+    // 升级为WebSocket后才不为空
+    WebSocket *getWebSocket() const {
+        return websocket_.get();
+    }
+
     static bool isET;
     static const char *SRC_DIR;
+    static constexpr size_t WRITE_QUANTUM = 512 * 1024; // 每次write最多发送的字节数, 防止一个连接长时间占用工作线程
     static std::atomic<int> user_count;
 
 private:
+    // 客户端通过Upgrade: h2c请求升级, 返回是否升级成功
+    bool upgradeHttp2();
+
+    bool processHttp2();
+
+    // 客户端请求升级为WebSocket, 返回是否升级成功
+    bool upgradeWebSocket();
+
+    bool processWebSocket();
+
+    // 根据已解析的请求生成响应, 放入发送链
+    void makeResponse();
+
+    // 把write_buffer_中生成的报文和响应体的各部分放入发送链
+    void appendResponse();
+
     int sock_fd_;
     sockaddr_in addr_;
     bool is_close_;
-    int iov_cnt_;
-    struct iovec iov_[2];
 
     Buffer read_buffer_;
-    Buffer write_buffer_;
+    Buffer write_buffer_; // 生成报文用, 生成后整块移入send_chain_
+    ChainBuffer send_chain_; // 待发送的数据
 
     HttpRequest request_;
     HttpResponse response_;
+
+    std::unique_ptr<Http2Session> http2_; // 升级到HTTP/2后的会话
+    std::unique_ptr<WebSocket> websocket_; // 升级到WebSocket后的连接
 };
 
 
@@ -4,6 +4,46 @@
 
 #include "http_request.h"
 
+#include <ctype.h>
+#include <strings.h>
+
+#include "cache/session_cache.h"
+#include "pool/executor.h"
+#include "store/user_store.h"
+
+namespace {
+// co_await lookupUser(name): 查找用户缓存, 其他请求正在查询同一个用户时挂起, 查询完成后在快速执行器中恢复
+// 返回LOAD时当前协程是加载者, 查询后必须调用fill或fail
+auto lookupUser(const std::string &name) {
+    struct Awaiter {
+        const std::string &name;
+        UserCache::Result result;
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            UserCache::Result user = UserCache::getInstance()->lookup(name, [this, handle](const UserCache::Result &r) {
+                result = r;
+                if (Executors::getInstance()->isInit(Executors::EXECUTOR_FAST)) {
+                    Executors::getInstance()->addTask(Executors::EXECUTOR_FAST, [handle] { handle.resume(); });
+                } else {
+                    handle.resume();
+                }
+            });
+            // 返回WAIT之后回调随时可能在其他线程中恢复协程, 不能再访问this
+            if (user.status == UserCache::WAIT) {
+                return true;
+            }
+            result = std::move(user);
+            return false;
+        }
+
+        UserCache::Result await_resume() { return std::move(result); }
+    };
+    return Awaiter{name, {}};
+}
+} // namespace
+
 const std::unordered_set<std::string> HttpRequest::DEFAULT_HTML{
     "/index", "/register", "/login",
     "/welcome", "/video", "/picture",
@@ -21,6 +61,8 @@ void HttpRequest::init() {
     state_ = REQUEST_LINE;
     headers_.clear();
     post_.clear();
+    verify_tag_ = -1;
+    new_session_.clear();
 }
 
 bool HttpRequest::isKeepAlive() const {
@@ -47,10 +89,9 @@ bool HttpRequest::parse(Buffer &buffer) {
                 // if (line_end == buffer.beginWriteConst()) {
                 //     return false;
                 // }
-                if (!parseRequestLine(line)) {
+                if (!parseRequestLine(line) || !parsePath()) {
                     return false;
                 }
-                parsePath();
                 break;
             case HEADERS:
                 // if (line_end == buffer.beginWriteConst()) {
@@ -85,7 +126,89 @@ bool HttpRequest::parse(Buffer &buffer) {
     return true;
 }
 
-void HttpRequest::parsePath() {
+bool HttpRequest::parse(const std::string &method, const std::string &path,
+                        const std::unordered_map<std::string, std::string> &headers,
+                        const std::string &body) {
+    if (method.empty() || path.empty() || path[0] != '/') {
+        return false;
+    }
+    method_ = method;
+    path_ = path;
+    version_ = "2";
+    headers_ = headers;
+    if (!parsePath()) {
+        return false;
+    }
+    if (!body.empty()) {
+        parseBody(body);
+    }
+    // 登录/注册和HTTP/1.1一样只记录下来, 由会话交给WebServer验证
+    state_ = FINISH;
+    LOG_DEBUG("[%s], [%s], [HTTP/2]", method_.c_str(), path_.c_str());
+    return true;
+}
+
+bool HttpRequest::normalizePath(std::string &path) {
+    if (path.empty() || path[0] != '/') {
+        return false;
+    }
+    // 绝大多数请求已经是规范的, 不需要复制
+    if (path.find('%') == std::string::npos && path.find("//") == std::string::npos &&
+        path.find("/.") == std::string::npos) {
+        return true;
+    }
+    auto hex = [](char ch) {
+        return isdigit(static_cast<unsigned char>(ch)) ? ch - '0' : (tolower(static_cast<unsigned char>(ch)) - 'a' + 10);
+    };
+    std::string decoded;
+    decoded.reserve(path.size());
+    for (size_t i = 0; i < path.size(); ++i) {
+        char ch = path[i];
+        if (ch == '%') {
+            if (i + 2 >= path.size() || !isxdigit(static_cast<unsigned char>(path[i + 1])) ||
+                !isxdigit(static_cast<unsigned char>(path[i + 2]))) {
+                return false;
+            }
+            ch = static_cast<char>(hex(path[i + 1]) * 16 + hex(path[i + 2]));
+            if (ch == '\0') {
+                return false;
+            }
+            i += 2;
+        }
+        decoded.push_back(ch);
+    }
+    // 解码之后再处理点段, %2e%2e同样不能回退到根目录之外
+    std::string result;
+    result.reserve(decoded.size());
+    size_t pos = 0;
+    while (pos < decoded.size()) {
+        size_t end = decoded.find('/', pos);
+        if (end == std::string::npos) {
+            end = decoded.size();
+        }
+        std::string_view segment(decoded.data() + pos, end - pos);
+        if (segment == "..") {
+            size_t slash = result.rfind('/');
+            result.resize(slash == std::string::npos ? 0 : slash);
+        } else if (!segment.empty() && segment != ".") {
+            result.push_back('/');
+            result.append(segment);
+        }
+        pos = end + 1;
+    }
+    // 以'/'结尾的目录保留结尾的'/'
+    if (result.empty() || decoded.back() == '/') {
+        result.push_back('/');
+    }
+    path = std::move(result);
+    return true;
+}
+
+bool HttpRequest::parsePath() {
+    if (!normalizePath(path_)) {
+        LOG_WARN("invalid path: %s", path_.c_str());
+        return false;
+    }
     // /index.html
     // 根目录
     if (path_ == "/") {
@@ -108,6 +231,7 @@ void HttpRequest::parsePath() {
         //     path_ = "/index.html";
         // }
     }
+    return true;
 }
 
 bool HttpRequest::parseRequestLine(const std::string &line) {
@@ -158,17 +282,55 @@ void HttpRequest::parsePost() {
             int tag = DEFAULT_HTML_TAG.find(path_)->second;
             LOG_DEBUG("Tag:%d", tag);
             if (tag == 0 || tag == 1) {
-                bool is_login = (tag == 1);
-                if (userVerify(post_["username"], post_["password"], is_login)) {
-                    path_ = "/welcome.html";
-                } else {
-                    path_ = "/error.html";
-                }
+                // 验证会阻塞在数据库上, 由调用者决定在哪个执行器中调用verify
+                verify_tag_ = tag;
             }
         }
     }
 }
 
+CoTask<> HttpRequest::verifyAsync() {
+    if (verify_tag_ < 0 || tryVerify()) {
+        co_return;
+    }
+    bool ok = co_await userVerify(post_["username"], post_["password"], isLoginVerify());
+    finishVerify(ok);
+}
+
+void HttpRequest::verify() {
+    syncWait(verifyAsync());
+}
+
+bool HttpRequest::tryVerify() {
+    if (!isLoginVerify()) {
+        return false;
+    }
+    const std::string &name = post_["username"];
+    // 已经登录过的客户端不需要再次验证, 沿用原来的会话
+    if (SessionCache::getInstance()->check(getCookie(SessionCache::COOKIE_NAME), name)) {
+        verify_tag_ = -1;
+        path_ = "/welcome.html";
+        return true;
+    }
+    UserCache::Result user = UserCache::getInstance()->get(name);
+    if (user.status == UserCache::MISS) {
+        return false;
+    }
+    finishVerify(user.status == UserCache::FOUND && user.password == post_["password"]);
+    return true;
+}
+
+void HttpRequest::finishVerify(bool ok) {
+    verify_tag_ = -1;
+    if (ok) {
+        path_ = "/welcome.html";
+        // 登录或注册成功, 之后的登录凭会话跳过验证
+        new_session_ = SessionCache::getInstance()->create(post_["username"]);
+    } else {
+        path_ = "/error.html";
+    }
+}
+
 void HttpRequest::parseFromUrlEncoded() {
     if (body_.size() == 0) {
         return;
@@ -217,71 +379,57 @@ void HttpRequest::parseFromUrlEncoded() {
 /// @param pwd 密码
 /// @param is_login 判断是注册还是登录请求
 /// @return 验证成功或失败
-bool HttpRequest::userVerify(const std::string &name, const std::string &pwd, bool is_login) {
-    if (name == "" || pwd == "") {
-        return false;
+CoTask<bool> HttpRequest::userVerify(std::string name, std::string pwd, bool is_login) {
+    if (name.empty() || pwd.empty()) {
+        co_return false;
     }
-    LOG_INFO("Verify name:%s, pwd:%s", name.c_str(), pwd.c_str());
-    MYSQL *sql = nullptr;
-    // SQLConnPool在其他地方初始化
-    SQLConnRAll(&sql, SQLConnPool::getInstance());
-    assert(sql != nullptr);
-
-    bool flag = false;
-    unsigned int j = 0;
-    char order[256] = {};
-    // 表的列
-    MYSQL_FIELD *field = nullptr;
-    MYSQL_RES *res = nullptr;
-
-    if (!is_login) {
-        flag = true;
-    }
-    snprintf(order, 256, "SELECT username, password FROM user WHERE username='%s' LIMIT 1", name.c_str());
-    LOG_DEBUG("order: %s", order);
-    // mysql_query查询成功时返回0
-    if (mysql_query(sql, order)) {
-        mysql_free_result(res);
-        return false;
+    LOG_INFO("Verify name:%s", name.c_str());
+    if (is_login) {
+        // 同一个用户名同时只有一个请求查询存储, 其他请求挂起等待它的结果
+        UserCache::Result user = co_await lookupUser(name);
+        if (user.status == UserCache::LOAD) {
+            user = co_await loadUser(name);
+        }
+        co_return user.status == UserCache::FOUND && user.password == pwd;
+    }
+    // 缓存中已有的用户不能注册
+    if (UserCache::getInstance()->get(name).status == UserCache::FOUND) {
+        LOG_DEBUG("user used!");
+        co_return false;
     }
+    UserStore *store = UserStore::getInstance();
+    if (store == nullptr) {
+        co_return false;
+    }
+    LOG_DEBUG("register!");
+    UserStore::STATUS status = co_await store->addAsync(name, pwd);
+    // 缓存中可能有该用户名不存在的记录
+    UserCache::getInstance()->invalidate(name);
+    if (status == UserStore::EXISTS) {
+        LOG_DEBUG("user used!");
+    }
+    co_return status == UserStore::OK;
+}
 
-    res = mysql_store_result(sql);
-    // 有多少列, 这里应该是2列
-    j = mysql_num_fields(res);
-    // 提取列
-    field = mysql_fetch_field(res);
-    // 遍历行
-    while (MYSQL_ROW row = mysql_fetch_row(res)) {
-        LOG_DEBUG("MYSQL ROW: %s %s", row[0], row[1]);
-        std::string password(row[1]);
-        // 登录请求
-        if (is_login) {
-            if (pwd == password) {
-                flag = true;
-            } else {
-                flag = false;
-                LOG_DEBUG("pwd error!");
-            }
-        } else {
-            // 需要注册但已有相同的用户名
-            flag = false;
-            LOG_DEBUG("user used!");
-        }
+CoTask<UserCache::Result> HttpRequest::loadUser(std::string name) {
+    UserStore *store = UserStore::getInstance();
+    UserStore::User found{UserStore::ERROR, ""};
+    if (store != nullptr) {
+        found = co_await store->findAsync(name);
     }
-    mysql_free_result(res);
-    // 尝试注册
-    if (!is_login && flag == true) {
-        LOG_DEBUG("register!");
-        bzero(order, 256);
-        snprintf(order, 256, "INSERT INTO user(username, password) VALUES('%s', '%s')", name.c_str(), pwd.c_str());
-        LOG_DEBUG("order: %s", order);
-        if (mysql_query(sql, order)) {
-            LOG_DEBUG("Insert error!");
-            flag = false;
-        }
+    UserCache::Result user{UserCache::NOT_FOUND, ""};
+    if (found.status == UserStore::ERROR) {
+        // 失败不缓存, 等待的请求也验证失败, 之后的请求重新查询
+        UserCache::getInstance()->fail(name);
+        user.status = UserCache::ERROR;
+        co_return user;
     }
-    LOG_DEBUG("user verify success!");
-    return flag;
+    if (found.status == UserStore::OK) {
+        user.status = UserCache::FOUND;
+        user.password = std::move(found.password);
+    }
+    UserCache::getInstance()->fill(name, user.status == UserCache::FOUND, user.password);
+    co_return user;
 }
 
 // 十六进制转十进制
@@ -308,6 +456,20 @@ std::string HttpRequest::version() const {
     return version_;
 }
 
+// 头部名称不区分大小写, 先精确查找再逐个比较
+std::string HttpRequest::getHeader(const std::string &key) const {
+    auto it = headers_.find(key);
+    if (it != headers_.end()) {
+        return it->second;
+    }
+    for (const auto &[name, value]: headers_) {
+        if (strcasecmp(name.c_str(), key.c_str()) == 0) {
+            return value;
+        }
+    }
+    return "";
+}
+
 std::string HttpRequest::method() const {
     return method_;
 }
@@ -327,3 +489,25 @@ std::string HttpRequest::getPost(const std::string &key) const {
     }
     return "";
 }
+
+std::string HttpRequest::getCookie(const std::string &name) const {
+    // Cookie: a=1; session=xxx
+    std::string header = getHeader("Cookie");
+    std::string_view cookies = header;
+    while (!cookies.empty()) {
+        size_t end = cookies.find(';');
+        std::string_view pair = cookies.substr(0, end);
+        while (!pair.empty() && pair.front() == ' ') {
+            pair.remove_prefix(1);
+        }
+        size_t eq = pair.find('=');
+        if (eq != std::string_view::npos && pair.substr(0, eq) == name) {
+            return std::string(pair.substr(eq + 1));
+        }
+        if (end == std::string_view::npos) {
+            break;
+        }
+        cookies.remove_prefix(end + 1);
+    }
+    return "";
+}
@@ -6,14 +6,14 @@
 #define HTTP_REQUEST_H
 #pragma once
 
-#include <mysql/mysql.h>
-
 #include <regex>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "buffer/buffer.h"
+#include "cache/user_cache.h"
 #include "logger/logger.h"
-#include "pool/sqlconnRAll.h"
+#include "pool/co_task.h"
 
 class HttpRequest {
 public:
@@ -43,6 +43,11 @@ public:
 
     bool parse(Buffer &buffer);
 
+    // 由HTTP/2的HEADERS和DATA帧构造请求, headers的键已转换为HTTP/1.1的大小写形式
+    bool parse(const std::string &method, const std::string &path,
+               const std::unordered_map<std::string, std::string> &headers,
+               const std::string &body);
+
     std::string path() const;
 
     std::string &path();
@@ -51,12 +56,36 @@ public:
 
     std::string version() const;
 
+    std::string getHeader(const std::string &key) const;
+
     std::string getPost(const std::string &key) const;
 
     std::string getPost(const char *key) const;
 
+    // Cookie请求头中名为name的值, 没有时返回空串
+    std::string getCookie(const std::string &name) const;
+
     bool isKeepAlive() const;
 
+    // 登录/注册请求需要查询数据库验证, 解析时只记录下来
+    bool needVerify() const { return verify_tag_ >= 0; }
+
+    // 等待验证的是登录(true)还是注册(false)
+    bool isLoginVerify() const { return verify_tag_ == 1; }
+
+    // 不访问数据库完成登录验证: 带有该用户的有效会话, 或者用户缓存命中时返回true
+    bool tryVerify();
+
+    /// 通过UserStore验证用户, 根据结果把路径改为欢迎页或错误页, 成功时创建会话
+    /// 存储阻塞(isBlocking)时只在阻塞执行器中等待; 等待存储或其他请求的查询时协程挂起, 可能在快速执行器中恢复
+    CoTask<> verifyAsync();
+
+    // 阻塞当前线程直到verifyAsync完成, 不能在执行器的线程中调用
+    void verify();
+
+    // 验证成功后新建的会话号, 需要通过Set-Cookie发给客户端; 没有时为空
+    const std::string &getNewSession() const { return new_session_; }
+
 private:
     bool parseRequestLine(const std::string &line);
 
@@ -64,14 +93,25 @@ private:
 
     void parseBody(const std::string &line);
 
-    void parsePath();
+    // 规范化路径后把页面名补全为.html, 路径无效时返回false
+    bool parsePath();
+
+    /// 规范化请求路径, 同一个文件只有一种写法(也是FdCache和FileCache的键): 解码%XX, 合并连续的'/',
+    /// 去掉"."并按".."回退, 最多回退到根目录, 不会访问资源目录之外的文件
+    /// @return 不以'/'开头, %之后不是两位十六进制数或者解码出'\0'时返回false
+    static bool normalizePath(std::string &path);
 
     void parsePost();
 
     void parseFromUrlEncoded();
 
-    static bool userVerify(const std::string &name, const std::string &pwd,
-                           bool is_login);
+    // 根据验证结果修改路径
+    void finishVerify(bool ok);
+
+    static CoTask<bool> userVerify(std::string name, std::string pwd, bool is_login);
+
+    // 用户缓存未命中时由加载者调用: 查询UserStore, 结果放入缓存并通知等待的请求
+    static CoTask<UserCache::Result> loadUser(std::string name);
 
     PARSE_STATE state_; // 当前解析的状态
     std::string method_; // 请求方法
@@ -80,6 +120,8 @@ private:
     std::string body_; // 请求体
     std::unordered_map<std::string, std::string> headers_; // 请求头信息
     std::unordered_map<std::string, std::string> post_; // post表单信息
+    int verify_tag_; // 等待验证的请求: 0注册, 1登录, -1不需要验证
+    std::string new_session_;
     static const std::unordered_set<std::string> DEFAULT_HTML; // 默认的网页
     static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
 
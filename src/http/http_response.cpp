@@ -3,14 +3,27 @@
 //
 
 #include "http_response.h"
+
+#include <stdlib.h>
+#include <strings.h>
+#include <time.h>
+#include <charconv>
+#include <mutex>
 /* 响应结构:
  * 状态行: HTTP/1.1 200 OK (版本 状态码 状态消息)
  * 响应头: Content-Type: text/html
  *         Content-Length: 1234
  * 响应体: <html>...</html>
  */
+namespace {
+// 生成响应时只查这些编译期常量表, 不构造std::string, 也没有静态初始化顺序问题
+struct SuffixType {
+    std::string_view suffix;
+    std::string_view type;
+};
+
 // 文件后缀对应的TYPE类型, 用在响应头Content-Type中
-const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE{
+constexpr SuffixType SUFFIX_TYPE[] = {
     {".html", "text/html"},
     {".xml", "text/xml"},
     {".xhtml", "application/xhtml+xml"},
@@ -28,18 +41,76 @@ const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE{
     {".avi", "video/x-msvideo"},
     {".gz", "application/x-gzip"},
     {".tar", "application/x-tar"},
-    {".css", "text/css "},
-    {".js", "text/javascript "},
+    {".css", "text/css"},
+    {".js", "text/javascript"},
+};
+
+// 状态码对应的描述和预先生成的状态行
+struct Status {
+    int code;
+    std::string_view reason;
+    std::string_view line;
 };
 
-// 响应状态码对应的描述
-const std::unordered_map<int, std::string> HttpResponse::CODE_STATUS{
-    {200, "OK"},
-    {400, "Bad Request"},
-    {403, "Forbidden"},
-    {404, "Not Found"},
+constexpr Status STATUS[] = {
+    {200, "OK", "HTTP/1.1 200 OK\r\n"},
+    {206, "Partial Content", "HTTP/1.1 206 Partial Content\r\n"},
+    {304, "Not Modified", "HTTP/1.1 304 Not Modified\r\n"},
+    {400, "Bad Request", "HTTP/1.1 400 Bad Request\r\n"},
+    {403, "Forbidden", "HTTP/1.1 403 Forbidden\r\n"},
+    {404, "Not Found", "HTTP/1.1 404 Not Found\r\n"},
+    {416, "Range Not Satisfiable", "HTTP/1.1 416 Range Not Satisfiable\r\n"},
+    {503, "Service Unavailable", "HTTP/1.1 503 Service Unavailable\r\n"},
 };
 
+// 不认识的状态码返回nullptr
+constexpr const Status *findStatus(int code) {
+    for (const Status &status: STATUS) {
+        if (status.code == code) {
+            return &status;
+        }
+    }
+    return nullptr;
+}
+
+// 不认识的状态码按400处理, 表中必须有400
+static_assert(findStatus(400)->reason == "Bad Request", "status table");
+
+// 后缀对应的类型, 未知后缀返回空
+constexpr std::string_view suffixType(std::string_view path) {
+    size_t idx = path.find_last_of('.');
+    if (idx == std::string_view::npos) {
+        return {};
+    }
+    std::string_view suffix = path.substr(idx);
+    for (const SuffixType &item: SUFFIX_TYPE) {
+        if (item.suffix == suffix) {
+            return item.type;
+        }
+    }
+    return {};
+}
+
+static_assert(suffixType("/index.html") == "text/html", "suffix table");
+
+// 去掉首尾的空白
+std::string_view trim(std::string_view str) {
+    size_t start = str.find_first_not_of(" \t");
+    if (start == std::string_view::npos) {
+        return {};
+    }
+    return str.substr(start, str.find_last_not_of(" \t") - start + 1);
+}
+
+// 不区分大小写比较
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+} // namespace
+
+std::unordered_map<int, std::string> HttpResponse::ERROR_RESPONSE;
+std::string HttpResponse::CACHE_CONTROL = "no-cache";
+
 // 错误响应码对应的资源路径
 const std::unordered_map<int, std::string> HttpResponse::CODE_PATH{
     {400, "/400.html"},
@@ -52,7 +123,12 @@ HttpResponse::HttpResponse() {
     path_ = src_dir_ = "";
     is_keep_alive_ = false;
     mm_file_ = nullptr;
+    file_fd_ = -1;
     mm_file_stat_ = {};
+    accept_encoding_ = 0;
+    encoding_ = nullptr;
+    header_slot_ = HEADER_IDENTITY;
+    encoded_ = nullptr;
 }
 
 HttpResponse::~HttpResponse() {
@@ -62,22 +138,190 @@ HttpResponse::~HttpResponse() {
 void HttpResponse::init(const std::string &src_dir, std::string &path, bool is_keep_alve, int status_code) {
     assert(src_dir != "");
 
-    if (mm_file_) {
-        unmapFile();
-    }
+    unmapFile();
     status_code_ = status_code;
     is_keep_alive_ = is_keep_alve;
     path_ = path;
     src_dir_ = src_dir;
     mm_file_ = nullptr;
     mm_file_stat_ = {};
+    accept_encoding_ = 0;
+    range_.clear();
+    if_range_.clear();
+    if_none_match_.clear();
+    if_modified_since_.clear();
+    set_cookie_.clear();
+    parts_.clear();
+}
+
+void HttpResponse::setConditional(const std::string &if_none_match, const std::string &if_modified_since) {
+    if_none_match_ = if_none_match;
+    if_modified_since_ = if_modified_since;
+}
+
+void HttpResponse::setCacheControl(const std::string &cache_control) {
+    CACHE_CONTROL = cache_control;
+}
+
+void HttpResponse::setRange(const std::string &range, const std::string &if_range) {
+    range_ = range;
+    if_range_ = if_range;
+}
+
+void HttpResponse::setAcceptEncoding(const std::string &accept_encoding) {
+    // 例: gzip, deflate;q=0.5, br;q=0, *
+    accept_encoding_ = 0;
+    std::string_view header = accept_encoding;
+    size_t pos = 0;
+    while (pos < header.size()) {
+        size_t end = header.find(',', pos);
+        if (end == std::string_view::npos) {
+            end = header.size();
+        }
+        std::string_view item = header.substr(pos, end - pos);
+        pos = end + 1;
+        std::string_view name = trim(item.substr(0, item.find(';')));
+        // q=0表示不接受, 整个头部以'\0'结尾, strtod遇到','或';'停止
+        size_t q = item.find("q=");
+        if (q != std::string_view::npos && strtod(item.data() + q + 2, nullptr) <= 0) {
+            continue;
+        }
+        if (equalsIgnoreCase(name, "gzip") || name == "*") {
+            accept_encoding_ |= ENCODING_GZIP;
+        } else if (equalsIgnoreCase(name, "br")) {
+            accept_encoding_ |= ENCODING_BR;
+        }
+    }
+}
+
+void HttpResponse::initErrorResponse(const std::string &src_dir) {
+    for (int code: {400, 403, 404, 503}) {
+        std::string body;
+        auto it = CODE_PATH.find(code);
+        FdEntryPtr entry;
+        FileEntryPtr file;
+        if (it != CODE_PATH.end() && AssetBundle::getInstance()->isOpen()) {
+            entry = AssetBundle::getInstance()->find(it->second, &file);
+        } else if (it != CODE_PATH.end()) {
+            entry = FdCache::getInstance()->get(FdCache::normalize(src_dir + it->second));
+        }
+        if (file) {
+            body = file->body;
+        } else if (entry && entry->fd >= 0) {
+            body.resize(entry->file_stat.st_size);
+            ssize_t len = pread(entry->fd, body.data(), body.size(), 0);
+            body.resize(len > 0 ? len : 0);
+        } else {
+            // 没有错误页面(如503)时使用生成的页面
+            body = errorBody(code, code == 503 ? "Server busy!" : "File Not Found!");
+        }
+        ERROR_RESPONSE[code] = "Content-Type: text/html\r\nContent-Length: " + std::to_string(body.size()) +
+                               "\r\n\r\n" + body;
+    }
+}
+
+bool HttpResponse::makeErrorResponse(Buffer &buffer, int code, bool is_keep_alive) {
+    auto it = ERROR_RESPONSE.find(code);
+    if (it == ERROR_RESPONSE.end()) {
+        return false;
+    }
+    buffer.append(findStatus(code)->line);
+    addConnection(buffer, is_keep_alive);
+    buffer.append(it->second);
+    return true;
 }
 
 void HttpResponse::makeResponse(Buffer &buffer) {
+    checkFile();
+    if (findStatus(status_code_) == nullptr) {
+        status_code_ = 400;
+    }
+    // 错误响应已经在内存中生成, 不需要再读取错误页面
+    if (makeErrorResponse(buffer, status_code_, is_keep_alive_)) {
+        unmapFile();
+        return;
+    }
+    parts_.clear();
+    // 范围请求只针对原文件, 不使用压缩版本
+    bool is_range = !range_.empty() && status_code_ == 200;
+    if (!is_range) {
+        selectEncoding();
+    }
+    // 304只发送状态行和验证器, 不需要映射或读取文件
+    if (isNotModified()) {
+        status_code_ = 304;
+        addStateLine(buffer);
+        addConnection(buffer, is_keep_alive_);
+        buffer.append(headerSlot().validators);
+        buffer.append("\r\n");
+        return;
+    }
+    if (is_range && makeRangeResponse(buffer)) {
+        return;
+    }
+    errorHtml();
+    addStateLine(buffer);
+    addHeader(buffer);
+    addContent(buffer);
+}
+
+bool HttpResponse::makeFile() {
+    checkFile();
+    parts_.clear();
+    bool is_range = !range_.empty() && status_code_ == 200;
+    if (!is_range) {
+        selectEncoding();
+    }
+    if (isNotModified()) {
+        status_code_ = 304;
+        return true;
+    }
+    int ranged = is_range ? selectRange() : -1;
+    if (ranged > 0 && ranges_.size() > 1) {
+        ranged = -1;
+    }
+    if (ranged == 0) {
+        status_code_ = 416;
+        return true;
+    }
+    errorHtml();
+    if (!mapFile()) {
+        return false;
+    }
+    if (ranged > 0) {
+        status_code_ = 206;
+        parts_.push_back({"", static_cast<off_t>(ranges_[0].first), ranges_[0].second - ranges_[0].first + 1});
+    } else {
+        parts_.push_back({"", 0, getFileSize()});
+    }
+    return true;
+}
+
+std::string_view HttpResponse::getValidators() {
+    if ((status_code_ != 200 && status_code_ != 206 && status_code_ != 304) || !S_ISREG(mm_file_stat_.st_mode) ||
+        (!file_entry_ && !fd_entry_)) {
+        return {};
+    }
+    return headerSlot().validators;
+}
+
+std::string HttpResponse::getContentRange() const {
+    std::string total = "/" + std::to_string(mm_file_stat_.st_size);
+    if (status_code_ == 416) {
+        return "bytes *" + total;
+    }
+    if (status_code_ == 206 && ranges_.size() == 1) {
+        return "bytes " + std::to_string(ranges_[0].first) + "-" + std::to_string(ranges_[0].second) + total;
+    }
+    return "";
+}
+
+void HttpResponse::checkFile() {
     // index.html -> /home/user/webserver/resources/index.html
     // dir + path: 拼接后的资源路径
     // 获取资源路径失败或者资源路径是一个目录, 返回404
-    if (stat((src_dir_ + path_).data(), &mm_file_stat_) < 0 || S_ISDIR(mm_file_stat_.st_mode)) {
+    // 从缓存获取文件状态, 命中时不需要stat, 不存在的路径同样被缓存
+    if (!statFile() || S_ISDIR(mm_file_stat_.st_mode)) {
         status_code_ = 404;
     } else if (!(mm_file_stat_.st_mode & S_IROTH)) {
         // 文件权限, 可被other读返回1, 否则返回0
@@ -86,72 +330,429 @@ void HttpResponse::makeResponse(Buffer &buffer) {
     } else if (status_code_ == -1) {
         status_code_ = 200;
     }
-    errorHtml();
-    addStateLine(buffer);
-    addHeader(buffer);
-    addContent(buffer);
+}
+
+FdEntryPtr HttpResponse::findFile(const char *suffix, FileEntryPtr *file_entry) {
+    // 在保留容量的file_path_中拼接, 不为每次查找分配临时字符串
+    if (AssetBundle::getInstance()->isOpen()) {
+        // 资源包中的文件内容已经映射, 不访问文件系统
+        file_path_.assign(path_).append(suffix);
+        FdCache::normalizeInPlace(file_path_);
+        return AssetBundle::getInstance()->find(file_path_, file_entry);
+    }
+    file_path_.assign(src_dir_).append(path_).append(suffix);
+    FdCache::normalizeInPlace(file_path_);
+    return FdCache::getInstance()->get(file_path_);
+}
+
+bool HttpResponse::statFile(const char *suffix) {
+    file_entry_.reset();
+    fd_entry_ = findFile(suffix, &file_entry_);
+    if (!fd_entry_->exists) {
+        mm_file_stat_ = {};
+        return false;
+    }
+    mm_file_stat_ = fd_entry_->file_stat;
+    // 小文件直接使用缓存的内容, 状态以内容加载时为准
+    if (!file_entry_ && S_ISREG(mm_file_stat_.st_mode) &&
+        static_cast<size_t>(mm_file_stat_.st_size) <= FileCache::getInstance()->maxFileSize()) {
+        file_entry_ = FileCache::getInstance()->get(fd_entry_->path);
+        if (file_entry_) {
+            mm_file_stat_ = file_entry_->file_stat;
+        }
+    }
+    return true;
+}
+
+void HttpResponse::selectEncoding() {
+    if (status_code_ != 200 || accept_encoding_ == 0 || !S_ISREG(mm_file_stat_.st_mode) || !isCompressible()) {
+        return;
+    }
+    static const struct {
+        int flag;
+        const char *suffix;
+        const char *encoding;
+    } SIBLINGS[] = {
+        {ENCODING_BR, ".br", "br"},
+        {ENCODING_GZIP, ".gz", "gzip"},
+    };
+    for (const auto &sibling: SIBLINGS) {
+        if (!(accept_encoding_ & sibling.flag)) {
+            continue;
+        }
+        // 预压缩文件是否存在同样由FdCache缓存(包括不存在的情况)或在资源包中查找
+        FdEntryPtr entry = findFile(sibling.suffix);
+        if (entry->exists && S_ISREG(entry->file_stat.st_mode) && (entry->file_stat.st_mode & S_IROTH) &&
+            statFile(sibling.suffix)) {
+            encoding_ = sibling.encoding;
+            header_slot_ = HEADER_SIBLING;
+            return;
+        }
+    }
+    if (accept_encoding_ & ENCODING_GZIP) {
+        encoded_ = FileCache::getInstance()->getGzip(file_entry_);
+        if (encoded_) {
+            encoding_ = "gzip";
+            header_slot_ = HEADER_COMPRESSED;
+        }
+    }
+}
+
+bool HttpResponse::isCompressible() {
+    return isCompressible(path_);
+}
+
+bool HttpResponse::isCompressible(std::string_view path) {
+    // 只有已知的文本类型才有压缩版本, 未知后缀和图片, 视频不压缩
+    std::string_view type = suffixType(path);
+    return type.starts_with("text/") || type.ends_with("xml");
 }
 
 char *HttpResponse::getFile() {
+    if (encoded_) {
+        return const_cast<char *>(encoded_->data());
+    }
+    if (file_entry_) {
+        // 只用于发送, 不会被修改
+        return const_cast<char *>(file_entry_->body.data());
+    }
     return mm_file_;
 }
 
 size_t HttpResponse::getFileSize() const {
+    if (encoded_) {
+        return encoded_->size();
+    }
     return mm_file_stat_.st_size;
 }
 
+std::shared_ptr<const void> HttpResponse::getKeeper() const {
+    if (file_entry_) {
+        return file_entry_;
+    }
+    if (file_fd_ >= 0) {
+        return fd_entry_;
+    }
+    return nullptr;
+}
+
 void HttpResponse::errorHtml() {
     if (CODE_PATH.count(status_code_) == 1) {
         path_ = CODE_PATH.find(status_code_)->second;
-        stat((src_dir_ + path_).data(), &mm_file_stat_);
+        statFile();
     }
 }
 
 // 响应行
 void HttpResponse::addStateLine(Buffer &buffer) {
-    std::string status;
-    if (CODE_STATUS.count(status_code_) == 1) {
-        status = CODE_STATUS.find(status_code_)->second;
-    } else {
+    const Status *status = findStatus(status_code_);
+    if (status == nullptr) {
         status_code_ = 400;
-        status = CODE_STATUS.find(status_code_)->second;
+        status = findStatus(status_code_);
     }
-    buffer.append("HTTP/1.1 " + std::to_string(status_code_) + " " + status + "\r\n");
+    buffer.append(status->line);
 }
 
-// 添加响应头
+// 添加响应头, 只有Connection和Date是每次生成的, 其余在addContent中整块追加
 void HttpResponse::addHeader(Buffer &buffer) {
-    buffer.append("Connection: ");
-    if (is_keep_alive_) {
-        buffer.append("keep-alive\r\n");
-        buffer.append("keep-alive: max=6, timeout=120\r\n");
-    } else {
-        buffer.append("close\r\n");
+    addConnection(buffer, is_keep_alive_);
+    if (!set_cookie_.empty()) {
+        buffer.append("Set-Cookie: ");
+        buffer.append(set_cookie_);
+        buffer.append("\r\n");
+    }
+}
+
+void HttpResponse::addConnection(Buffer &buffer, bool is_keep_alive) {
+    static constexpr std::string_view KEEP_ALIVE = "Connection: keep-alive\r\nkeep-alive: max=6, timeout=120\r\n";
+    static constexpr std::string_view CLOSE = "Connection: close\r\n";
+    buffer.append(is_keep_alive ? KEEP_ALIVE : CLOSE);
+    // Date精确到秒, 每个线程每秒只格式化一次
+    thread_local time_t last_time = 0;
+    thread_local char date[64];
+    thread_local size_t date_len = 0;
+    time_t now = time(nullptr);
+    if (now != last_time) {
+        struct tm tm = {};
+        gmtime_r(&now, &tm);
+        date_len = strftime(date, sizeof(date), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+        last_time = now;
     }
-    buffer.append("Content-Type: " + getFileType() + "\r\n");
-    // buffer.append("Content-Length: " + std::to_string(getFileSize()) + "\r\n\r\n");
+    buffer.append(date, date_len);
 }
 
 // 添加响应内容
 void HttpResponse::addContent(Buffer &buffer) {
-    int file_fd = open((src_dir_ + path_).data(), O_RDONLY);
-    if (file_fd < 0) {
+    if (!mapFile()) {
+        buffer.append("Content-Type: text/html\r\n");
         errorContent(buffer, "File Not Found!");
         return;
     }
+    buffer.append(headerBlock());
+    parts_.push_back({"", 0, getFileSize()});
+}
+
+int HttpResponse::selectRange() {
+    if (status_code_ != 200 || !S_ISREG(mm_file_stat_.st_mode)) {
+        return -1;
+    }
+    // If-Range和文件的实体标签(强比较)或修改时间不一致, 说明文件已经改变, 发送整个文件
+    if (!if_range_.empty() && if_range_ != headerSlot().etag) {
+        char date[32];
+        size_t len = formatHttpDate(mm_file_stat_.st_mtime, date, sizeof(date));
+        if (std::string_view(if_range_) != std::string_view(date, len)) {
+            return -1;
+        }
+    }
+    ranges_.clear();
+    return parseRange(range_, mm_file_stat_.st_size, ranges_);
+}
+
+bool HttpResponse::makeRangeResponse(Buffer &buffer) {
+    int ret = selectRange();
+    if (ret < 0) {
+        return false;
+    }
+    size_t size = mm_file_stat_.st_size;
+    if (ret == 0) {
+        status_code_ = 416;
+        unmapFile();
+        addStateLine(buffer);
+        addConnection(buffer, is_keep_alive_);
+        buffer.append("Content-Range: bytes */");
+        buffer.appendNumber(size);
+        buffer.append("\r\nContent-Length: 0\r\n\r\n");
+        return true;
+    }
+    // 范围内容和普通响应一样通过内存映射/缓存或sendfile发送
+    if (!mapFile()) {
+        return false;
+    }
+    status_code_ = 206;
+    addStateLine(buffer);
+    addConnection(buffer, is_keep_alive_);
+    buffer.append(headerSlot().validators);
+    buffer.append("Accept-Ranges: bytes\r\n");
+    if (ranges_.size() == 1) {
+        // 单个范围直接格式化到输出缓冲
+        size_t start = ranges_[0].first, end = ranges_[0].second;
+        buffer.append("Content-Type: ");
+        buffer.append(getFileType());
+        buffer.append("\r\nContent-Range: bytes ");
+        buffer.appendNumber(start);
+        buffer.append("-");
+        buffer.appendNumber(end);
+        buffer.append("/");
+        buffer.appendNumber(size);
+        buffer.append("\r\nContent-Length: ");
+        buffer.appendNumber(end - start + 1);
+        buffer.append("\r\n\r\n");
+        parts_.push_back({"", static_cast<off_t>(start), end - start + 1});
+        return true;
+    }
+    // 多个范围: multipart/byteranges, 每个范围前是分隔行和该部分的头部
+    static const std::string BOUNDARY = "webserver_byteranges_3d6b6a416f9b5c2e";
+    const std::string total = "/" + std::to_string(size);
+    const std::string part_type = std::string("\r\nContent-Type: ").append(getFileType()) + "\r\nContent-Range: bytes ";
+    size_t length = 0;
+    for (const auto &range: ranges_) {
+        std::string head = (parts_.empty() ? "--" : "\r\n--") + BOUNDARY + part_type +
+                           std::to_string(range.first) + "-" + std::to_string(range.second) + total + "\r\n\r\n";
+        size_t len = range.second - range.first + 1;
+        length += head.size() + len;
+        parts_.push_back({std::move(head), static_cast<off_t>(range.first), len});
+    }
+    parts_.push_back({"\r\n--" + BOUNDARY + "--\r\n", 0, 0});
+    length += parts_.back().head.size();
+    buffer.append("Content-Type: multipart/byteranges; boundary=");
+    buffer.append(BOUNDARY);
+    buffer.append("\r\nContent-Length: ");
+    buffer.appendNumber(length);
+    buffer.append("\r\n\r\n");
+    return true;
+}
+
+int HttpResponse::parseRange(std::string_view range, size_t size, std::vector<std::pair<size_t, size_t>> &ranges) {
+    if (range.size() < 6 || !equalsIgnoreCase(range.substr(0, 6), "bytes=")) {
+        return -1;
+    }
+    // 数字已经检查过只含0-9且不超过18位, 不会失败或溢出
+    auto toNumber = [](std::string_view digits) {
+        size_t value = 0;
+        std::from_chars(digits.data(), digits.data() + digits.size(), value);
+        return value;
+    };
+    size_t pos = 6;
+    size_t count = 0;
+    while (pos <= range.size()) {
+        size_t end = range.find(',', pos);
+        if (end == std::string_view::npos) {
+            end = range.size();
+        }
+        std::string_view spec = trim(range.substr(pos, end - pos));
+        pos = end + 1;
+        if (spec.empty()) {
+            continue;
+        }
+        if (++count > MAX_RANGES) {
+            return -1;
+        }
+        // 只允许数字和一个'-', 数字不超过18位防止溢出
+        size_t dash = spec.find('-');
+        if (dash == std::string_view::npos || spec.find_first_not_of("0123456789-") != std::string_view::npos ||
+            spec.find('-', dash + 1) != std::string_view::npos || dash > 18 || spec.size() - dash - 1 > 18) {
+            return -1;
+        }
+        std::string_view first = spec.substr(0, dash), last = spec.substr(dash + 1);
+        if (first.empty() && last.empty()) {
+            return -1;
+        }
+        size_t start, stop;
+        if (first.empty()) {
+            // 后缀范围: 最后n个字节
+            size_t n = toNumber(last);
+            if (n == 0 || size == 0) {
+                continue;
+            }
+            start = n >= size ? 0 : size - n;
+            stop = size - 1;
+        } else {
+            start = toNumber(first);
+            stop = last.empty() ? start : toNumber(last);
+            if (stop < start) {
+                return -1;
+            }
+            if (start >= size) {
+                continue;
+            }
+            stop = last.empty() ? size - 1 : std::min(stop, size - 1);
+        }
+        ranges.emplace_back(start, stop);
+    }
+    if (count == 0) {
+        return -1;
+    }
+    return ranges.empty() ? 0 : 1;
+}
+
+std::string HttpResponse::httpDate(time_t time) {
+    char buf[32];
+    size_t len = formatHttpDate(time, buf, sizeof(buf));
+    return std::string(buf, len);
+}
+
+size_t HttpResponse::formatHttpDate(time_t time, char *buf, size_t len) {
+    struct tm tm = {};
+    gmtime_r(&time, &tm);
+    return strftime(buf, len, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+}
+
+const HeaderSlot &HttpResponse::headerSlot() {
+    // 内容缓存中的文件以内容为准, 否则以文件描述符缓存中的状态为准
+    // 同一个条目按原文件, 预压缩版本和内存压缩内容发送时的响应头不同, 分别保存
+    HeaderSlot &slot = file_entry_ ? file_entry_->headers[header_slot_] : fd_entry_->headers[header_slot_];
+    std::call_once(slot.once, [&]() {
+        // 实体标签由大小和修改时间生成, 压缩版本是不同的实体, 加上编码名区分
+        char etag[96];
+        snprintf(etag, sizeof(etag), "\"%lx-%lx.%lx%s%s\"", static_cast<unsigned long>(mm_file_stat_.st_size),
+                 static_cast<unsigned long>(mm_file_stat_.st_mtim.tv_sec),
+                 static_cast<unsigned long>(mm_file_stat_.st_mtim.tv_nsec), encoding_ ? "-" : "",
+                 encoding_ ? encoding_ : "");
+        slot.etag = etag;
+        slot.validators = "ETag: " + slot.etag + "\r\nLast-Modified: " + httpDate(mm_file_stat_.st_mtime) + "\r\n";
+        if (!CACHE_CONTROL.empty()) {
+            slot.validators += "Cache-Control: " + CACHE_CONTROL + "\r\n";
+        }
+        if (isCompressible()) {
+            slot.validators += "Vary: Accept-Encoding\r\n";
+        }
+        slot.value.assign("Content-Type: ").append(getFileType()).append("\r\n");
+        if (encoding_) {
+            slot.value += std::string("Content-Encoding: ") + encoding_ + "\r\n";
+        }
+        slot.value += slot.validators;
+        // 只有原文件支持范围请求
+        if (header_slot_ == HEADER_IDENTITY) {
+            slot.value += "Accept-Ranges: bytes\r\n";
+        }
+        slot.value += "Content-Length: " + std::to_string(getFileSize()) + "\r\n\r\n";
+    });
+    return slot;
+}
+
+bool HttpResponse::isNotModified() {
+    if (status_code_ != 200 || !S_ISREG(mm_file_stat_.st_mode) || !fd_entry_ ||
+        (if_none_match_.empty() && if_modified_since_.empty())) {
+        return false;
+    }
+    // 有If-None-Match时忽略If-Modified-Since
+    if (!if_none_match_.empty()) {
+        return matchEtag(if_none_match_, headerSlot().etag);
+    }
+    time_t since = parseHttpDate(if_modified_since_);
+    return since >= 0 && mm_file_stat_.st_mtime <= since;
+}
+
+bool HttpResponse::matchEtag(std::string_view if_none_match, std::string_view etag) {
+    size_t pos = 0;
+    while (pos < if_none_match.size()) {
+        size_t end = if_none_match.find(',', pos);
+        if (end == std::string_view::npos) {
+            end = if_none_match.size();
+        }
+        std::string_view tag = trim(if_none_match.substr(pos, end - pos));
+        pos = end + 1;
+        if (tag.starts_with("W/")) {
+            tag.remove_prefix(2);
+        }
+        if (tag == "*" || tag == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+time_t HttpResponse::parseHttpDate(const std::string &date) {
+    struct tm tm = {};
+    const char *end = strptime(date.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (end == nullptr) {
+        return -1;
+    }
+    return timegm(&tm);
+}
+
+// 将资源文件映射到内存, 空文件不需要映射
+// 大文件映射会占用大量地址空间并产生缺页, 改为保留文件描述符, 由连接用sendfile直接从页缓存发送
+bool HttpResponse::mapFile() {
+    if (file_entry_) {
+        return true;
+    }
+    // 文件描述符由FdCache打开并持有, 这里不需要open/close
+    if (!fd_entry_ || fd_entry_->fd < 0) {
+        return false;
+    }
 
     /* 文件映射
      *
      */
-    LOG_DEBUG("file path: %s", (src_dir_ + path_).data());
-    int *mm_ret = (int *) mmap(0, mm_file_stat_.st_size, PROT_READ, MAP_PRIVATE, file_fd, 0);
-    if (*mm_ret == -1) {
-        errorContent(buffer, "File Not Found!");
-        return;
+    LOG_DEBUG("file path: %s%s", src_dir_.data(), path_.data());
+    if (mm_file_stat_.st_size == 0) {
+        return true;
+    }
+    if (static_cast<size_t>(mm_file_stat_.st_size) >= SENDFILE_THRESHOLD) {
+        file_fd_ = fd_entry_->fd;
+        return true;
+    }
+    void *mm_ret = mmap(0, mm_file_stat_.st_size, PROT_READ, MAP_PRIVATE, fd_entry_->fd, 0);
+    if (mm_ret != MAP_FAILED) {
+        // 映射的文件不超过SENDFILE_THRESHOLD, 会被整个顺序发送, 提前异步读入
+        madvise(mm_ret, mm_file_stat_.st_size, MADV_WILLNEED);
+    }
+    if (mm_ret == MAP_FAILED) {
+        return false;
     }
     mm_file_ = (char *) mm_ret;
-    close(file_fd);
-    buffer.append("Content-Length: " + std::to_string(mm_file_stat_.st_size) + "\r\n\r\n");
+    return true;
 }
 
 void HttpResponse::unmapFile() {
@@ -159,36 +760,42 @@ void HttpResponse::unmapFile() {
         munmap(mm_file_, mm_file_stat_.st_size);
         mm_file_ = nullptr;
     }
+    file_fd_ = -1;
+    file_entry_.reset();
+    fd_entry_.reset();
+    encoding_ = nullptr;
+    header_slot_ = HEADER_IDENTITY;
+    encoded_ = nullptr;
 }
 
-std::string HttpResponse::getFileType() {
+std::string_view HttpResponse::getFileType() const {
     // 判断文件类型
-    std::string::size_type idx = path_.find_last_of('.');
-    if (idx == std::string::npos) {
-        return "text/plain";
-    }
-    std::string suffix = path_.substr(idx);
-    if (SUFFIX_TYPE.count(suffix) == 1) {
-        return SUFFIX_TYPE.find(suffix)->second;
-    }
-    return "text/plain";
+    std::string_view type = suffixType(path_);
+    return type.empty() ? "text/plain" : type;
 }
 
 // 获取内容失败时, 指向错误页面
 void HttpResponse::errorContent(Buffer &buffer, std::string msg) {
+    std::string body = errorBody(msg);
+    buffer.append("Content-Length: ");
+    buffer.appendNumber(body.size());
+    buffer.append("\r\n\r\n");
+    buffer.append(body);
+}
+
+std::string HttpResponse::errorBody(const std::string &msg) const {
+    return errorBody(status_code_, msg);
+}
+
+std::string HttpResponse::errorBody(int code, const std::string &msg) {
     std::string body;
-    std::string status;
+    const Status *status = findStatus(code);
     body += "<html><title>Error</title>";
     body += "<body bgcolor=\"ffffff\">";
-    if (CODE_STATUS.count(status_code_) == 1) {
-        status = CODE_STATUS.find(status_code_)->second;
-    } else {
-        status = "Bad Request";
-    }
-    body += std::to_string(status_code_) + " : " + status + "\n";
+    body += std::to_string(code) + " : ";
+    body += status ? status->reason : "Bad Request";
+    body += "\n";
     body += "<p>" + msg + "</p>";
     body += "<hr><em>TinyWebServer</em></body></html>";
-
-    buffer.append("Content-Length: " + std::to_string(body.size()) + "\r\n\r\n");
-    buffer.append(body);
+    return body;
 }
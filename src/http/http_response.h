@@ -6,15 +6,28 @@
 #define HTTP_RESPONSE_H
 #include "buffer/buffer.h"
 #include "logger/logger.h"
+#include "cache/fd_cache.h"
+#include "cache/file_cache.h"
+#include "cache/asset_bundle.h"
 #include <fcntl.h>  // open
 #include <unistd.h> // close
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 #include <sys/stat.h>   // stat
 #include <sys/mman.h>   // mmap, munmap
 
 
 class HttpResponse {
 public:
+    // 响应体的一部分: 先发送head, 再发送文件中[offset, offset + len)的内容
+    // 普通响应只有一部分, multipart/byteranges每个范围一部分, 最后是结束分隔行
+    struct BodyPart {
+        std::string head;
+        off_t offset;
+        size_t len;
+    };
+
     HttpResponse();
 
     ~HttpResponse();
@@ -24,16 +37,81 @@ public:
 
     void makeResponse(Buffer &buffer);
 
+    // 根据请求的Accept-Encoding决定可以使用的压缩格式, 在init之后调用
+    void setAcceptEncoding(const std::string &accept_encoding);
+
+    // 响应使用的Content-Encoding, 没有压缩时返回nullptr
+    const char *getContentEncoding() const { return encoding_; }
+
+    // 请求的Range和If-Range, 在init之后调用
+    void setRange(const std::string &range, const std::string &if_range);
+
+    // 请求的If-None-Match和If-Modified-Since, 在init之后调用
+    void setConditional(const std::string &if_none_match, const std::string &if_modified_since);
+
+    // 静态文件响应的Cache-Control, 为空时不发送
+    static void setCacheControl(const std::string &cache_control);
+
+    // 响应中加上Set-Cookie, 在init之后调用
+    void setCookie(const std::string &cookie) { set_cookie_ = cookie; }
+
+    // 响应头之后依次发送的内容
+    const std::vector<BodyPart> &getBodyParts() const { return parts_; }
+
+    // HTTP-date格式的时间, 如 Sun, 06 Nov 1994 08:49:37 GMT
+    static std::string httpDate(time_t time);
+
+    /// 格式化HTTP-date到buf, 不分配内存
+    /// @return 写入的长度
+    static size_t formatHttpDate(time_t time, char *buf, size_t len);
+
+    // 根据文件类型, 响应是否会随Accept-Encoding变化
+    bool isCompressible();
+
+    static bool isCompressible(std::string_view path);
+
+    // 启动时读取错误页面, 生成完整的400/403/404/503响应
+    static void initErrorResponse(const std::string &src_dir);
+
+    /// 追加一个预先生成的错误响应
+    /// @return 没有该状态码的错误响应时返回false
+    static bool makeErrorResponse(Buffer &buffer, int code, bool is_keep_alive);
+
+    // 只确定状态码并映射文件(大文件只打开), 不生成HTTP/1.1报文(供HTTP/2使用)
+    // 和makeResponse一样处理条件请求(304)和范围请求(单个范围206, 无法满足416), 响应体由getBodyParts给出;
+    // 响应体是一段连续的内容, 多个范围时不生成multipart, 按完整文件响应
+    bool makeFile();
+
+    // 200/206/304响应的ETag, Last-Modified, Cache-Control和Vary, 格式和HTTP/1.1相同, 其他响应为空
+    std::string_view getValidators();
+
+    // 206/416响应的Content-Range, 其他响应为空
+    std::string getContentRange() const;
+
     void unmapFile();
 
     char *getFile();
 
+    // 大文件不做内存映射, 返回打开的文件描述符供sendfile使用, 否则返回-1
+    int getFileFd() const { return file_fd_; }
+
     size_t getFileSize() const;
 
+    // 持有响应体内容(缓存条目或文件描述符)的引用计数, 内存映射的文件返回空
+    std::shared_ptr<const void> getKeeper() const;
+
     void errorContent(Buffer &buffer, std::string msg);
 
+    // 获取内容失败时的错误页面
+    std::string errorBody(const std::string &msg) const;
+
+    static std::string errorBody(int code, const std::string &msg);
+
     int getStatusCode() const { return status_code_; }
 
+    // 路径后缀对应的Content-Type, 指向静态表
+    std::string_view getFileType() const;
+
 private:
     void addStateLine(Buffer &buffer);
 
@@ -41,9 +119,51 @@ private:
 
     void addContent(Buffer &buffer);
 
-    void errorHtml();
+    // 状态行之后的Connection和Date
+    static void addConnection(Buffer &buffer, bool is_keep_alive);
+
+    // 缓存条目对应的Content-Type, Content-Length和验证器, 每个条目只生成一次
+    const HeaderSlot &headerSlot();
+
+    const std::string &headerBlock() { return headerSlot().value; }
+
+    // 条件请求是否命中(文件未改变), 命中时只需要发送304
+    bool isNotModified();
+
+    // If-None-Match中是否有和etag匹配的实体标签(弱比较)
+    static bool matchEtag(std::string_view if_none_match, std::string_view etag);
+
+    // 解析HTTP-date, 失败返回-1
+    static time_t parseHttpDate(const std::string &date);
+
+    void checkFile();
 
-    std::string getFileType();
+    // 从缓存获取文件状态(小文件同时获取内容), 文件不存在返回false
+    // suffix用于获取预压缩的版本(.gz/.br)
+    bool statFile(const char *suffix = "");
+
+    // 查找路径的文件状态, 打开资源包时只在资源包中查找
+    FdEntryPtr findFile(const char *suffix, FileEntryPtr *file_entry = nullptr);
+
+    // 选择压缩版本: 预压缩的.br/.gz文件优先, 其次是内存中压缩的内容
+    void selectEncoding();
+
+    // 生成206/416响应, Range无效或If-Range不匹配时返回false, 按完整文件响应
+    bool makeRangeResponse(Buffer &buffer);
+
+    /// 检查If-Range并解析Range, 结果保存在ranges_
+    /// @return -1: 忽略Range, 按完整文件响应; 0: 没有可满足的范围(416); 1: 成功
+    int selectRange();
+
+    /// 解析Range: bytes=0-499, 1000-, -500
+    /// @param ranges 满足条件的范围[start, end]
+    /// @return -1: 语法错误或不支持, 忽略Range; 0: 没有可满足的范围; 1: 成功
+    static int parseRange(std::string_view range, size_t size, std::vector<std::pair<size_t, size_t>> &ranges);
+
+    // 大文件只打开不映射, 通过getFileFd发送
+    bool mapFile();
+
+    void errorHtml();
 
     int status_code_; // 状态码
     bool is_keep_alive_; // 长连接
@@ -52,9 +172,31 @@ private:
 
     char *mm_file_; // 文件内存映射指针
     struct stat mm_file_stat_; // 文件状态信息
-
-    static const std::unordered_map<std::string, std::string> SUFFIX_TYPE; // 后缀类型
-    static const std::unordered_map<int, std::string> CODE_STATUS; // 状态码-描述
+    int file_fd_; // 通过sendfile发送的大文件, 由fd_entry_持有
+    FdEntryPtr fd_entry_; // 资源路径对应的文件描述符和状态
+    FileEntryPtr file_entry_; // 命中文件缓存时持有的文件内容, 此时不做内存映射
+    int accept_encoding_; // 客户端接受的压缩格式
+    const char *encoding_; // 响应的Content-Encoding
+    HEADER_SLOT header_slot_; // 使用条目的哪个预先生成的响应头
+    const std::string *encoded_; // 内存中压缩后的内容, 由file_entry_持有
+    std::string range_; // 请求的Range
+    std::string if_range_; // 请求的If-Range
+    std::string if_none_match_; // 请求的If-None-Match
+    std::string if_modified_since_; // 请求的If-Modified-Since
+    std::string set_cookie_; // Set-Cookie的值
+    std::vector<BodyPart> parts_; // 响应体
+    std::vector<std::pair<size_t, size_t>> ranges_; // 解析出的范围, 连接复用时保留容量
+    std::string file_path_; // 拼接查找路径用, 保留容量, 命中缓存时不分配内存
+
+    enum ENCODING {
+        ENCODING_GZIP = 1,
+        ENCODING_BR = 2,
+    };
+
+    static const size_t MAX_RANGES = 16; // 超过该数量的Range被忽略, 防止放大攻击
+    static const size_t SENDFILE_THRESHOLD = 256 * 1024; // 超过该大小的文件使用sendfile发送
+    static std::unordered_map<int, std::string> ERROR_RESPONSE; // 状态码-Date之后的错误响应
+    static std::string CACHE_CONTROL; // 静态文件的Cache-Control
     static const std::unordered_map<int, std::string> CODE_PATH; // 状态码-路径
 };
 
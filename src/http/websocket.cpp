@@ -0,0 +1,380 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "websocket.h"
+
+#include <string.h>
+#include <sys/epoll.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "logger/logger.h"
+
+WebSocket::MessageHandler WebSocket::handler;
+std::mutex WebSocket::registry_mutex_;
+std::unordered_set<WebSocket *> WebSocket::registry_;
+
+namespace {
+const char WEBSOCKET_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// 关闭码
+const uint16_t CLOSE_NORMAL = 1000;
+const uint16_t CLOSE_PROTOCOL_ERROR = 1002;
+const uint16_t CLOSE_POLICY_VIOLATION = 1008;
+const uint16_t CLOSE_TOO_BIG = 1009;
+
+// SHA-1, 只用于握手
+void sha1(const std::string &input, uint8_t digest[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string msg = input;
+    uint64_t bit_len = static_cast<uint64_t>(input.size()) * 8;
+    msg.push_back(static_cast<char>(0x80));
+    while (msg.size() % 64 != 56) {
+        msg.push_back(0);
+    }
+    for (int i = 7; i >= 0; --i) {
+        msg.push_back(static_cast<char>(bit_len >> (i * 8)));
+    }
+    auto rol = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+    for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const auto *p = reinterpret_cast<const uint8_t *>(msg.data() + chunk + i * 4);
+            w[i] = (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    for (int i = 0; i < 5; ++i) {
+        digest[i * 4] = static_cast<uint8_t>(h[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(h[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(h[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(h[i]);
+    }
+}
+
+std::string base64Encode(const uint8_t *data, size_t len) {
+    static const char TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string res;
+    res.reserve((len + 2) / 3 * 4);
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t n = data[i] << 16;
+        if (i + 1 < len) n |= data[i + 1] << 8;
+        if (i + 2 < len) n |= data[i + 2];
+        res.push_back(TABLE[(n >> 18) & 0x3f]);
+        res.push_back(TABLE[(n >> 12) & 0x3f]);
+        res.push_back(i + 1 < len ? TABLE[(n >> 6) & 0x3f] : '=');
+        res.push_back(i + 2 < len ? TABLE[n & 0x3f] : '=');
+    }
+    return res;
+}
+} // namespace
+
+void websocketUnmask(char *data, size_t len, const uint8_t mask[4], size_t offset) {
+    // 按偏移旋转掩码, 使key[0]对应data[0]
+    uint8_t key[4];
+    for (int i = 0; i < 4; ++i) {
+        key[i] = mask[(offset + i) % 4];
+    }
+    size_t i = 0;
+#if defined(__SSE2__)
+    uint32_t key32;
+    memcpy(&key32, key, 4);
+    const __m128i key128 = _mm_set1_epi32(static_cast<int>(key32));
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), _mm_xor_si128(block, key128));
+    }
+#elif defined(__ARM_NEON)
+    uint8_t key16[16];
+    for (int j = 0; j < 16; ++j) {
+        key16[j] = key[j % 4];
+    }
+    const uint8x16_t key128 = vld1q_u8(key16);
+    for (; i + 16 <= len; i += 16) {
+        uint8_t *p = reinterpret_cast<uint8_t *>(data + i);
+        vst1q_u8(p, veorq_u8(vld1q_u8(p), key128));
+    }
+#endif
+    // 剩余部分先按8字节处理, 16的倍数不会改变掩码的相位
+    uint64_t key64 = 0;
+    for (int j = 0; j < 8; ++j) {
+        key64 |= static_cast<uint64_t>(key[j % 4]) << (j * 8);
+    }
+    for (; i + 8 <= len; i += 8) {
+        uint64_t block;
+        memcpy(&block, data + i, 8);
+        block ^= key64;
+        memcpy(data + i, &block, 8);
+    }
+    for (; i < len; ++i) {
+        data[i] ^= key[i % 4];
+    }
+}
+
+WebSocket::WebSocket(int fd, const std::string &path) : fd_(fd), path_(path) {
+    closing_ = false;
+    fragmented_ = false;
+    fragment_binary_ = false;
+    // 创建者是正在处理该连接的工作线程
+    busy_ = true;
+    queued_bytes_ = 0;
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    registry_.insert(this);
+}
+
+WebSocket::~WebSocket() {
+    // 必须在关闭套接字之前注销, 防止广播对复用的fd注册事件
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    registry_.erase(this);
+}
+
+std::string WebSocket::acceptKey(const std::string &key) {
+    uint8_t digest[20];
+    sha1(key + WEBSOCKET_GUID, digest);
+    return base64Encode(digest, sizeof(digest));
+}
+
+WebSocket::Frame WebSocket::makeFrame(OPCODE opcode, const char *data, size_t len) {
+    auto frame = std::make_shared<std::string>();
+    frame->reserve(len + 10);
+    frame->push_back(static_cast<char>(0x80 | opcode));
+    if (len < 126) {
+        frame->push_back(static_cast<char>(len));
+    } else if (len <= 0xffff) {
+        frame->push_back(126);
+        frame->push_back(static_cast<char>(len >> 8));
+        frame->push_back(static_cast<char>(len));
+    } else {
+        frame->push_back(127);
+        for (int i = 7; i >= 0; --i) {
+            frame->push_back(static_cast<char>(static_cast<uint64_t>(len) >> (i * 8)));
+        }
+    }
+    frame->append(data, len);
+    return frame;
+}
+
+void WebSocket::broadcast(const Frame &frame, const std::function<void(int fd)> &wakeup) {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    for (WebSocket *ws: registry_) {
+        if (ws->send(frame)) {
+            wakeup(ws->fd_);
+        }
+    }
+}
+
+bool WebSocket::send(const std::string &message, bool is_binary) {
+    return send(makeFrame(is_binary ? BINARY : TEXT, message.data(), message.size()));
+}
+
+bool WebSocket::send(const Frame &frame) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closing_) {
+        return false;
+    }
+    // 客户端读得比广播慢时队列会无限增长, 超过上限就放弃这个客户端: 丢弃排队的帧, 只发送CLOSE帧
+    // 队列为空时总是接受, 单个大帧不受限制
+    if (!frames_.empty() && frame->size() > MAX_QUEUED_BYTES - queued_bytes_) {
+        size_t queued = queued_bytes_;
+        char payload[2] = {static_cast<char>(CLOSE_POLICY_VIOLATION >> 8),
+                           static_cast<char>(CLOSE_POLICY_VIOLATION & 0xff)};
+        frames_.clear();
+        frames_.push_back(makeFrame(CLOSE, payload, sizeof(payload)));
+        queued_bytes_ = frames_.back()->size();
+        closing_ = true;
+        bool idle = !busy_;
+        lock.unlock();
+        LOG_WARN("WebSocket[%d] send queue full(%zu bytes), close code: %d", fd_, queued, CLOSE_POLICY_VIOLATION);
+        return idle;
+    }
+    frames_.push_back(frame);
+    queued_bytes_ += frame->size();
+    return !busy_;
+}
+
+WebSocket::Frame WebSocket::nextFrame() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frames_.empty()) {
+        return nullptr;
+    }
+    Frame frame = std::move(frames_.front());
+    frames_.pop_front();
+    queued_bytes_ -= frame->size();
+    return frame;
+}
+
+bool WebSocket::acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (busy_) {
+        return false;
+    }
+    busy_ = true;
+    return true;
+}
+
+uint32_t WebSocket::release(uint32_t events) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    busy_ = false;
+    if (!frames_.empty()) {
+        events |= EPOLLOUT;
+    }
+    return events;
+}
+
+void WebSocket::onRead(Buffer &in, Buffer &out) {
+    while (!closing_ && in.readableBytes() >= 2) {
+        const auto *p = reinterpret_cast<const uint8_t *>(in.peek());
+        bool fin = (p[0] & 0x80) != 0;
+        uint8_t opcode = p[0] & 0x0f;
+        bool masked = (p[1] & 0x80) != 0;
+        uint64_t len = p[1] & 0x7f;
+        size_t header_len = 2 + (len == 126 ? 2 : (len == 127 ? 8 : 0)) + (masked ? 4 : 0);
+        // 没有协商扩展, RSV位必须为0; 客户端发送的帧必须带掩码
+        if ((p[0] & 0x70) != 0 || !masked) {
+            fail(out, CLOSE_PROTOCOL_ERROR);
+            break;
+        }
+        if (in.readableBytes() < header_len) {
+            break;
+        }
+        if (len == 126) {
+            len = (p[2] << 8) | p[3];
+        } else if (len == 127) {
+            // 64位长度的最高位必须为0
+            if ((p[2] & 0x80) != 0) {
+                fail(out, CLOSE_PROTOCOL_ERROR);
+                break;
+            }
+            len = 0;
+            for (int i = 0; i < 8; ++i) {
+                len = (len << 8) | p[2 + i];
+            }
+        }
+        bool control = (opcode & 0x08) != 0;
+        // 控制帧不能分片, 载荷最多125字节
+        if (control && (!fin || len > 125)) {
+            fail(out, CLOSE_PROTOCOL_ERROR);
+            break;
+        }
+        // 用减法比较, len来自客户端, 相加可能溢出
+        if (len > MAX_MESSAGE_SIZE - message_.size()) {
+            fail(out, CLOSE_TOO_BIG);
+            break;
+        }
+        if (in.readableBytes() - header_len < len) {
+            break;
+        }
+        const uint8_t *mask = p + header_len - 4;
+        std::string payload(in.peek() + header_len, len);
+        websocketUnmask(payload.data(), payload.size(), mask);
+        in.retrieve(header_len + len);
+
+        switch (opcode) {
+            case CONTINUATION:
+                if (!fragmented_) {
+                    fail(out, CLOSE_PROTOCOL_ERROR);
+                    break;
+                }
+                message_ += payload;
+                if (fin) {
+                    fragmented_ = false;
+                    deliver(message_, fragment_binary_);
+                    std::string().swap(message_);
+                }
+                break;
+            case TEXT:
+            case BINARY:
+                // 上一个分片消息还没结束
+                if (fragmented_) {
+                    fail(out, CLOSE_PROTOCOL_ERROR);
+                    break;
+                }
+                if (fin) {
+                    deliver(payload, opcode == BINARY);
+                } else {
+                    fragmented_ = true;
+                    fragment_binary_ = (opcode == BINARY);
+                    message_ = std::move(payload);
+                }
+                break;
+            case CLOSE: {
+                // 回复相同的关闭码
+                uint16_t code = CLOSE_NORMAL;
+                if (payload.size() >= 2) {
+                    code = static_cast<uint16_t>((static_cast<uint8_t>(payload[0]) << 8) |
+                                                 static_cast<uint8_t>(payload[1]));
+                }
+                sendClose(out, code);
+                break;
+            }
+            case PING: {
+                Frame pong = makeFrame(PONG, payload.data(), payload.size());
+                out.append(*pong);
+                break;
+            }
+            case PONG:
+                break;
+            default:
+                fail(out, CLOSE_PROTOCOL_ERROR);
+                break;
+        }
+    }
+    if (closing_) {
+        in.retrieveAll();
+    }
+}
+
+void WebSocket::deliver(std::string &message, bool is_binary) {
+    if (handler) {
+        handler(this, message, is_binary);
+    }
+}
+
+void WebSocket::fail(Buffer &out, uint16_t code) {
+    LOG_WARN("WebSocket[%d] protocol error, close code: %d", fd_, code);
+    sendClose(out, code);
+}
+
+void WebSocket::sendClose(Buffer &out, uint16_t code) {
+    char payload[2] = {static_cast<char>(code >> 8), static_cast<char>(code & 0xff)};
+    Frame frame = makeFrame(CLOSE, payload, sizeof(payload));
+    out.append(*frame);
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_ = true;
+    frames_.clear();
+    queued_bytes_ = 0;
+}
@@ -0,0 +1,110 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include "buffer/buffer.h"
+
+// 升级后的WebSocket连接(RFC 6455), 仍由HttpConnection持有,
+// 复用原来的Epoller, 定时器和线程池
+class WebSocket {
+public:
+    enum OPCODE : uint8_t {
+        CONTINUATION = 0x0,
+        TEXT = 0x1,
+        BINARY = 0x2,
+        CLOSE = 0x8,
+        PING = 0x9,
+        PONG = 0xa,
+    };
+
+    using Frame = std::shared_ptr<const std::string>;
+    // 收到完整消息时的回调, 在工作线程中执行
+    using MessageHandler = std::function<void(WebSocket *ws, const std::string &message, bool is_binary)>;
+
+    WebSocket(int fd, const std::string &path);
+
+    ~WebSocket();
+
+    // 根据Sec-WebSocket-Key计算Sec-WebSocket-Accept
+    static std::string acceptKey(const std::string &key);
+
+    // 序列化一个服务端帧(不带掩码)
+    static Frame makeFrame(OPCODE opcode, const char *data, size_t len);
+
+    /// 将同一个帧发送给所有WebSocket连接, 帧只序列化一次
+    /// @param frame makeFrame生成的帧
+    /// @param wakeup 对空闲连接调用, 负责注册EPOLLOUT
+    static void broadcast(const Frame &frame, const std::function<void(int fd)> &wakeup);
+
+    // 解析in中完整的帧, 控制帧的回复写入out
+    void onRead(Buffer &in, Buffer &out);
+
+    // 发送一条消息, 返回连接是否空闲(空闲时需要由调用者注册EPOLLOUT)
+    // 待发送的帧超过MAX_QUEUED_BYTES时丢弃队列, 改为发送1008关闭连接
+    bool send(const std::string &message, bool is_binary = false);
+
+    bool send(const Frame &frame);
+
+    // 取出下一个待发送的帧, 没有则返回nullptr
+    Frame nextFrame();
+
+    // 主线程分发事件前调用, 连接正在被工作线程处理时返回false
+    bool acquire();
+
+    // 工作线程处理完毕时调用, 有待发送的帧时追加EPOLLOUT
+    uint32_t release(uint32_t events);
+
+    // 已发送或收到CLOSE帧
+    bool isClosed() const { return closing_; }
+
+    int getFd() const { return fd_; }
+
+    const std::string &path() const { return path_; }
+
+    static MessageHandler handler;
+
+    static const size_t MAX_MESSAGE_SIZE = 1024 * 1024;
+
+    static const size_t MAX_QUEUED_BYTES = 4 * 1024 * 1024; // 每个连接排队等待发送的帧的总字节数
+
+private:
+    // 协议错误, 发送CLOSE帧后关闭
+    void fail(Buffer &out, uint16_t code);
+
+    void sendClose(Buffer &out, uint16_t code);
+
+    void deliver(std::string &message, bool is_binary);
+
+    int fd_;
+    std::string path_;
+    std::atomic<bool> closing_; // 已发送CLOSE帧, 广播线程也会设置
+    bool fragmented_; // 正在接收分片消息
+    bool fragment_binary_; // 分片消息的类型
+    std::string message_; // 分片消息的内容
+
+    std::mutex mutex_; // 保护以下成员, 广播可能来自任意线程
+    bool busy_; // 正在被工作线程处理
+    std::deque<Frame> frames_; // 待发送的帧
+    size_t queued_bytes_; // frames_中帧的总字节数
+
+    static std::mutex registry_mutex_;
+    static std::unordered_set<WebSocket *> registry_; // 所有WebSocket连接
+};
+
+// 用掩码异或payload, offset为payload在整个帧载荷中的偏移
+void websocketUnmask(char *data, size_t len, const uint8_t mask[4], size_t offset = 0);
+
+#endif //WEBSOCKET_H
@@ -0,0 +1,60 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef CO_EXECUTOR_H
+#define CO_EXECUTOR_H
+#pragma once
+
+#include <coroutine>
+#include <type_traits>
+
+#include "co_task.h"
+#include "executor.h"
+#include "sqlconnRAll.h"
+
+// co_await resumeOn(type): 把当前协程交给指定的执行器恢复, 挂起期间不占用任何线程
+// 执行器还没有初始化时(测试, 启动阶段)不切换, 直接继续执行
+inline auto resumeOn(Executors::EXECUTOR_TYPE type) {
+    struct Awaiter {
+        Executors::EXECUTOR_TYPE type;
+
+        bool await_ready() const noexcept { return !Executors::getInstance()->isInit(type); }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            Executors::getInstance()->addTask(type, [handle] { handle.resume(); });
+        }
+
+        void await_resume() noexcept {}
+    };
+    return Awaiter{type};
+}
+
+// co_await dbQuery(func): 在阻塞执行器中用连接池的一个连接执行func(MYSQL *), 归还连接后回到快速执行器, 返回func的结果
+// 取连接超时或数据库不可用时func收到nullptr
+// 等待连接和查询期间快速执行器的线程可以处理其他请求
+template<typename F>
+CoTask<std::invoke_result_t<F &, MYSQL *>> dbQuery(F func) {
+    using Result = std::invoke_result_t<F &, MYSQL *>;
+    co_await resumeOn(Executors::EXECUTOR_BLOCKING);
+    if constexpr (std::is_void_v<Result>) {
+        {
+            MYSQL *sql = nullptr;
+            SQLConnRAll guard(&sql, SQLConnPool::getInstance());
+            func(sql);
+        }
+        co_await resumeOn(Executors::EXECUTOR_FAST);
+    } else {
+        std::optional<Result> result;
+        {
+            MYSQL *sql = nullptr;
+            SQLConnRAll guard(&sql, SQLConnPool::getInstance());
+            result.emplace(func(sql));
+        }
+        co_await resumeOn(Executors::EXECUTOR_FAST);
+        co_return std::move(*result);
+    }
+}
+
+
+#endif //CO_EXECUTOR_H
@@ -0,0 +1,199 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef CO_TASK_H
+#define CO_TASK_H
+#pragma once
+
+#include <assert.h>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "logger/logger.h"
+
+// 协程任务: CoTask<T>是返回T的协程, 线程池的任务类型是Task, 这里用CoTask区分
+// - 惰性启动: 创建时不执行, 被co_await时才开始, 完成后通过对称转移直接恢复等待它的协程(不经过调度, 不增加栈深度)
+// - 顶层任务用detach()启动, 完成后自己销毁协程帧
+// - 协程在哪个线程恢复由等待的对象决定: 套接字和定时器在快速执行器中恢复, resumeOn切换到指定的执行器
+template<typename T = void>
+class CoTask;
+
+namespace detail {
+struct PromiseBase {
+    std::coroutine_handle<> continuation; // 等待本协程的协程
+    std::exception_ptr exception;
+    bool detached = false; // detach后完成时自己销毁
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template<typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept {
+            PromiseBase &promise = handle.promise();
+            if (promise.continuation) {
+                return promise.continuation;
+            }
+            if (promise.detached) {
+                if (promise.exception) {
+                    LOG_ERROR("CoTask: detached coroutine exited with an exception");
+                }
+                handle.destroy();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+    void rethrow() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+template<typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+
+    CoTask<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U &&result) { value.emplace(std::forward<U>(result)); }
+
+    T result() {
+        rethrow();
+        return std::move(*value);
+    }
+};
+
+template<>
+struct Promise<void> : PromiseBase {
+    CoTask<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void result() { rethrow(); }
+};
+} // namespace detail
+
+template<typename T>
+class CoTask {
+public:
+    using promise_type = detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    CoTask() noexcept = default;
+
+    explicit CoTask(Handle handle) noexcept: handle_(handle) {}
+
+    CoTask(CoTask &&other) noexcept: handle_(std::exchange(other.handle_, nullptr)) {}
+
+    CoTask &operator=(CoTask &&other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    CoTask(const CoTask &) = delete;
+
+    CoTask &operator=(const CoTask &) = delete;
+
+    ~CoTask() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    // co_await task: 启动task, 完成后恢复当前协程并返回结果(或重新抛出异常)
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            Handle handle;
+
+            bool await_ready() noexcept { return !handle || handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+                handle.promise().continuation = caller;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().result(); }
+        };
+        return Awaiter{handle_};
+    }
+
+    // 在当前线程开始执行, 第一次挂起时返回. 协程帧由协程自己在完成时销毁
+    void detach() {
+        assert(handle_);
+        Handle handle = std::exchange(handle_, nullptr);
+        handle.promise().detached = true;
+        handle.resume();
+    }
+
+    bool done() const { return !handle_ || handle_.done(); }
+
+private:
+    Handle handle_;
+};
+
+namespace detail {
+template<typename T>
+CoTask<T> Promise<T>::get_return_object() noexcept {
+    return CoTask<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline CoTask<void> Promise<void>::get_return_object() noexcept {
+    return CoTask<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+} // namespace detail
+
+// 阻塞当前线程直到task完成, 返回它的结果. 只用于测试和启动阶段, 不能在执行器的线程中调用
+template<typename T>
+T syncWait(CoTask<T> task) {
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done = false;
+    std::exception_ptr exception;
+    std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> value;
+    auto wrapper = [&]() -> CoTask<void> {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await std::move(task);
+            } else {
+                value.emplace(co_await std::move(task));
+            }
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        condition.notify_one();
+    };
+    wrapper().detach();
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&] { return done; });
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*value);
+    }
+}
+
+
+#endif //CO_TASK_H
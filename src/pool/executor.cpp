@@ -0,0 +1,41 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "executor.h"
+
+Executors *Executors::getInstance() {
+    static Executors instance;
+    return &instance;
+}
+
+Executors::~Executors() {
+    shutdown();
+}
+
+void Executors::init(EXECUTOR_TYPE type, Threadpool::Options options) {
+    assert(type < EXECUTOR_COUNT);
+    if (options.name == nullptr || *options.name == '\0') {
+        options.name = name(type);
+    }
+    // 重复初始化时先等待旧的线程池执行完
+    pools_[type].reset();
+    pools_[type] = std::make_unique<Threadpool>(options);
+}
+
+void Executors::shutdown() {
+    for (auto &pool: pools_) {
+        pool.reset();
+    }
+}
+
+const char *Executors::name(EXECUTOR_TYPE type) {
+    switch (type) {
+        case EXECUTOR_FAST:
+            return "fast";
+        case EXECUTOR_BLOCKING:
+            return "blocking";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,61 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+#pragma once
+
+#include <assert.h>
+#include <memory>
+
+#include "threadpool.h"
+
+// 按用途划分的执行器, 每个执行器是一个独立的线程池, 线程数(并发数)互不影响
+// EXECUTOR_FAST: 读写套接字, 解析请求, 生成静态文件的响应, 任务都很短
+// EXECUTOR_BLOCKING: 数据库查询等会阻塞的工作. 线程数和数据库连接数相同,
+//     积压时任务在自己的队列中排队, 不会占满FAST的线程而拖慢静态请求
+class Executors {
+public:
+    enum EXECUTOR_TYPE {
+        EXECUTOR_FAST = 0,
+        EXECUTOR_BLOCKING,
+        EXECUTOR_COUNT,
+    };
+
+    // 单例模式, 全局保留一个实例
+    static Executors *getInstance();
+
+    // 创建执行器, options.name为空时使用执行器的名称
+    void init(EXECUTOR_TYPE type, Threadpool::Options options);
+
+    // 按FAST, BLOCKING的顺序销毁: FAST的任务可能向BLOCKING提交, BLOCKING的任务不会向FAST提交
+    // 每个线程池都执行完剩余的任务后才返回, 不能在执行器的线程中调用
+    void shutdown();
+
+    template<typename T>
+    void addTask(EXECUTOR_TYPE type, T &&task) {
+        get(type)->addTask(std::forward<T>(task));
+    }
+
+    Threadpool *get(EXECUTOR_TYPE type) {
+        assert(type < EXECUTOR_COUNT && pools_[type]);
+        return pools_[type].get();
+    }
+
+    bool isInit(EXECUTOR_TYPE type) const {
+        return type < EXECUTOR_COUNT && pools_[type] != nullptr;
+    }
+
+    static const char *name(EXECUTOR_TYPE type);
+
+private:
+    Executors() = default;
+
+    ~Executors();
+
+    std::unique_ptr<Threadpool> pools_[EXECUTOR_COUNT];
+};
+
+
+#endif //EXECUTOR_H
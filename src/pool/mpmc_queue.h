@@ -0,0 +1,137 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <utility>
+
+// 有界的多生产者多消费者无锁环形队列(Dmitry Vyukov的实现)
+// 每个格子有一个序号: 序号等于入队位置时可写, 等于位置+1时可读, 读完后加上容量留给下一圈
+// 入队和出队各只需要一次CAS, 元素直接存放在格子中, 不分配内存
+// 每个元素可以附带一个时间戳(如入队时间), 用于统计排队时间
+template<typename T>
+class MpmcQueue {
+public:
+    explicit MpmcQueue(size_t capacity = 8192) {
+        capacity_ = 2;
+        while (capacity_ < capacity) {
+            capacity_ <<= 1;
+        }
+        mask_ = capacity_ - 1;
+        cells_ = std::make_unique<Cell[]>(capacity_);
+        for (size_t i = 0; i < capacity_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue &) = delete;
+
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+    ~MpmcQueue() {
+        T item;
+        while (tryPop(item)) {
+        }
+    }
+
+    /// 入队, 成功时value被移走
+    /// @param stamp 和元素一起保存的时间戳
+    /// @return 队列满时返回false, value不变
+    bool tryPush(T &&value, int64_t stamp = 0) {
+        Cell *cell;
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // 这个格子上一圈的元素还没有被取走
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        new(cell->storage) T(std::move(value));
+        cell->stamp.store(stamp, std::memory_order_relaxed);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 出队, 队列为空返回false, stamp不为空时返回入队时的时间戳
+    bool tryPop(T &value, int64_t *stamp = nullptr) {
+        Cell *cell;
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        T *item = std::launder(reinterpret_cast<T *>(cell->storage));
+        value = std::move(*item);
+        item->~T();
+        if (stamp) {
+            *stamp = cell->stamp.load(std::memory_order_relaxed);
+        }
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 近似的元素个数
+    size_t size() const {
+        size_t enqueue = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t dequeue = dequeue_pos_.load(std::memory_order_relaxed);
+        return enqueue > dequeue ? enqueue - dequeue : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // 队头元素的时间戳, 队列为空返回-1. 只用于统计: 和出队并发时可能读到下一个元素的时间戳
+    int64_t headStamp() const {
+        size_t pos = dequeue_pos_.load(std::memory_order_acquire);
+        const Cell &cell = cells_[pos & mask_];
+        if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return -1;
+        }
+        return cell.stamp.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        std::atomic<int64_t> stamp;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t capacity_;
+    size_t mask_;
+    // 生产者和消费者的位置放在不同的缓存行
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+};
+
+
+#endif //MPMC_QUEUE_H
@@ -4,7 +4,10 @@
 
 #include "sqlconnpool.h"
 
+#include <mysql/errmsg.h>
 #include <assert.h>
+#include <algorithm>
+#include <thread>
 
 #include "logger/logger.h"
 
@@ -24,59 +27,289 @@ void SQLConnPool::initConnPool(const char *host, int port,
     const char *user, const char *pwd,
     const char *db_name, int conn_size) {
     assert(conn_size > 0);
-    for (int i = 0; i < conn_size; ++i) {
-        MYSQL *sql_conn = nullptr;
-        sql_conn = mysql_init(sql_conn);
-        if (!sql_conn) {
-            LOG_ERROR("MYSQL init error!");
-            assert(sql_conn);
-        }
-        sql_conn = mysql_real_connect(sql_conn, host,
-            user, pwd, db_name,
-            port, nullptr, 0);
+    Options options;
+    options.min_conn = conn_size;
+    options.max_conn = conn_size;
+    initConnPool(host, port, user, pwd, db_name, options);
+}
 
-        if (!sql_conn) {
-            LOG_ERROR("MYSQL connect error!");
+void SQLConnPool::initConnPool(const char *host, int port,
+    const char *user, const char *pwd,
+    const char *db_name, const Options &options) {
+    assert(options.min_conn >= 0);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        assert(closed_ && total_ == 0);
+        host_ = host;
+        port_ = port;
+        user_ = user;
+        pwd_ = pwd;
+        db_name_ = db_name;
+        options_ = options;
+        options_.max_conn = std::max({options.max_conn, options.min_conn, 1});
+        checkouts_ = timeouts_ = reconnects_ = connect_errors_ = wait_total_us_ = wait_max_us_ = 0;
+        closed_ = false;
+        // 先占用名额, 连接失败时再退还
+        total_ = options_.min_conn;
+    }
+    // 多个线程同时使用客户端库之前必须先初始化
+    mysql_library_init(0, nullptr, nullptr);
+    // 并行建立连接, 启动时间是一次连接的时间而不是conn_size次
+    std::vector<MYSQL *> conns(options_.min_conn, nullptr);
+    std::vector<std::thread> threads;
+    threads.reserve(options_.min_conn);
+    for (int i = 0; i < options_.min_conn; ++i) {
+        threads.emplace_back([this, &conns, i] { conns[i] = connect(); });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    int failed = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Clock::time_point now = Clock::now();
+        for (MYSQL *sql: conns) {
+            if (sql) {
+                idle_.push_back({sql, now});
+            } else {
+                // 连接失败的名额留给之后按需建立
+                --total_;
+                ++failed;
+            }
         }
-        conn_que_.push(sql_conn);
     }
-    MAX_CONN_ = conn_size;
-    sem_init(&sem_id_, 0, MAX_CONN_);
+    if (failed > 0) {
+        LOG_ERROR("SQLConnPool: %d of %d connections failed, retry on demand", failed, options_.min_conn);
+    }
+    LOG_INFO("SQLConnPool: %d connections, max %d", options_.min_conn - failed, options_.max_conn);
 }
 
-MYSQL *SQLConnPool::getConn() {
-    MYSQL *sql = nullptr;
-    if (conn_que_.empty()) {
-        LOG_WARN("SQLConnPool busy!");
+MYSQL *SQLConnPool::connect() {
+    MYSQL *sql = mysql_init(nullptr);
+    if (!sql) {
+        LOG_ERROR("MYSQL init error!");
         return nullptr;
     }
-    sem_wait(&sem_id_);
+    // 数据库不可达时不要阻塞太久
+    unsigned int timeout = options_.connect_timeout_s;
+    mysql_options(sql, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+    if (!mysql_real_connect(sql, host_.c_str(), user_.c_str(), pwd_.c_str(), db_name_.c_str(),
+                            port_, nullptr, 0)) {
+        LOG_ERROR("MYSQL connect error: %s", mysql_error(sql));
+        mysql_close(sql);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++connect_errors_;
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stmts_[sql];
+    return sql;
+}
+
+void SQLConnPool::disconnect(MYSQL *sql) {
+    std::vector<std::unique_ptr<SQLStmt>> stmts;
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        sql = conn_que_.front();
-        conn_que_.pop();
+        auto it = stmts_.find(sql);
+        if (it != stmts_.end()) {
+            stmts = std::move(it->second);
+            stmts_.erase(it);
+        }
+    }
+    // 语句在连接关闭之前释放
+    stmts.clear();
+    mysql_close(sql);
+}
+
+MYSQL *SQLConnPool::revive(MYSQL *sql) {
+    // mysql_ping成功返回0; MySQL 8不再自动重连, 失败时换一个新连接
+    if (mysql_ping(sql) == 0) {
+        return sql;
+    }
+    LOG_WARN("SQLConnPool: stale connection: %s, reconnect", mysql_error(sql));
+    disconnect(sql);
+    sql = connect();
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++reconnects_;
+    if (!sql) {
+        --total_;
+        --busy_;
+        cond_.notify_one();
     }
     return sql;
 }
 
+void SQLConnPool::recordCheckout(Clock::time_point start, bool ok) {
+    uint64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ok) {
+        ++checkouts_;
+        wait_total_us_ += wait_us;
+        wait_max_us_ = std::max(wait_max_us_, wait_us);
+    } else {
+        ++timeouts_;
+    }
+}
+
+MYSQL *SQLConnPool::getConn() {
+    return getConn(options_.timeout_ms);
+}
+
+MYSQL *SQLConnPool::getConn(int timeout_ms) {
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::milliseconds(timeout_ms);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!closed_) {
+        if (!idle_.empty()) {
+            IdleConn conn = idle_.back();
+            idle_.pop_back();
+            ++busy_;
+            bool check = start - conn.last_used >= std::chrono::milliseconds(options_.ping_idle_ms);
+            lock.unlock();
+            MYSQL *sql = check ? revive(conn.sql) : conn.sql;
+            recordCheckout(start, sql != nullptr);
+            return sql;
+        }
+        if (total_ < options_.max_conn) {
+            // 按需建立新连接, 连接期间不持有锁
+            ++total_;
+            ++busy_;
+            lock.unlock();
+            MYSQL *sql = connect();
+            if (!sql) {
+                lock.lock();
+                --total_;
+                --busy_;
+                cond_.notify_one();
+                lock.unlock();
+            }
+            recordCheckout(start, sql != nullptr);
+            return sql;
+        }
+        if (cond_.wait_until(lock, deadline) == std::cv_status::timeout) {
+            break;
+        }
+    }
+    lock.unlock();
+    LOG_WARN("SQLConnPool busy!");
+    recordCheckout(start, false);
+    return nullptr;
+}
+
 void SQLConnPool::freeConn(MYSQL *sql) {
     assert(sql);
-    std::lock_guard<std::mutex> lock(mutex_);
-    conn_que_.push(sql);
-    sem_post(&sem_id_);
+    // 连接断开等客户端错误之后, 下次取出时先检查
+    unsigned int error = mysql_errno(sql);
+    bool stale = error >= CR_MIN_ERROR && error <= CR_MAX_ERROR;
+    std::vector<MYSQL *> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --busy_;
+        if (closed_) {
+            --total_;
+            expired.push_back(sql);
+        } else {
+            Clock::time_point now = Clock::now();
+            idle_.push_back({sql, stale ? Clock::time_point() : now});
+            // 队首是最久没有使用的连接, 超过min_conn的部分空闲太久就关闭
+            auto limit = std::chrono::milliseconds(options_.idle_timeout_ms);
+            while (total_ > options_.min_conn && !idle_.empty() && now - idle_.front().last_used >= limit) {
+                expired.push_back(idle_.front().sql);
+                idle_.erase(idle_.begin());
+                --total_;
+            }
+            cond_.notify_one();
+        }
+    }
+    for (MYSQL *conn: expired) {
+        disconnect(conn);
+    }
 }
 
 int SQLConnPool::getFreeConnCount() {
     std::lock_guard<std::mutex> lock(mutex_);
-    return conn_que_.size();
+    return idle_.size();
 }
 
-void SQLConnPool::closeConnPool() {
+SQLConnPool::Stats SQLConnPool::getStats() {
     std::lock_guard<std::mutex> lock(mutex_);
-    while (!conn_que_.empty()) {
-        auto item = conn_que_.front();
-        conn_que_.pop();
-        mysql_close(item);
+    Stats stats{};
+    stats.total = total_;
+    stats.busy = busy_;
+    stats.idle = static_cast<int>(idle_.size());
+    stats.checkouts = checkouts_;
+    stats.timeouts = timeouts_;
+    stats.reconnects = reconnects_;
+    stats.connect_errors = connect_errors_;
+    stats.avg_wait_us = checkouts_ ? wait_total_us_ / checkouts_ : 0;
+    stats.max_wait_us = wait_max_us_;
+    wait_max_us_ = 0;
+    return stats;
+}
+
+namespace {
+std::mutex stmt_mutex;
+
+// 注册的语句, 用函数内的静态变量避免静态初始化顺序的问题
+std::vector<std::string> &stmtQueries() {
+    static std::vector<std::string> queries;
+    return queries;
+}
+} // namespace
+
+int SQLConnPool::registerStmt(const char *query) {
+    std::lock_guard<std::mutex> lock(stmt_mutex);
+    stmtQueries().emplace_back(query);
+    return static_cast<int>(stmtQueries().size()) - 1;
+}
+
+SQLStmt *SQLConnPool::getStmt(MYSQL *sql, int id) {
+    std::vector<std::unique_ptr<SQLStmt>> *conn_stmts = nullptr;
+    {
+        // 连接建立和关闭时会修改映射, 元素的地址不会因此改变
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = stmts_.find(sql);
+        if (it == stmts_.end()) {
+            return nullptr;
+        }
+        conn_stmts = &it->second;
+    }
+    std::vector<std::unique_ptr<SQLStmt>> &stmts = *conn_stmts;
+    if (stmts.size() <= static_cast<size_t>(id)) {
+        stmts.resize(id + 1);
+    }
+    if (!stmts[id]) {
+        stmts[id] = std::make_unique<SQLStmt>();
+    }
+    if (!stmts[id]->isPrepared()) {
+        std::string query;
+        {
+            std::lock_guard<std::mutex> lock(stmt_mutex);
+            assert(id >= 0 && static_cast<size_t>(id) < stmtQueries().size());
+            query = stmtQueries()[id];
+        }
+        if (!stmts[id]->prepare(sql, query.c_str())) {
+            return nullptr;
+        }
+    }
+    return stmts[id].get();
+}
+
+void SQLConnPool::closeConnPool() {
+    std::vector<IdleConn> idle;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+        idle.swap(idle_);
+        total_ -= static_cast<int>(idle.size());
+        // 等待连接的线程立即返回nullptr
+        cond_.notify_all();
+    }
+    for (auto &conn: idle) {
+        disconnect(conn.sql);
     }
     mysql_library_end();
-}
\ No newline at end of file
+}
@@ -4,23 +4,59 @@
 #pragma once
 #ifndef SQLCONNPOOL_H
 #define SQLCONNPOOL_H
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <mysql/mysql.h>
-#include <semaphore.h>
+
+#include "sqlstmt.h"
 // SQL连接池, 用于控制SQL连接, 多个外部访问需要访问数据库时方便直接分配连接
 // 访问完毕后释放以达到复用的效果
+// - 启动时并行建立min_conn个连接, 失败的连接不放入池中, 之后取连接时按需建立, 最多max_conn个
+// - 取连接时空闲过久的连接先mysql_ping, 失败时关闭并重新连接
+// - 没有空闲连接且已达到上限时最多等待timeout_ms, 超时返回nullptr, 调用者按数据库错误处理
+// - 超过min_conn的连接空闲idle_timeout_ms后关闭
 class SQLConnPool {
 public:
+    struct Options {
+        int min_conn = 1; // 启动时建立的连接数, 空闲时至少保留的连接数
+        int max_conn = 0; // 最多的连接数, 小于min_conn时等于min_conn
+        int timeout_ms = 3000; // getConn等待空闲连接的最长时间
+        int ping_idle_ms = 10000; // 空闲超过这个时间的连接取出时先检查是否可用, 0表示每次都检查
+        int idle_timeout_ms = 60000; // 超过min_conn的连接空闲这么久后关闭
+        unsigned int connect_timeout_s = 3; // 建立连接的超时(MYSQL_OPT_CONNECT_TIMEOUT)
+    };
+
+    // 运行状态, 用于监控
+    struct Stats {
+        int total; // 已经建立的连接数(包括正在建立的)
+        int busy; // 被取出的连接数
+        int idle;
+        uint64_t checkouts; // 成功取出的次数
+        uint64_t timeouts; // 等待超时或连接失败而返回nullptr的次数
+        uint64_t reconnects; // 检查到连接不可用后重新连接的次数
+        uint64_t connect_errors;
+        uint64_t avg_wait_us; // 取连接的平均等待时间
+        uint64_t max_wait_us; // 上次getStats以来的最长等待时间
+    };
+
     // 单例模式, 全局保留一个实例
     static SQLConnPool* getInstance();
-    // 从池中取出一个SQL连接
+    // 从池中取出一个SQL连接, 最多等待timeout_ms, 失败返回nullptr
     MYSQL *getConn();
+    MYSQL *getConn(int timeout_ms);
     // 使用完毕后将该SQL连接放回池
     void freeConn(MYSQL *sql);
     // 池中可用的SQL连接
     int getFreeConnCount();
 
+    Stats getStats();
+
     /// 初始化连接池
     /// @param host  地址
     /// @param port  端口
@@ -31,19 +67,61 @@ public:
     void initConnPool(const char *host, int port,
                       const char *user, const char *pwd,
                       const char *db_name, int conn_size);
-    // 关闭连接池
+    void initConnPool(const char *host, int port,
+                      const char *user, const char *pwd,
+                      const char *db_name, const Options &options);
+    // 关闭连接池, 之后归还的连接直接关闭
     void closeConnPool();
+
+    /// 注册一条预处理语句, 返回它的编号. 应在启动阶段调用(如命名空间作用域的静态变量)
+    /// @param query 参数用?表示
+    static int registerStmt(const char *query);
+
+    /// 取连接sql上编号为id的语句, 每个连接第一次使用时才准备, 之后复用. 失败返回nullptr
+    /// 只能由持有该连接的线程调用
+    SQLStmt *getStmt(MYSQL *sql, int id);
 private:
+    using Clock = std::chrono::steady_clock;
+
+    // 空闲的连接
+    struct IdleConn {
+        MYSQL *sql;
+        Clock::time_point last_used;
+    };
+
     // 构造函数私有实现
     SQLConnPool();
     ~SQLConnPool();
 
-    // 最大连接数
-    int MAX_CONN_;
-    // 池队列
-    std::queue<MYSQL *> conn_que_;
+    // 建立一个新连接, 失败返回nullptr. 不持有锁
+    MYSQL *connect();
+    // 关闭连接并释放它的预处理语句. 不持有锁
+    void disconnect(MYSQL *sql);
+    // 取出的连接不可用时换成新连接, 失败时返回nullptr并减少连接数
+    MYSQL *revive(MYSQL *sql);
+    // 记录一次取连接的结果
+    void recordCheckout(Clock::time_point start, bool ok);
+
+    // 连接参数
+    std::string host_, user_, pwd_, db_name_;
+    int port_ = 0;
+    Options options_;
+
     std::mutex mutex_;
-    // 信号量
-    sem_t sem_id_;
+    std::condition_variable cond_;
+    // 空闲连接, 后进先出: 常用的连接保持活跃, 多余的连接在队首空闲到超时后关闭
+    std::vector<IdleConn> idle_;
+    int total_ = 0;
+    int busy_ = 0;
+    bool closed_ = true;
+    // 统计, 由mutex_保护
+    uint64_t checkouts_ = 0;
+    uint64_t timeouts_ = 0;
+    uint64_t reconnects_ = 0;
+    uint64_t connect_errors_ = 0;
+    uint64_t wait_total_us_ = 0;
+    uint64_t wait_max_us_ = 0;
+    // 每个连接的预处理语句, 下标是registerStmt返回的编号. 映射由mutex_保护, 语句只由持有连接的线程使用
+    std::unordered_map<MYSQL *, std::vector<std::unique_ptr<SQLStmt>>> stmts_;
 };
 #endif //SQLCONNPOOL_H
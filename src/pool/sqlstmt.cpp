@@ -0,0 +1,137 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "sqlstmt.h"
+
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+
+#include "logger/logger.h"
+
+SQLStmt::~SQLStmt() {
+    close();
+}
+
+bool SQLStmt::prepare(MYSQL *sql, const char *query) {
+    if (stmt_) {
+        return true;
+    }
+    assert(sql);
+    stmt_ = mysql_stmt_init(sql);
+    if (!stmt_) {
+        error_ = mysql_errno(sql);
+        LOG_ERROR("SQLStmt: init error %u", error_);
+        return false;
+    }
+    if (mysql_stmt_prepare(stmt_, query, strlen(query))) {
+        error_ = mysql_stmt_errno(stmt_);
+        LOG_ERROR("SQLStmt: prepare error %u: %s", error_, mysql_stmt_error(stmt_));
+        close();
+        return false;
+    }
+    // 参数以字符串发送, 每次执行只更新指针和长度
+    size_t param_count = mysql_stmt_param_count(stmt_);
+    params_.assign(param_count, MYSQL_BIND{});
+    param_lengths_.assign(param_count, 0);
+    for (size_t i = 0; i < param_count; ++i) {
+        params_[i].buffer_type = MYSQL_TYPE_STRING;
+        params_[i].length = &param_lengths_[i];
+    }
+    // 结果列以字符串接收, 绑定一次, 之后只在缓冲区扩大时重新绑定
+    size_t field_count = mysql_stmt_field_count(stmt_);
+    results_.assign(field_count, MYSQL_BIND{});
+    buffers_.resize(field_count);
+    lengths_.assign(field_count, 0);
+    nulls_ = std::make_unique<BindFlag[]>(field_count);
+    truncated_ = std::make_unique<BindFlag[]>(field_count);
+    for (size_t i = 0; i < field_count; ++i) {
+        buffers_[i] = std::make_unique<char[]>(COLUMN_BUFFER_SIZE);
+        results_[i].buffer_type = MYSQL_TYPE_STRING;
+        results_[i].buffer = buffers_[i].get();
+        results_[i].buffer_length = COLUMN_BUFFER_SIZE;
+        results_[i].length = &lengths_[i];
+        results_[i].is_null = &nulls_[i];
+        results_[i].error = &truncated_[i];
+    }
+    if (field_count > 0 && mysql_stmt_bind_result(stmt_, results_.data())) {
+        error_ = mysql_stmt_errno(stmt_);
+        LOG_ERROR("SQLStmt: bind result error %u: %s", error_, mysql_stmt_error(stmt_));
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool SQLStmt::execute(std::initializer_list<std::string_view> params) {
+    assert(stmt_ && params.size() == params_.size());
+    affected_rows_ = 0;
+    // 上一次的结果集可能没有读完
+    mysql_stmt_free_result(stmt_);
+    size_t i = 0;
+    for (std::string_view param: params) {
+        params_[i].buffer = const_cast<char *>(param.data());
+        params_[i].buffer_length = param.size();
+        param_lengths_[i] = param.size();
+        ++i;
+    }
+    // mysql_stmt_bind_param和mysql_stmt_execute出错时返回非0
+    bool failed = (!params_.empty() && mysql_stmt_bind_param(stmt_, params_.data())) ||
+                  mysql_stmt_execute(stmt_) ||
+                  (!results_.empty() && mysql_stmt_store_result(stmt_));
+    if (failed) {
+        error_ = mysql_stmt_errno(stmt_);
+        LOG_WARN("SQLStmt: execute error %u: %s", error_, mysql_stmt_error(stmt_));
+        // 客户端错误(连接断开等)或者服务器丢弃了语句时关闭, 下次重新准备; 重复键等语句的错误不影响复用
+        if ((error_ >= CR_MIN_ERROR && error_ <= CR_MAX_ERROR) ||
+            error_ == ER_UNKNOWN_STMT_HANDLER || error_ == ER_NEED_REPREPARE) {
+            close();
+        }
+        return false;
+    }
+    error_ = 0;
+    affected_rows_ = mysql_stmt_affected_rows(stmt_);
+    return true;
+}
+
+bool SQLStmt::fetch() {
+    if (!stmt_ || results_.empty()) {
+        return false;
+    }
+    int ret = mysql_stmt_fetch(stmt_);
+    if (ret != MYSQL_DATA_TRUNCATED) {
+        return ret == 0;
+    }
+    // 截断的列扩大到完整长度后重新读取, 之后的行和之后的执行都使用新的缓冲区
+    for (size_t i = 0; i < results_.size(); ++i) {
+        if (!truncated_[i]) {
+            continue;
+        }
+        size_t size = std::max<size_t>(lengths_[i], results_[i].buffer_length * 2);
+        buffers_[i] = std::make_unique<char[]>(size);
+        results_[i].buffer = buffers_[i].get();
+        results_[i].buffer_length = size;
+        if (mysql_stmt_fetch_column(stmt_, &results_[i], i, 0)) {
+            return false;
+        }
+    }
+    return !mysql_stmt_bind_result(stmt_, results_.data());
+}
+
+std::string_view SQLStmt::column(size_t i) const {
+    assert(i < results_.size());
+    if (nulls_[i]) {
+        return {};
+    }
+    return {buffers_[i].get(), std::min<size_t>(lengths_[i], results_[i].buffer_length)};
+}
+
+void SQLStmt::close() {
+    if (stmt_) {
+        mysql_stmt_close(stmt_);
+        stmt_ = nullptr;
+    }
+}
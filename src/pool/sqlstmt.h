@@ -0,0 +1,75 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef SQLSTMT_H
+#define SQLSTMT_H
+#pragma once
+
+#include <mysql/mysql.h>
+
+#include <stdint.h>
+#include <initializer_list>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// 预处理语句: 服务器只解析一次, 之后每次执行只发送参数(二进制协议), 参数不会被当作SQL解析
+// 参数和结果都以字符串绑定, MYSQL_BIND和结果缓冲区在多次执行之间复用, 结果列超过缓冲区时扩大后保留
+// 一个SQLStmt属于一个连接, 和连接一起被一个线程使用, 不加锁
+class SQLStmt {
+public:
+    SQLStmt() = default;
+
+    ~SQLStmt();
+
+    SQLStmt(const SQLStmt &) = delete;
+
+    SQLStmt &operator=(const SQLStmt &) = delete;
+
+    /// 在连接sql上准备语句, 失败时返回false, 之后可以再次调用
+    /// @param query 参数用?表示
+    bool prepare(MYSQL *sql, const char *query);
+
+    bool isPrepared() const { return stmt_ != nullptr; }
+
+    /// 绑定参数并执行, 参数个数必须与?的个数相同. 结果集全部读到客户端, 之后用fetch逐行读取
+    /// 连接断开, 服务器丢弃了语句等失败时关闭语句, 下次使用前需要重新prepare
+    bool execute(std::initializer_list<std::string_view> params);
+
+    // 读取下一行, 没有更多的行或出错时返回false
+    bool fetch();
+
+    // 当前行的第i列, NULL为空
+    std::string_view column(size_t i) const;
+
+    bool isNull(size_t i) const { return nulls_[i]; }
+
+    // INSERT/UPDATE/DELETE影响的行数
+    uint64_t affectedRows() const { return affected_rows_; }
+
+    unsigned int error() const { return error_; }
+
+    void close();
+
+private:
+    // MySQL 8的MYSQL_BIND使用bool, MariaDB和旧版本使用my_bool
+    using BindFlag = std::remove_pointer_t<decltype(MYSQL_BIND::is_null)>;
+
+    static const size_t COLUMN_BUFFER_SIZE = 64; // 结果列缓冲区的初始大小
+
+    MYSQL_STMT *stmt_ = nullptr;
+    unsigned int error_ = 0;
+    uint64_t affected_rows_ = 0;
+    std::vector<MYSQL_BIND> params_;
+    std::vector<unsigned long> param_lengths_;
+    std::vector<MYSQL_BIND> results_;
+    std::vector<std::unique_ptr<char[]>> buffers_;
+    std::vector<unsigned long> lengths_;
+    std::unique_ptr<BindFlag[]> nulls_; // vector<bool>不能取元素的地址
+    std::unique_ptr<BindFlag[]> truncated_;
+};
+
+
+#endif //SQLSTMT_H
@@ -0,0 +1,114 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef TASK_H
+#define TASK_H
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 线程池的任务: 只能移动的void()可调用对象
+// 和std::function相比: 不要求可复制, 捕获不超过INLINE_SIZE字节的可调用对象直接放在对象内部(不分配内存),
+// 调用只经过一次函数指针. 整个对象正好一个缓存行
+class Task {
+public:
+    static constexpr size_t INLINE_SIZE = 48;
+
+    Task() noexcept = default;
+
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+    Task(F &&func) {
+        using Func = std::decay_t<F>;
+        if constexpr (isInline<Func>()) {
+            new(storage_) Func(std::forward<F>(func));
+            ops_ = &INLINE_OPS<Func>;
+        } else {
+            // 过大的捕获只能放在堆上, 对象内部只保存指针
+            *reinterpret_cast<Func **>(storage_) = new Func(std::forward<F>(func));
+            ops_ = &HEAP_OPS<Func>;
+        }
+    }
+
+    Task(Task &&other) noexcept {
+        moveFrom(other);
+    }
+
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+
+    Task &operator=(const Task &) = delete;
+
+    ~Task() {
+        reset();
+    }
+
+    void operator()() {
+        ops_->invoke(storage_);
+    }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    // 销毁持有的可调用对象(释放它捕获的资源)
+    void reset() {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    // 可调用对象是否放在对象内部
+    template<typename F>
+    static constexpr bool isInline() {
+        return sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<F>;
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void *storage);
+        void (*move)(void *dst, void *src); // 移动到dst并销毁src中的对象
+        void (*destroy)(void *storage);
+    };
+
+    template<typename F>
+    static constexpr Ops INLINE_OPS = {
+        [](void *storage) { (*static_cast<F *>(storage))(); },
+        [](void *dst, void *src) {
+            new(dst) F(std::move(*static_cast<F *>(src)));
+            static_cast<F *>(src)->~F();
+        },
+        [](void *storage) { static_cast<F *>(storage)->~F(); },
+    };
+
+    template<typename F>
+    static constexpr Ops HEAP_OPS = {
+        [](void *storage) { (**static_cast<F **>(storage))(); },
+        [](void *dst, void *src) { *static_cast<F **>(dst) = *static_cast<F **>(src); },
+        [](void *storage) { delete *static_cast<F **>(storage); },
+    };
+
+    void moveFrom(Task &other) noexcept {
+        if (other.ops_) {
+            other.ops_->move(storage_, other.storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[INLINE_SIZE];
+    const Ops *ops_ = nullptr;
+};
+
+
+#endif //TASK_H
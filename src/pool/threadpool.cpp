@@ -0,0 +1,374 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "threadpool.h"
+
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+
+#include "logger/logger.h"
+
+namespace {
+// 当前线程所属的线程池和在其中的下标, 工作线程提交的任务放入自己的队列
+thread_local const void *current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+// 工作线程队列中的元素是Task节点, 执行后放回执行线程的缓存, 稳定后提交不再分配内存
+struct NodeCache {
+    static constexpr size_t MAX_NODES = 4096;
+
+    std::vector<Task *> nodes;
+
+    NodeCache() { nodes.reserve(MAX_NODES); }
+
+    ~NodeCache() {
+        for (Task *node: nodes) {
+            delete node;
+        }
+    }
+};
+
+thread_local NodeCache node_cache;
+
+Task *newNode(Task &&task) {
+    if (node_cache.nodes.empty()) {
+        return new Task(std::move(task));
+    }
+    Task *node = node_cache.nodes.back();
+    node_cache.nodes.pop_back();
+    *node = std::move(task);
+    return node;
+}
+
+void freeNode(Task *node) {
+    // 先销毁可调用对象, 释放它捕获的资源
+    node->reset();
+    if (node_cache.nodes.size() < NodeCache::MAX_NODES) {
+        node_cache.nodes.push_back(node);
+    } else {
+        delete node;
+    }
+}
+
+// 排队时间用粗粒度的单调时钟(精度通常1~4ms), 读取只需几纳秒, 每个任务入队出队各读一次
+// 单个任务的排队时间被量化, 但大量任务的平均值仍然准确; 目标排队时间应明显大于时钟精度
+int64_t nowUs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t nextRand(uint32_t &state) {
+    // xorshift32, 只用来打散窃取顺序
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+} // namespace
+
+Threadpool::Threadpool(size_t thread_count, QUEUE_MODE mode):
+    Threadpool(Options{thread_count, 0, 10, 30000, mode}) {
+}
+
+Threadpool::Threadpool(const Options &options) {
+    pool_ = std::make_shared<Pool>();
+    assert(options.min_threads > 0);
+    pool_->mode = options.mode;
+    pool_->name = options.name ? options.name : "ThreadPool";
+    pool_->min_threads = options.min_threads;
+    pool_->max_threads = std::max(options.min_threads, options.max_threads);
+    pool_->queue_target_us = static_cast<int64_t>(options.queue_target_ms) * 1000;
+    pool_->idle_timeout_ms = options.idle_timeout_ms;
+    // 槽位按最大线程数创建, 增减线程时不改变workers, 窃取时不需要加锁
+    for (size_t i = 0; i < pool_->max_threads; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->rand_state = static_cast<uint32_t>(i * 2654435761u + 1);
+        pool_->workers.push_back(std::move(worker));
+    }
+    {
+        std::lock_guard<std::mutex> lock(pool_->threads_mutex);
+        for (size_t i = 0; i < pool_->min_threads; ++i) {
+            spawnWorker(pool_);
+        }
+    }
+    if (pool_->max_threads > pool_->min_threads) {
+        monitor_ = std::thread(monitorLoop, pool_);
+    }
+}
+
+Threadpool::~Threadpool() {
+    {
+        std::lock_guard<std::mutex> lock(pool_->park_mutex);
+        pool_->is_close = true;
+    }
+    // 工作线程执行完剩余的任务后退出
+    pool_->condition.notify_all();
+    if (monitor_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(pool_->threads_mutex);
+            pool_->monitor_condition.notify_all();
+        }
+        monitor_.join();
+    }
+    // 监控线程退出后不会再启动新线程, 取出所有线程后在锁外等待
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(pool_->threads_mutex);
+        for (auto &worker: pool_->workers) {
+            if (worker->thread.joinable()) {
+                threads.push_back(std::move(worker->thread));
+            }
+        }
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+}
+
+Threadpool::Stats Threadpool::getStats() {
+    Pool &pool = *pool_;
+    Stats stats{};
+    stats.threads = pool.live.load(std::memory_order_relaxed);
+    stats.queued = pool.inject.size() + pool.overflow_size.load(std::memory_order_relaxed);
+    uint64_t wait_count = 0;
+    int64_t wait_total = 0;
+    for (const auto &worker: pool.workers) {
+        stats.queued += worker->deque.size();
+        stats.busy += worker->busy.load(std::memory_order_relaxed);
+        stats.completed += worker->completed.load(std::memory_order_relaxed);
+        wait_count += worker->wait_count.load(std::memory_order_relaxed);
+        wait_total += worker->wait_total_us.load(std::memory_order_relaxed);
+        stats.max_wait_us = std::max(stats.max_wait_us, worker->wait_max_us.exchange(0, std::memory_order_relaxed));
+    }
+    stats.oldest_wait_us = oldestWait(pool);
+    // 平均排队时间按和上次获取之间的增量计算
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    if (wait_count > last_wait_count_) {
+        stats.avg_wait_us = (wait_total - last_wait_total_us_) / static_cast<int64_t>(wait_count - last_wait_count_);
+    }
+    last_wait_count_ = wait_count;
+    last_wait_total_us_ = wait_total;
+    return stats;
+}
+
+bool Threadpool::spawnWorker(const std::shared_ptr<Pool> &pool) {
+    for (size_t i = 0; i < pool->workers.size(); ++i) {
+        Worker &worker = *pool->workers[i];
+        if (worker.running) {
+            continue;
+        }
+        // 上一个使用该槽位的线程已经退出(或正在返回), 先回收
+        if (worker.thread.joinable()) {
+            worker.thread.join();
+        }
+        worker.running = true;
+        pool->live.fetch_add(1, std::memory_order_relaxed);
+        worker.thread = std::thread(workerLoop, pool, i);
+        return true;
+    }
+    return false;
+}
+
+bool Threadpool::tryRetire(Pool &pool) {
+    size_t live = pool.live.load(std::memory_order_relaxed);
+    while (live > pool.min_threads) {
+        if (pool.live.compare_exchange_weak(live, live - 1, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int64_t Threadpool::oldestWait(const Pool &pool) {
+    int64_t stamp = pool.inject.headStamp();
+    if (stamp <= 0) {
+        return 0;
+    }
+    return std::max<int64_t>(0, nowUs() - stamp);
+}
+
+void Threadpool::monitorLoop(std::shared_ptr<Pool> pool) {
+    // 检查间隔取目标排队时间的一半, 新线程有时间取走任务后才会再次增加
+    auto tick = std::chrono::microseconds(std::max<int64_t>(1000, pool->queue_target_us / 2));
+    std::unique_lock<std::mutex> lock(pool->threads_mutex);
+    while (!pool->is_close) {
+        pool->monitor_condition.wait_for(lock, tick);
+        if (pool->is_close) {
+            break;
+        }
+        size_t live = pool->live.load(std::memory_order_relaxed);
+        int64_t wait = oldestWait(*pool);
+        if (wait > pool->queue_target_us && live < pool->max_threads && spawnWorker(pool)) {
+            LOG_INFO("%s grow to %zu threads, oldest task waited %lld us", pool->name, live + 1,
+                     static_cast<long long>(wait));
+        }
+    }
+}
+
+void Threadpool::submit(Task &&task) {
+    Pool &pool = *pool_;
+    bool queued = false;
+    if (pool.mode == QUEUE_WORK_STEALING && current_pool == &pool) {
+        Task *node = newNode(std::move(task));
+        queued = pool.workers[current_index]->deque.push(node);
+        if (!queued) {
+            task = std::move(*node);
+            freeNode(node);
+        }
+    }
+    // 全局队列不加锁不分配内存, 满了才放入溢出队列
+    // 全局队列的任务记录入队时间, 用于统计排队时间和弹性增加线程
+    if (!queued && !pool.inject.tryPush(std::move(task), nowUs())) {
+        std::lock_guard<std::mutex> lock(pool.overflow_mutex);
+        pool.overflow.push_back(std::move(task));
+        pool.overflow_size.fetch_add(1, std::memory_order_relaxed);
+    }
+    wakeOne(pool);
+}
+
+void Threadpool::wakeOne(Pool &pool) {
+    // 和休眠前的检查配对: 要么休眠的线程看到了新任务, 要么这里看到idle > 0
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (pool.idle.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(pool.park_mutex);
+        pool.condition.notify_one();
+    }
+}
+
+bool Threadpool::takeOverflow(Pool &pool, Task &task) {
+    if (pool.overflow_size.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(pool.overflow_mutex);
+    if (pool.overflow.empty()) {
+        return false;
+    }
+    task = std::move(pool.overflow.front());
+    pool.overflow.pop_front();
+    pool.overflow_size.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool Threadpool::stealTask(Pool &pool, size_t index, Task &task) {
+    size_t count = pool.workers.size();
+    if (count <= 1) {
+        return false;
+    }
+    // 从随机位置开始轮询其他线程, 避免所有空闲线程同时窃取同一个队列
+    size_t start = nextRand(pool.workers[index]->rand_state) % count;
+    for (size_t i = 0; i < count; ++i) {
+        size_t victim = (start + i) % count;
+        if (victim == index) {
+            continue;
+        }
+        if (Task *node = pool.workers[victim]->deque.steal()) {
+            task = std::move(*node);
+            freeNode(node);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Threadpool::findTask(Pool &pool, size_t index, Task &task) {
+    if (pool.mode == QUEUE_WORK_STEALING) {
+        if (Task *node = pool.workers[index]->deque.pop()) {
+            task = std::move(*node);
+            freeNode(node);
+            return true;
+        }
+    }
+    int64_t stamp = 0;
+    if (pool.inject.tryPop(task, &stamp)) {
+        // 只有本线程写入自己的统计, 不需要读改写
+        Worker &self = *pool.workers[index];
+        int64_t wait = std::max<int64_t>(0, nowUs() - stamp);
+        self.wait_count.store(self.wait_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        self.wait_total_us.store(self.wait_total_us.load(std::memory_order_relaxed) + wait,
+                                 std::memory_order_relaxed);
+        if (wait > self.wait_max_us.load(std::memory_order_relaxed)) {
+            self.wait_max_us.store(wait, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    if (takeOverflow(pool, task)) {
+        return true;
+    }
+    return pool.mode == QUEUE_WORK_STEALING && stealTask(pool, index, task);
+}
+
+bool Threadpool::hasWork(const Pool &pool) {
+    if (!pool.inject.empty() || pool.overflow_size.load(std::memory_order_relaxed) > 0) {
+        return true;
+    }
+    for (const auto &worker: pool.workers) {
+        if (!worker->deque.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Threadpool::workerLoop(std::shared_ptr<Pool> pool, size_t index) {
+    current_pool = pool.get();
+    current_index = index;
+    // 只有弹性模式下多余的线程会因为空闲退出
+    bool elastic = pool->max_threads > pool->min_threads;
+    Worker &self = *pool->workers[index];
+    Task task;
+    while (true) {
+        bool found = findTask(*pool, index, task);
+        // 短暂自旋: 请求通常成批到达, 自旋比休眠再被唤醒的代价小
+        for (int i = 0; !found && i < SPIN_ROUNDS; ++i) {
+            std::this_thread::yield();
+            found = findTask(*pool, index, task);
+        }
+        if (!found) {
+            std::unique_lock<std::mutex> lock(pool->park_mutex);
+            pool->idle.fetch_add(1, std::memory_order_relaxed);
+            // 先声明要休眠再检查队列, 和wakeOne配对, 不会错过休眠前提交的任务
+            // 持有park_mutex时只检查不取任务
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(pool->idle_timeout_ms);
+            bool has_work;
+            bool retire = false;
+            while (!(has_work = hasWork(*pool)) && !pool->is_close) {
+                if (!elastic) {
+                    pool->condition.wait(lock);
+                } else if (pool->condition.wait_until(lock, deadline) == std::cv_status::timeout &&
+                           !hasWork(*pool) && !pool->is_close) {
+                    // 空闲超时, 多于最小线程数时退出, 否则继续等待下一个周期
+                    retire = tryRetire(*pool);
+                    if (retire) {
+                        break;
+                    }
+                    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(pool->idle_timeout_ms);
+                }
+            }
+            pool->idle.fetch_sub(1, std::memory_order_relaxed);
+            if (retire) {
+                lock.unlock();
+                // 自己的队列已经为空(只有本线程向其中添加), 槽位留给之后启动的线程
+                std::lock_guard<std::mutex> threads_lock(pool->threads_mutex);
+                self.running = false;
+                LOG_INFO("%s shrink to %zu threads", pool->name, pool->live.load(std::memory_order_relaxed));
+                break;
+            }
+            if (!has_work) {
+                // 已关闭且没有剩余任务
+                break;
+            }
+            continue;
+        }
+        self.busy.store(true, std::memory_order_relaxed);
+        task();
+        // 执行完立即释放捕获的资源, 不留到下一个任务覆盖时
+        task.reset();
+        self.busy.store(false, std::memory_order_relaxed);
+        self.completed.store(self.completed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    current_pool = nullptr;
+}
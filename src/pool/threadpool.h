@@ -5,67 +5,153 @@
 #ifndef THREADPOOL_H
 #define THREADPOOL_H
 #include <assert.h>
+#include <stdint.h>
+#include <atomic>
 #include <condition_variable>
-#include <functional>
+#include <deque>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <vector>
 
+#include "mpmc_queue.h"
+#include "task.h"
+#include "work_steal_deque.h"
+
+// 线程池, 两种队列方式:
+// QUEUE_WORK_STEALING(默认): 每个工作线程有自己的无锁双端队列, 工作线程提交的任务放入自己的队列;
+//     其他线程(主线程)提交的任务放入全局的无锁环形队列. 取任务的顺序: 自己的队列 -> 全局队列 -> 随机窃取其他线程的队列
+// QUEUE_MPMC: 所有任务都放入全局的无锁环形队列, 所有工作线程从中取
+// 全局队列满时放入加锁的溢出队列. 没有任务时先自旋若干轮, 仍然没有才休眠, 只有存在休眠的线程时提交才需要加锁唤醒
+// 弹性模式(max_threads > min_threads): 监控线程发现全局队列中最老的任务等待超过queue_target_ms时增加线程,
+// 超过min_threads的线程空闲idle_timeout_ms后退出. 所有线程都可以join, 析构时执行完剩余任务并等待线程退出
 class Threadpool {
 public:
-    Threadpool() = default;
-    Threadpool(Threadpool &&) = default;
-    explicit Threadpool(size_t thread_count = std::thread::hardware_concurrency()) {
-        pool_ = std::make_shared<Pool>();
-        assert(thread_count > 0);
-        for (size_t i = 0; i < thread_count; ++i) {
-            std::thread([this]() {
-                std::unique_lock<std::mutex> lock(this->pool_->mutex);
-                while (true) {
-                    if (!pool_->tasks.empty()) {
-                        auto task = std::move(this->pool_->tasks.front());
-                        this->pool_->tasks.pop();
-                        lock.unlock();
-                        task();
-                        // 要访问队列取新任务, 先试图上锁
-                        lock.lock();
-                    } else if (this->pool_->is_close) {
-                        break;
-                    } else {
-                        // 如果为空, 阻塞自己等待唤醒
-                        this->pool_->condition.wait(lock);
-                    }
-                }
-            }).detach();
-        }
-    }
-    ~Threadpool() {
-        if (pool_) {
-            std::unique_lock<std::mutex> lock(pool_->mutex);
-            pool_->is_close = true;
-        }
-        pool_->condition.notify_all();
-    }
+    enum QUEUE_MODE {
+        QUEUE_WORK_STEALING = 0,
+        QUEUE_MPMC,
+    };
+
+    struct Options {
+        size_t min_threads = std::thread::hardware_concurrency(); // 启动时的线程数, 不会低于该值
+        size_t max_threads = 0; // 不大于min_threads时线程数固定
+        int queue_target_ms = 10; // 最老的排队任务等待超过该时间时增加线程
+        int idle_timeout_ms = 30000; // 多余的线程空闲超过该时间退出
+        QUEUE_MODE mode = QUEUE_WORK_STEALING;
+        const char *name = nullptr; // 日志中显示的名称, 为空时显示ThreadPool
+    };
+
+    struct Stats {
+        size_t threads; // 存活的线程数
+        size_t busy; // 正在执行任务的线程数
+        size_t queued; // 排队的任务数
+        int64_t oldest_wait_us; // 全局队列中最老的任务已经等待的时间
+        int64_t avg_wait_us; // 上次获取以来从全局队列取出的任务的平均排队时间
+        int64_t max_wait_us; // 上次获取以来的最大排队时间
+        uint64_t completed; // 执行完的任务数
+    };
+
+    explicit Threadpool(size_t thread_count = std::thread::hardware_concurrency(),
+                        QUEUE_MODE mode = QUEUE_WORK_STEALING);
+
+    explicit Threadpool(const Options &options);
+
+    Threadpool(const Threadpool &) = delete;
+
+    Threadpool &operator=(const Threadpool &) = delete;
+
+    // 不能在工作线程中析构
+    ~Threadpool();
+
     template<typename T>
     void addTask(T &&task) {
         // T &&task 如果T是左值, 传进来的就是 T &task(左值的引用)
         //          如果T是右值, 传进来的就是 T task(普通类型)
-        std::unique_lock<std::mutex> lock(pool_->mutex);
         // forward保证了右值不会因为传进来的是T task而改变其右值属性
-        // 比如外部调用一个addTask([](){})的形式, 传入之后就变成了 function<void()> task,
-        // 这是一个左值, forward的作用就是task原来是右值, 现在还是右值
-        // emplace 在处理右值的时候直接constructor, 其余和push相同
-        pool_->tasks.emplace(std::forward<T>(task));
-        // 来了一个任务, 唤醒一个线程处理
-        pool_->condition.notify_one();
+        // 小的可调用对象直接构造在Task内部, 之后只移动不复制
+        submit(Task(std::forward<T>(task)));
     }
+
+    size_t threadCount() const { return pool_->live; }
+
+    // 平均和最大排队时间在获取后重新统计
+    Stats getStats();
+
 private:
+    struct Worker {
+        WorkStealDeque<Task> deque{LOCAL_CAPACITY}; // 元素是本线程缓存的Task节点
+        uint32_t rand_state; // 选择窃取对象的随机数状态
+        std::thread thread; // 退出的线程在槽位被复用或线程池析构时join
+        bool running = false; // 由threads_mutex保护
+        // 统计只由本槽位的线程写入(不需要原子的读改写), 获取统计时汇总
+        alignas(64) std::atomic<bool> busy{false};
+        std::atomic<uint64_t> completed{0};
+        std::atomic<uint64_t> wait_count{0}; // 从全局队列取出的任务数
+        std::atomic<int64_t> wait_total_us{0};
+        std::atomic<int64_t> wait_max_us{0}; // 获取统计时清零, 和写入并发时可能丢失一次
+    };
+
     struct Pool {
-        std::mutex mutex;
+        QUEUE_MODE mode;
+        const char *name;
+        size_t min_threads;
+        size_t max_threads;
+        int64_t queue_target_us;
+        int idle_timeout_ms;
+        std::vector<std::unique_ptr<Worker>> workers; // max_threads个槽位, 创建后不再改变
+        MpmcQueue<Task> inject{INJECT_CAPACITY}; // 非工作线程提交的任务(MPMC方式下是全部任务), 附带入队时间
+        std::mutex overflow_mutex; // 保护overflow
+        std::deque<Task> overflow; // 全局队列满时的任务
+        std::atomic<size_t> overflow_size{0}; // 不加锁判断溢出队列是否为空
+        std::mutex park_mutex; // 休眠和唤醒
         std::condition_variable condition;
-        std::queue<std::function<void()>> tasks;
-        bool is_close;
+        std::atomic<int> idle{0}; // 正在休眠(或准备休眠)的线程数
+        std::atomic<bool> is_close{false};
+
+        std::mutex threads_mutex; // 保护线程的启动和回收
+        std::condition_variable monitor_condition; // 析构时唤醒监控线程
+        std::atomic<size_t> live{0}; // 存活的线程数
     };
+
+    // 放入当前工作线程的队列, 或者全局队列, 有线程休眠时唤醒一个
+    void submit(Task &&task);
+
+    static void workerLoop(std::shared_ptr<Pool> pool, size_t index);
+
+    // 弹性模式下定期检查排队时间, 需要时增加线程
+    static void monitorLoop(std::shared_ptr<Pool> pool);
+
+    // 在空闲的槽位启动一个线程, 调用时持有threads_mutex
+    static bool spawnWorker(const std::shared_ptr<Pool> &pool);
+
+    // 存活的线程多于min_threads时减少计数, 成功的线程退出
+    static bool tryRetire(Pool &pool);
+
+    // 依次从自己的队列, 全局队列, 溢出队列和其他线程的队列取任务
+    static bool findTask(Pool &pool, size_t index, Task &task);
+
+    static bool takeOverflow(Pool &pool, Task &task);
+
+    static bool stealTask(Pool &pool, size_t index, Task &task);
+
+    // 是否有任何队列不为空
+    static bool hasWork(const Pool &pool);
+
+    // 全局队列中最老的任务已经等待的微秒数, 队列为空返回0
+    static int64_t oldestWait(const Pool &pool);
+
+    // 队列中有任务且有线程休眠时唤醒一个
+    static void wakeOne(Pool &pool);
+
+    static constexpr size_t LOCAL_CAPACITY = 4096; // 每个工作线程队列的容量, 满了放入全局队列
+    static constexpr size_t INJECT_CAPACITY = 8192; // 全局队列的容量
+    static constexpr int SPIN_ROUNDS = 64; // 休眠前自旋查找的轮数
+
+    // 工作线程和它读取的状态都由shared_ptr持有
     std::shared_ptr<Pool> pool_;
+    std::thread monitor_; // 只在弹性模式下启动
+    std::mutex stats_mutex_; // 保护上次获取统计时的累计值
+    uint64_t last_wait_count_ = 0;
+    int64_t last_wait_total_us_ = 0;
 };
 #endif //THREADPOOL_H
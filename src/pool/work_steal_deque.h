@@ -0,0 +1,106 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef WORK_STEAL_DEQUE_H
+#define WORK_STEAL_DEQUE_H
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+
+// 固定容量的Chase-Lev工作窃取双端队列, 元素是指针
+// 只有所属线程在底部push/pop(后进先出, 刚提交的任务数据还在缓存中), 其他线程从顶部steal(先进先出)
+// 不加锁, 只有队列剩最后一个元素时pop和steal之间需要一次CAS
+// 内存序参考: Lê et al. Correct and Efficient Work-Stealing for Weak Memory Models (PPoPP'13)
+template<typename T>
+class WorkStealDeque {
+public:
+    explicit WorkStealDeque(size_t capacity = 1024) {
+        // 容量取2的幂, 下标用掩码取模
+        capacity_ = 1;
+        while (capacity_ < capacity) {
+            capacity_ <<= 1;
+        }
+        mask_ = capacity_ - 1;
+        buffer_ = std::make_unique<std::atomic<T *>[]>(capacity_);
+    }
+
+    WorkStealDeque(const WorkStealDeque &) = delete;
+
+    WorkStealDeque &operator=(const WorkStealDeque &) = delete;
+
+    /// 所属线程在底部加入元素
+    /// @return 队列满时返回false, 由调用者放到其他地方
+    bool push(T *item) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        if (bottom - top >= static_cast<int64_t>(capacity_)) {
+            return false;
+        }
+        buffer_[bottom & mask_].store(item, std::memory_order_relaxed);
+        // 元素写入先于bottom对窃取者可见
+        bottom_.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 所属线程从底部取出元素, 队列为空返回nullptr
+    T *pop() {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            // 队列为空, 恢复bottom
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T *item = buffer_[bottom & mask_].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // 最后一个元素, 和窃取者竞争
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // 其他线程从顶部窃取, 队列为空或竞争失败时返回nullptr
+    T *steal() {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return nullptr;
+        }
+        T *item = buffer_[top & mask_].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    // 近似的元素个数, 只用于判断是否值得窃取
+    size_t size() const {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_relaxed);
+        return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    // top_和bottom_分别被窃取者和所属线程频繁修改, 放在不同的缓存行
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    alignas(64) std::unique_ptr<std::atomic<T *>[]> buffer_;
+    size_t capacity_;
+    size_t mask_;
+};
+
+
+#endif //WORK_STEAL_DEQUE_H
@@ -0,0 +1,52 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "async_mysql_user_store.h"
+
+#include "async_sql.h"
+#include "logger/logger.h"
+
+bool AsyncMySQLUserStore::isBlocking() const {
+    return !AsyncSql::getInstance()->isOpen();
+}
+
+CoTask<UserStore::User> AsyncMySQLUserStore::findAsync(std::string name) {
+    if (!AsyncSql::getInstance()->isOpen()) {
+        co_return co_await MySQLUserStore::findAsync(std::move(name));
+    }
+    // 参数列表不能直接写在co_await的表达式中(GCC 12把其中的initializer_list当作数组初始化而报错)
+    std::vector<std::string> params = {name};
+    SqlResult select = co_await AsyncSql::getInstance()->query(SELECT_USER_SQL, std::move(params));
+    User user{ERROR, ""};
+    if (select.ok) {
+        user.status = NOT_FOUND;
+        if (!select.rows.empty() && select.rows[0].size() > 1) {
+            user.status = OK;
+            user.password = select.rows[0][1];
+        }
+    }
+    co_return user;
+}
+
+CoTask<UserStore::STATUS> AsyncMySQLUserStore::addAsync(std::string name, std::string password) {
+    if (!AsyncSql::getInstance()->isOpen()) {
+        co_return co_await MySQLUserStore::addAsync(std::move(name), std::move(password));
+    }
+    std::vector<std::string> params = {name};
+    SqlResult select = co_await AsyncSql::getInstance()->query(SELECT_USER_SQL, std::move(params));
+    if (!select.ok) {
+        co_return ERROR;
+    }
+    if (!select.rows.empty()) {
+        LOG_DEBUG("user used!");
+        co_return EXISTS;
+    }
+    params = {name, password};
+    SqlResult insert = co_await AsyncSql::getInstance()->query(INSERT_USER_SQL, std::move(params));
+    if (!insert.ok) {
+        LOG_DEBUG("Insert error!");
+        co_return insert.error == DUP_ENTRY ? EXISTS : ERROR;
+    }
+    co_return OK;
+}
@@ -0,0 +1,24 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef ASYNC_MYSQL_USER_STORE_H
+#define ASYNC_MYSQL_USER_STORE_H
+#pragma once
+
+#include "store/mysql_user_store.h"
+
+// AsyncSql可用时, 协程版本的find/add通过非阻塞API查询, 等待数据库时协程挂在Reactor上, 不占用线程;
+// AsyncSql没有打开(编译时没有非阻塞API, 或者连接失败)时和MySQLUserStore相同, 在阻塞执行器中使用连接池
+// AsyncSql依赖Reactor, 所以放在server模块中, 由WebServer选择
+class AsyncMySQLUserStore : public MySQLUserStore {
+public:
+    CoTask<User> findAsync(std::string name) override;
+
+    CoTask<STATUS> addAsync(std::string name, std::string password) override;
+
+    bool isBlocking() const override;
+};
+
+
+#endif //ASYNC_MYSQL_USER_STORE_H
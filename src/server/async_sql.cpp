@@ -0,0 +1,298 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "async_sql.h"
+
+#include <mysql/errmsg.h>
+
+#include <assert.h>
+#include <sys/epoll.h>
+#include <algorithm>
+
+#include "logger/logger.h"
+#include "pool/co_executor.h"
+#include "reactor.h"
+
+// MariaDB Connector/C的mysql.h定义了MYSQL_WAIT_READ等非阻塞API的状态
+#if defined(MYSQL_WAIT_READ)
+#define ASYNC_SQL_SUPPORTED 1
+#else
+#define ASYNC_SQL_SUPPORTED 0
+#endif
+
+AsyncSql *AsyncSql::getInstance() {
+    static AsyncSql instance;
+    return &instance;
+}
+
+AsyncSql::~AsyncSql() {
+    close();
+}
+
+bool AsyncSql::isSupported() {
+    return ASYNC_SQL_SUPPORTED;
+}
+
+void AsyncSql::release(MYSQL *conn) {
+    Waiter *waiter = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_) {
+            // 连接已经由close关闭
+            return;
+        }
+        if (waiters_.empty()) {
+            free_.push_back(conn);
+            return;
+        }
+        waiter = waiters_.front();
+        waiters_.pop_front();
+        waiter->conn = conn;
+    }
+    // 在执行器中恢复, 不在归还连接的协程中嵌套执行
+    Reactor::schedule(waiter->handle);
+}
+
+#if ASYNC_SQL_SUPPORTED
+
+namespace {
+// 把非阻塞API要等待的状态转换为Reactor的等待, 返回传给_cont的状态
+CoTask<int> waitStatus(MYSQL *conn, int status) {
+    auto deadline = Reactor::Clock::time_point::max();
+    if (status & MYSQL_WAIT_TIMEOUT) {
+        deadline = Reactor::Clock::now() + std::chrono::milliseconds(mysql_get_timeout_value_ms(conn));
+    }
+    int fd = mysql_get_socket(conn);
+    if (fd < 0 || !(status & (MYSQL_WAIT_READ | MYSQL_WAIT_WRITE))) {
+        co_await sleepFor(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Reactor::Clock::now()));
+        co_return MYSQL_WAIT_TIMEOUT;
+    }
+    // 同时等待读写时(如TLS握手)先等可写, 可写通常立即就绪, 之后库会再要求读
+    uint32_t events = (status & MYSQL_WAIT_WRITE) ? EPOLLOUT : EPOLLIN;
+    uint32_t revents = co_await waitFd(fd, events, deadline);
+    if (revents == 0) {
+        co_return MYSQL_WAIT_TIMEOUT;
+    }
+    co_return events == EPOLLIN ? MYSQL_WAIT_READ : MYSQL_WAIT_WRITE;
+}
+} // namespace
+
+bool AsyncSql::init(const char *host, int port, const char *user, const char *pwd,
+                    const char *db_name, int conn_size) {
+    assert(conn_size > 0 && conns_.empty());
+    host_ = host;
+    port_ = port;
+    user_ = user;
+    pwd_ = pwd;
+    db_name_ = db_name;
+    closed_ = false;
+    for (int i = 0; i < conn_size; ++i) {
+        // 启动阶段阻塞连接, 连接失败时调用者退回阻塞的连接池
+        MYSQL *conn = connect();
+        if (!conn) {
+            close();
+            return false;
+        }
+        conns_.push_back(conn);
+        free_.push_back(conn);
+    }
+    LOG_INFO("AsyncSql: %d non-blocking connections", conn_size);
+    return true;
+}
+
+MYSQL *AsyncSql::connect() {
+    MYSQL *conn = mysql_init(nullptr);
+    if (!conn) {
+        LOG_ERROR("AsyncSql: mysql init error!");
+        return nullptr;
+    }
+    // 必须在连接之前设置, 之后阻塞和非阻塞的调用都可以使用
+    mysql_options(conn, MYSQL_OPT_NONBLOCK, 0);
+    if (!mysql_real_connect(conn, host_.c_str(), user_.c_str(), pwd_.c_str(), db_name_.c_str(), port_,
+                            nullptr, 0)) {
+        LOG_ERROR("AsyncSql: connect error: %s", mysql_error(conn));
+        mysql_close(conn);
+        return nullptr;
+    }
+    return conn;
+}
+
+CoTask<MYSQL *> AsyncSql::reconnect(MYSQL *conn) {
+    LOG_WARN("AsyncSql: connection lost: %s, reconnect", mysql_error(conn));
+    // 建立连接是阻塞的, 不占用快速执行器
+    co_await resumeOn(Executors::EXECUTOR_BLOCKING);
+    MYSQL *fresh = connect();
+    co_await resumeOn(Executors::EXECUTOR_FAST);
+    if (!fresh) {
+        co_return conn;
+    }
+    bool closed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed = closed_;
+        if (!closed) {
+            *std::find(conns_.begin(), conns_.end(), conn) = fresh;
+        }
+    }
+    if (closed) {
+        // 原连接已经由close关闭
+        mysql_close(fresh);
+        co_return nullptr;
+    }
+    int fd = mysql_get_socket(conn);
+    if (fd >= 0) {
+        Reactor::getInstance()->removeFd(fd);
+    }
+    mysql_close(conn);
+    co_return fresh;
+}
+
+CoTask<SqlResult> AsyncSql::query(std::string sql, std::vector<std::string> params) {
+    SqlResult result;
+    if (conns_.empty()) {
+        result.message = "AsyncSql is not open";
+        co_return result;
+    }
+    MYSQL *conn = co_await acquire();
+    if (!conn) {
+        result.message = "AsyncSql is closed";
+        co_return result;
+    }
+    in_flight_.fetch_add(1, std::memory_order_relaxed);
+    std::string statement = bind(conn, sql, params);
+    LOG_DEBUG("AsyncSql: %s", statement.c_str());
+    // 等待期间close了连接池时不能再访问连接
+    bool closed = false;
+    int ret = 0;
+    int status = mysql_real_query_start(&ret, conn, statement.data(), statement.size());
+    while (status && !closed) {
+        int ready = co_await waitStatus(conn, status);
+        closed = closed_;
+        if (!closed) {
+            status = mysql_real_query_cont(&ret, conn, ready);
+        }
+    }
+    if (ret == 0 && !closed) {
+        MYSQL_RES *res = nullptr;
+        status = mysql_store_result_start(&res, conn);
+        while (status && !closed) {
+            int ready = co_await waitStatus(conn, status);
+            closed = closed_;
+            if (!closed) {
+                status = mysql_store_result_cont(&res, conn, ready);
+            }
+        }
+        if (res) {
+            // 结果已经全部读入内存, 取行不再有I/O
+            unsigned int fields = mysql_num_fields(res);
+            result.rows.reserve(mysql_num_rows(res));
+            while (MYSQL_ROW row = mysql_fetch_row(res)) {
+                unsigned long *lengths = mysql_fetch_lengths(res);
+                std::vector<std::string> &values = result.rows.emplace_back();
+                values.reserve(fields);
+                for (unsigned int i = 0; i < fields; ++i) {
+                    values.emplace_back(row[i] ? std::string(row[i], lengths[i]) : std::string());
+                }
+            }
+            mysql_free_result(res);
+            result.ok = true;
+        } else if (mysql_field_count(conn) == 0) {
+            // 没有结果集的语句
+            result.affected_rows = mysql_affected_rows(conn);
+            result.ok = true;
+        }
+    }
+    in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    if (closed) {
+        result.ok = false;
+        result.message = "AsyncSql is closed";
+        co_return result;
+    }
+    if (!result.ok) {
+        result.error = mysql_errno(conn);
+        result.message = mysql_error(conn);
+        LOG_WARN("AsyncSql: query error %u: %s", result.error, result.message.c_str());
+    }
+    // 连接断开等客户端错误(如数据库重启)之后先重新连接, 否则之后取到该连接的查询都会失败
+    if (result.error >= CR_MIN_ERROR && result.error <= CR_MAX_ERROR) {
+        conn = co_await reconnect(conn);
+        if (!conn) {
+            co_return result;
+        }
+    }
+    release(conn);
+    co_return result;
+}
+
+std::string AsyncSql::bind(MYSQL *conn, const std::string &sql, const std::vector<std::string> &params) {
+    std::string statement;
+    statement.reserve(sql.size() + params.size() * 16);
+    size_t next = 0;
+    for (char ch: sql) {
+        if (ch != '?' || next >= params.size()) {
+            statement.push_back(ch);
+            continue;
+        }
+        const std::string &param = params[next++];
+        // 转义后最长为2倍长度加结尾的0
+        size_t start = statement.size();
+        statement.resize(start + 1 + param.size() * 2 + 1);
+        statement[start] = '\'';
+        unsigned long len = mysql_real_escape_string(conn, &statement[start + 1], param.data(), param.size());
+        statement.resize(start + 1 + len);
+        statement.push_back('\'');
+    }
+    return statement;
+}
+
+void AsyncSql::close() {
+    std::vector<MYSQL *> conns;
+    std::deque<Waiter *> waiters;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        if (free_.size() != conns_.size()) {
+            LOG_WARN("AsyncSql: close with %zu queries in flight", conns_.size() - free_.size());
+        }
+        conns.swap(conns_);
+        waiters.swap(waiters_);
+        free_.clear();
+    }
+    // 在锁外恢复: 执行器已经停止时查询在这里直接恢复, 看到closed_后返回错误, 不再访问连接和锁
+    for (Waiter *waiter: waiters) {
+        waiter->conn = nullptr;
+        Reactor::schedule(waiter->handle);
+    }
+    for (MYSQL *conn: conns) {
+        int fd = mysql_get_socket(conn);
+        if (fd >= 0) {
+            Reactor::getInstance()->removeFd(fd);
+        }
+    }
+    for (MYSQL *conn: conns) {
+        mysql_close(conn);
+    }
+}
+
+#else
+
+bool AsyncSql::init(const char *, int, const char *, const char *, const char *, int) {
+    LOG_WARN("AsyncSql: mysql.h has no non-blocking API, use blocking SQLConnPool");
+    return false;
+}
+
+CoTask<SqlResult> AsyncSql::query(std::string, std::vector<std::string>) {
+    SqlResult result;
+    result.message = "non-blocking API is not available";
+    co_return result;
+}
+
+std::string AsyncSql::bind(MYSQL *, const std::string &sql, const std::vector<std::string> &) {
+    return sql;
+}
+
+void AsyncSql::close() {
+}
+
+#endif
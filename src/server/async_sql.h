@@ -0,0 +1,125 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef ASYNC_SQL_H
+#define ASYNC_SQL_H
+#pragma once
+
+#include <mysql/mysql.h>
+
+#include <stdint.h>
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "pool/co_task.h"
+
+// 查询的结果
+struct SqlResult {
+    bool ok = false;
+    unsigned int error = 0; // mysql_errno
+    std::string message; // mysql_error
+    uint64_t affected_rows = 0; // INSERT/UPDATE影响的行数
+    std::vector<std::vector<std::string>> rows; // SELECT的结果, NULL为空字符串
+};
+
+// 非阻塞的数据库连接池, 使用MariaDB Connector/C的非阻塞API(mysql_real_query_start/_cont)
+// 查询需要等待套接字时协程在Reactor中挂起, 就绪后在快速执行器中继续, 等待数据库期间不占用任何线程
+// 连接都在使用时, 查询在队列中等待连接归还. 同时进行的查询数等于连接数, 而不是阻塞的线程数
+// 查询因连接断开等客户端错误(CR_*)失败后, 在阻塞执行器中重新连接再归还, 数据库重启后连接池可以恢复
+// 编译时mysql.h没有非阻塞API(如Oracle的libmysqlclient)时isSupported返回false, init失败, 调用者使用阻塞的SQLConnPool
+class AsyncSql {
+public:
+    // 单例模式, 全局保留一个实例
+    static AsyncSql *getInstance();
+
+    // 编译时是否有非阻塞API
+    static bool isSupported();
+
+    /// 建立conn_size个连接(启动阶段, 阻塞), 任何一个连接失败都返回false
+    /// @param host 地址, localhost使用unix套接字
+    bool init(const char *host, int port, const char *user, const char *pwd,
+              const char *db_name, int conn_size);
+
+    bool isOpen() const { return !conns_.empty(); }
+
+    /// 执行一条SQL, sql中的每个?依次替换为转义后加引号的params
+    /// 在快速执行器中返回(执行器未初始化时在Reactor::poll的线程中返回)
+    CoTask<SqlResult> query(std::string sql, std::vector<std::string> params = {});
+
+    // 关闭所有连接, 应在停止执行器之后调用
+    // 进行中和等待连接的查询以错误结束, 执行器已经停止时在close中(锁外)恢复
+    void close();
+
+    // 正在执行查询的连接数
+    size_t inFlight() const { return in_flight_; }
+
+private:
+    AsyncSql() = default;
+
+    ~AsyncSql();
+
+    // 等待空闲连接的协程
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        MYSQL *conn = nullptr;
+    };
+
+    // co_await acquire(): 取一个空闲连接, 没有时挂起到有连接归还
+    auto acquire() {
+        struct Awaiter {
+            AsyncSql *sql;
+            Waiter waiter;
+
+            bool await_ready() noexcept { return false; }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                std::lock_guard<std::mutex> lock(sql->mutex_);
+                if (!sql->free_.empty()) {
+                    waiter.conn = sql->free_.back();
+                    sql->free_.pop_back();
+                    return false;
+                }
+                waiter.handle = handle;
+                sql->waiters_.push_back(&waiter);
+                return true;
+            }
+
+            MYSQL *await_resume() noexcept { return waiter.conn; }
+        };
+        return Awaiter{this, {}};
+    }
+
+    // 归还连接, 有等待者时直接交给最早的一个
+    void release(MYSQL *conn);
+
+    // 用init的参数阻塞地建立一个连接, 失败返回nullptr
+    MYSQL *connect();
+
+    /// 替换断开的连接
+    /// @return 新连接; 重连失败时返回原连接, 下次出错时再重连; 期间已经close时返回nullptr
+    CoTask<MYSQL *> reconnect(MYSQL *conn);
+
+    // 把sql中的?替换为转义的参数
+    static std::string bind(MYSQL *conn, const std::string &sql, const std::vector<std::string> &params);
+
+    std::string host_;
+    int port_ = 0;
+    std::string user_;
+    std::string pwd_;
+    std::string db_name_;
+
+    std::vector<MYSQL *> conns_; // 所有连接, 只有重连时替换其中一个
+    std::mutex mutex_; // 保护conns_, free_和waiters_
+    std::vector<MYSQL *> free_;
+    std::deque<Waiter *> waiters_;
+    std::atomic<size_t> in_flight_{0};
+    std::atomic<bool> closed_{false}; // close之后恢复的查询不能再访问连接
+};
+
+
+#endif //ASYNC_SQL_H
@@ -33,6 +33,9 @@ public:
     // 获取下标为i的套接字对应的events
     uint32_t getEvents(size_t i) const;
 
+    // epoll实例本身的fd, 可以注册到另一个epoll中
+    int getFd() const { return epfd_; }
+
 private:
     int epfd_;
     std::vector<epoll_event> events_;
@@ -0,0 +1,239 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "reactor.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "logger/logger.h"
+#include "pool/executor.h"
+
+Reactor *Reactor::getInstance() {
+    static Reactor instance;
+    return &instance;
+}
+
+Reactor::~Reactor() {
+    if (timer_fd_ >= 0) {
+        close(timer_fd_);
+    }
+}
+
+bool Reactor::init() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (timer_fd_ >= 0) {
+        return true;
+    }
+    // steady_clock就是CLOCK_MONOTONIC, 到期时间可以直接作为绝对时间设置
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd_ < 0 || !epoller_.addFd(timer_fd_, EPOLLIN)) {
+        LOG_ERROR("Reactor: timerfd init error, errno: %d", errno);
+        return false;
+    }
+    return true;
+}
+
+void Reactor::waitFd(int fd, uint32_t events, std::coroutine_handle<> handle, uint32_t *revents,
+                     Clock::time_point deadline) {
+    assert(fd >= 0 && (events == EPOLLIN || events == EPOLLOUT));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        FdWaiter &waiter = fd_waiters_[fd];
+        uint64_t seq = timer_seq_++;
+        if (events == EPOLLIN) {
+            assert(!waiter.reader);
+            waiter.reader = handle;
+            waiter.reader_events = revents;
+            waiter.reader_seq = seq;
+        } else {
+            assert(!waiter.writer);
+            waiter.writer = handle;
+            waiter.writer_events = revents;
+            waiter.writer_seq = seq;
+        }
+        if (rearmFd(fd, waiter)) {
+            if (deadline != Clock::time_point::max()) {
+                timers_.push({deadline, seq, handle, fd, events});
+                if (timers_.top().seq == seq) {
+                    armTimer();
+                }
+            }
+            return;
+        }
+        // 不能加入epoll的fd(如普通文件), 以出错恢复
+        if (events == EPOLLIN) {
+            waiter.reader = nullptr;
+        } else {
+            waiter.writer = nullptr;
+        }
+    }
+    LOG_WARN("Reactor: fd[%d] can not be polled, errno: %d", fd, errno);
+    *revents = EPOLLERR;
+    schedule(handle);
+}
+
+void Reactor::removeFd(int fd) {
+    std::vector<std::coroutine_handle<>> canceled;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = fd_waiters_.find(fd);
+        if (it == fd_waiters_.end()) {
+            return;
+        }
+        FdWaiter &waiter = it->second;
+        if (waiter.reader) {
+            *waiter.reader_events = EPOLLHUP;
+            canceled.push_back(waiter.reader);
+        }
+        if (waiter.writer) {
+            *waiter.writer_events = EPOLLHUP;
+            canceled.push_back(waiter.writer);
+        }
+        if (waiter.registered) {
+            epoller_.delFd(fd);
+        }
+        fd_waiters_.erase(it);
+    }
+    for (auto handle: canceled) {
+        schedule(handle);
+    }
+}
+
+bool Reactor::rearmFd(int fd, FdWaiter &waiter) {
+    uint32_t events = (waiter.reader ? uint32_t(EPOLLIN | EPOLLRDHUP) : 0u) | (waiter.writer ? uint32_t(EPOLLOUT) : 0u);
+    if (events == 0) {
+        // EPOLLONESHOT触发后已经不再监听, 保留注册, 下次等待用modFd
+        return true;
+    }
+    events |= EPOLLONESHOT;
+    if (waiter.registered && epoller_.modFd(fd, events)) {
+        return true;
+    }
+    // 第一次等待, 或者fd被关闭后复用(关闭时内核已经把它从epoll中删除)
+    waiter.registered = epoller_.addFd(fd, events);
+    return waiter.registered;
+}
+
+void Reactor::addTimer(Clock::time_point deadline, std::coroutine_handle<> handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t seq = timer_seq_++;
+    timers_.push({deadline, seq, handle, -1, 0});
+    if (timers_.top().seq == seq) {
+        armTimer();
+    }
+}
+
+void Reactor::expireTimer(const Timer &timer) {
+    if (timer.fd < 0) {
+        ready_.push_back(timer.handle);
+        return;
+    }
+    auto it = fd_waiters_.find(timer.fd);
+    if (it == fd_waiters_.end()) {
+        return;
+    }
+    FdWaiter &waiter = it->second;
+    if (timer.events == EPOLLIN && waiter.reader && waiter.reader_seq == timer.seq) {
+        *waiter.reader_events = 0;
+        ready_.push_back(waiter.reader);
+        waiter.reader = nullptr;
+    } else if (timer.events == EPOLLOUT && waiter.writer && waiter.writer_seq == timer.seq) {
+        *waiter.writer_events = 0;
+        ready_.push_back(waiter.writer);
+        waiter.writer = nullptr;
+    } else {
+        return;
+    }
+    // 只剩另一个方向时按它重新注册; 都没有时fd仍可能触发一次, 那时没有等待者, 直接忽略
+    rearmFd(timer.fd, waiter);
+}
+
+void Reactor::armTimer() {
+    itimerspec spec = {};
+    if (!timers_.empty()) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            timers_.top().deadline.time_since_epoch()).count();
+        // 全0表示取消, 最早也设为1ns
+        ns = ns > 0 ? ns : 1;
+        spec.it_value.tv_sec = ns / 1000000000;
+        spec.it_value.tv_nsec = ns % 1000000000;
+    }
+    timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+int Reactor::poll(int timeout_ms) {
+    assert(timer_fd_ >= 0);
+    int event_cnt = epoller_.wait(timeout_ms);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int i = 0; i < event_cnt; ++i) {
+            int fd = epoller_.getEventFd(i);
+            uint32_t events = epoller_.getEvents(i);
+            if (fd == timer_fd_) {
+                uint64_t expirations;
+                ssize_t len = read(timer_fd_, &expirations, sizeof(expirations));
+                (void) len;
+                continue;
+            }
+            auto it = fd_waiters_.find(fd);
+            if (it == fd_waiters_.end()) {
+                continue;
+            }
+            FdWaiter &waiter = it->second;
+            // 出错和挂起时两个方向的等待者都恢复, 由它们读写时得到具体的错误
+            bool error = events & (EPOLLERR | EPOLLHUP);
+            if (waiter.reader && (error || (events & (EPOLLIN | EPOLLRDHUP)))) {
+                *waiter.reader_events = events;
+                ready_.push_back(waiter.reader);
+                waiter.reader = nullptr;
+            }
+            if (waiter.writer && (error || (events & EPOLLOUT))) {
+                *waiter.writer_events = events;
+                ready_.push_back(waiter.writer);
+                waiter.writer = nullptr;
+            }
+            // 另一个方向还在等待时重新注册
+            rearmFd(fd, waiter);
+        }
+        // 每次都检查定时器, 不依赖timerfd的事件
+        Clock::time_point now = Clock::now();
+        bool expired = false;
+        while (!timers_.empty() && timers_.top().deadline <= now) {
+            expireTimer(timers_.top());
+            timers_.pop();
+            expired = true;
+        }
+        if (expired) {
+            armTimer();
+        }
+    }
+    // 在锁外恢复: 恢复的协程可能立即再次等待. ready_只在poll中使用
+    for (auto handle: ready_) {
+        schedule(handle);
+    }
+    int count = static_cast<int>(ready_.size());
+    ready_.clear();
+    return count;
+}
+
+void Reactor::run() {
+    while (!stop_.load(std::memory_order_relaxed)) {
+        poll(100);
+    }
+}
+
+void Reactor::stop() {
+    stop_ = true;
+}
+
+void Reactor::schedule(std::coroutine_handle<> handle) {
+    if (Executors::getInstance()->isInit(Executors::EXECUTOR_FAST)) {
+        Executors::getInstance()->addTask(Executors::EXECUTOR_FAST, [handle] { handle.resume(); });
+    } else {
+        handle.resume();
+    }
+}
@@ -0,0 +1,151 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef REACTOR_H
+#define REACTOR_H
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "epoller.h"
+
+// 协程的事件源: 等待套接字可读/可写和定时器的协程在这里挂起, 就绪后交给快速执行器恢复
+// 有自己的Epoller, 其epoll fd(getFd)注册到WebServer的主循环中, 可读时主循环调用poll(0), 不需要额外的线程
+// 也可以单独用run()驱动(测试). 定时器用timerfd, 同样通过epoll通知
+// 等待可以在任意线程发起; poll同一时刻只能在一个线程中调用
+class Reactor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 单例模式, 全局保留一个实例
+    static Reactor *getInstance();
+
+    // 创建timerfd并注册, 可以重复调用
+    bool init();
+
+    // 供外层的epoll监听的fd, 有事件就绪时可读
+    int getFd() const { return epoller_.getFd(); }
+
+    // 处理就绪的套接字和到期的定时器, 最多阻塞timeout_ms(-1表示一直等待), 返回恢复的协程数
+    int poll(int timeout_ms = 0);
+
+    // 在当前线程循环poll直到stop
+    void run();
+
+    void stop();
+
+    /// 协程等待fd上的事件, 就绪后恢复. fd只在等待期间注册(EPOLLONESHOT), 同一fd可以同时有一个读者和一个写者
+    /// @param events EPOLLIN或EPOLLOUT
+    /// @param revents 恢复前写入就绪的事件, 出错时包含EPOLLERR/EPOLLHUP, 超时为0
+    /// @param deadline 超过这个时间仍未就绪时以超时恢复
+    void waitFd(int fd, uint32_t events, std::coroutine_handle<> handle, uint32_t *revents,
+                Clock::time_point deadline = Clock::time_point::max());
+
+    // 关闭fd之前调用: 取消注册, 正在等待的协程以EPOLLHUP恢复
+    void removeFd(int fd);
+
+    // 协程在deadline之后恢复
+    void addTimer(Clock::time_point deadline, std::coroutine_handle<> handle);
+
+    // 快速执行器已初始化时交给它恢复, 否则在当前线程直接恢复
+    static void schedule(std::coroutine_handle<> handle);
+
+private:
+    Reactor() = default;
+
+    ~Reactor();
+
+    struct FdWaiter {
+        std::coroutine_handle<> reader;
+        uint32_t *reader_events = nullptr;
+        uint64_t reader_seq = 0; // 对应的超时定时器, 定时器到期时序号不同说明这次等待已经结束
+        std::coroutine_handle<> writer;
+        uint32_t *writer_events = nullptr;
+        uint64_t writer_seq = 0;
+        bool registered = false; // 已经加入epoll(之后用modFd)
+    };
+
+    struct Timer {
+        Clock::time_point deadline;
+        uint64_t seq; // 同一时刻到期的按加入顺序恢复
+        std::coroutine_handle<> handle;
+        int fd; // 等待fd的超时为fd, 否则为-1. fd先就绪时定时器不删除, 到期时忽略
+        uint32_t events;
+
+        bool operator>(const Timer &other) const {
+            return deadline != other.deadline ? deadline > other.deadline : seq > other.seq;
+        }
+    };
+
+    // 按剩余的等待者重新注册fd, 调用时持有mutex_. fd不能加入epoll时返回false
+    bool rearmFd(int fd, FdWaiter &waiter);
+
+    // 把timerfd设为最早的到期时间, 调用时持有mutex_
+    void armTimer();
+
+    // 到期的定时器: 恢复睡眠的协程, 或者以超时结束仍在进行的fd等待, 调用时持有mutex_
+    void expireTimer(const Timer &timer);
+
+    Epoller epoller_{256};
+    int timer_fd_ = -1;
+    std::atomic<bool> stop_{false};
+    std::mutex mutex_; // 保护fd_waiters_和timers_
+    std::unordered_map<int, FdWaiter> fd_waiters_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers_;
+    uint64_t timer_seq_ = 0;
+    std::vector<std::coroutine_handle<>> ready_; // poll中收集要恢复的协程, 在锁外恢复, 只在poll中使用
+};
+
+// co_await readable(fd) / writable(fd): 返回就绪的事件, 超过deadline返回0
+inline auto waitFd(int fd, uint32_t events, Reactor::Clock::time_point deadline = Reactor::Clock::time_point::max()) {
+    struct Awaiter {
+        int fd;
+        uint32_t events;
+        Reactor::Clock::time_point deadline;
+        uint32_t revents = 0;
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            Reactor::getInstance()->waitFd(fd, events, handle, &revents, deadline);
+        }
+
+        uint32_t await_resume() const noexcept { return revents; }
+    };
+    return Awaiter{fd, events, deadline};
+}
+
+inline auto readable(int fd) {
+    return waitFd(fd, EPOLLIN);
+}
+
+inline auto writable(int fd) {
+    return waitFd(fd, EPOLLOUT);
+}
+
+// co_await sleepFor(ms): 挂起期间不占用线程
+inline auto sleepFor(std::chrono::milliseconds duration) {
+    struct Awaiter {
+        Reactor::Clock::time_point deadline;
+
+        bool await_ready() const noexcept { return deadline <= Reactor::Clock::now(); }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            Reactor::getInstance()->addTimer(deadline, handle);
+        }
+
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{Reactor::Clock::now() + duration};
+}
+
+
+#endif //REACTOR_H
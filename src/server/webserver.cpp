@@ -7,27 +7,75 @@
 WebServer::WebServer(int port, int trigger_mode, int timeout_ms, bool opt_linger,
     int sql_port, const char *sql_user, const char *sql_pwd,
     const char *db_name, int sql_conn_num, int threadpool_num,
-    bool open_log, int log_level, int log_que_size):
+    bool open_log, int log_level, int log_que_size, size_t file_cache_size, bool compress,
+    const char *cache_control, const char *asset_bundle, int threadpool_max, int sql_conn_max,
+    const char *user_store):
     port_(port), open_linger_(opt_linger), timeout_ms_(timeout_ms),
     is_closed_(false), timer_(std::make_unique<HeapTimer>()),
-    threadpool_(std::make_unique<Threadpool>(threadpool_num)),
     epoller_(std::make_unique<Epoller>()) {
-    src_dir_ = getcwd(nullptr, 256); // 可执行文件工作路径, 限定最长256字符
-    strncat(src_dir_, "/resources/", 16);
+    // 快速执行器处理读写和解析, threadpool_max大于threadpool_num时线程数在两者之间随排队时间伸缩
+    // 阻塞执行器只执行数据库验证, 线程数随数据库连接数在sql_conn_num和sql_conn_max之间伸缩, 再多的线程也只能等待连接
+    Executors::getInstance()->init(Executors::EXECUTOR_FAST, Threadpool::Options{
+        static_cast<size_t>(threadpool_num), static_cast<size_t>(std::max(threadpool_max, 0))});
+    Executors::getInstance()->init(Executors::EXECUTOR_BLOCKING, Threadpool::Options{
+        static_cast<size_t>(std::max(sql_conn_num, 1)), static_cast<size_t>(std::max(sql_conn_max, 0))});
+    // 可执行文件工作路径, 按实际长度分配
+    char *cwd = getcwd(nullptr, 0);
+    src_dir_ = std::string(cwd ? cwd : ".") + "/resources/";
+    free(cwd);
     // 初始化http连接数
     HttpConnection::user_count = 0;
-    HttpConnection::SRC_DIR = src_dir_;
+    HttpConnection::SRC_DIR = src_dir_.c_str();
+    // 初始化文件描述符缓存和静态文件缓存, 资源目录改变时由inotify使缓存失效
+    FdCache::getInstance()->init(FD_CACHE_SIZE);
+    notify_fd_ = -1;
+    // 使用资源包时所有静态文件都在映射中, 不需要监听资源目录
+    if (asset_bundle == nullptr || *asset_bundle == '\0' || !AssetBundle::getInstance()->open(asset_bundle)) {
+        notify_fd_ = FdCache::getInstance()->watch(src_dir_);
+    }
+    // compress: 文本文件在缓存中额外保存一份gzip压缩的内容
+    FileCache::getInstance()->init(file_cache_size, 1024 * 1024, notify_fd_ >= 0 ? -1 : 1000, compress);
+    HttpResponse::initErrorResponse(src_dir_);
+    // 空指针和空字符串一样, 不发送Cache-Control
+    HttpResponse::setCacheControl(cache_control ? cache_control : "");
+    // 登录先查用户缓存和会话, 大部分登录不需要访问数据库
+    UserCache::getInstance()->init(UserCache::Options());
+    SessionCache::getInstance()->init(SESSION_NUM);
 
-    // 初始化数据库连接池
-    SQLConnPool::getInstance()->initConnPool("localhost", sql_port,
-        sql_user, sql_pwd, db_name, sql_conn_num);
+    // 用户存储: user_store为空时使用MySQL, 否则是嵌入式存储的日志文件路径, 不需要数据库
+    bool store_ok = true;
+    if (user_store != nullptr && *user_store != '\0') {
+        auto store = std::make_unique<LocalUserStore>(user_store);
+        store_ok = store->open();
+        UserStore::setInstance(std::move(store));
+    } else {
+        UserStore::setInstance(std::make_unique<AsyncMySQLUserStore>());
+        // 初始化数据库连接池: 并行建立sql_conn_num个连接, 繁忙时按需增加到sql_conn_max个
+        SQLConnPool::Options sql_options;
+        sql_options.min_conn = std::max(sql_conn_num, 1);
+        sql_options.max_conn = sql_conn_max;
+        SQLConnPool::getInstance()->initConnPool("localhost", sql_port,
+            sql_user, sql_pwd, db_name, sql_options);
+        // 有非阻塞API时登录/注册使用AsyncSql, 连接失败时仍使用阻塞执行器和连接池
+        if (AsyncSql::isSupported()) {
+            AsyncSql::getInstance()->init("localhost", sql_port, sql_user, sql_pwd, db_name, std::max(sql_conn_num, 1));
+        }
+    }
     // 初始化事件模式
     initEventMode(trigger_mode);
 
     // 初始化socket, 开启监听
-    if (!initSocket()) {
+    if (!initSocket() || !store_ok) {
         is_closed_ = true;
     }
+    if (notify_fd_ >= 0) {
+        epoller_->addFd(notify_fd_, EPOLLIN);
+    }
+    // 协程的事件源挂在主循环上, 不需要额外的线程
+    reactor_fd_ = Reactor::getInstance()->init() ? Reactor::getInstance()->getFd() : -1;
+    if (reactor_fd_ >= 0) {
+        epoller_->addFd(reactor_fd_, EPOLLIN);
+    }
 
     if (open_log) {
         // 初始化日志信息
@@ -42,8 +90,13 @@ WebServer::WebServer(int port, int trigger_mode, int timeout_ms, bool opt_linger
                 (listen_event_ & EPOLLET ? "ET" : "LT"),
                 (conn_event_ & EPOLLET ? "ET" : "LT"));
             LOG_INFO("LogSys level: %d", log_level);
-            LOG_INFO("SRC_DIR: %s", HttpConnection::SRC_DIR);
-            LOG_INFO("SQLConnPool num: %d, ThreadPool num: %d", sql_conn_num, threadpool_num);
+            LOG_INFO("SRC_DIR: %s, asset bundle: %s", HttpConnection::SRC_DIR,
+                AssetBundle::getInstance()->isOpen() ? asset_bundle : "off");
+            LOG_INFO("UserStore: %s %s", UserStore::getInstance()->name(), user_store ? user_store : "");
+            LOG_INFO("SQLConnPool num: %d, max: %d, ThreadPool fast: %d, max: %d", sql_conn_num,
+                std::max(sql_conn_num, sql_conn_max), threadpool_num, std::max(threadpool_num, threadpool_max));
+            LOG_INFO("FileCache size: %zu, inotify: %s, compress: %s", file_cache_size,
+                notify_fd_ >= 0 ? "on" : "off", compress ? "on" : "off");
         }
     }
 }
@@ -51,9 +104,10 @@ WebServer::WebServer(int port, int trigger_mode, int timeout_ms, bool opt_linger
 WebServer::~WebServer() {
     close(server_fd_);
     is_closed_ = true;
-    free(src_dir_);
+    // 先等待工作线程执行完剩余的任务并退出, 之后再释放它们访问的连接和数据库连接池
+    Executors::getInstance()->shutdown();
+    AsyncSql::getInstance()->close();
     SQLConnPool::getInstance()->closeConnPool();
-    // threadPool的关闭由threadPool本身的析构执行
 }
 
 void WebServer::start() {
@@ -74,6 +128,12 @@ void WebServer::start() {
             // 服务器, 接收新连接
             if (fd == server_fd_) {
                 handleListen();
+            } else if (fd == notify_fd_) {
+                // 资源目录中的文件改变
+                FdCache::getInstance()->onNotify();
+            } else if (fd == reactor_fd_) {
+                // 协程等待的事件就绪, 交给快速执行器恢复
+                Reactor::getInstance()->poll(0);
             } else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
                 // 客户端: 对方半关闭/挂起/错误
                 assert(clients_.count(fd) > 0);
@@ -95,7 +155,20 @@ void WebServer::addClient(int clnt_fd, sockaddr_in addr) {
     assert(clnt_fd > 0);
     clients_[clnt_fd].init(clnt_fd, addr);
     if (timeout_ms_ > 0) {
-        timer_->add(clnt_fd, timeout_ms_, std::bind(&WebServer::closeConnection, this, &clients_[clnt_fd]));
+        // 连接可能已经在工作线程中关闭, 超时时按fd查找, 不保存指针
+        timer_->add(clnt_fd, timeout_ms_, [this, clnt_fd] {
+            HttpConnection *client = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = clients_.find(clnt_fd);
+                if (it != clients_.end()) {
+                    client = &it->second;
+                }
+            }
+            if (client != nullptr) {
+                closeConnection(client);
+            }
+        });
     }
     // 监听client的可读和其他事件
     epoller_->addFd(clnt_fd, EPOLLIN | conn_event_);
@@ -190,7 +263,11 @@ bool WebServer::initSocket() {
 
 void WebServer::sendError(int clnt_fd, const char *info) {
     assert(clnt_fd > 0);
-    int ret = send(clnt_fd, info, strlen(info), 0);
+    // 使用预先生成的503响应, info作为日志
+    Buffer buffer;
+    HttpResponse::makeErrorResponse(buffer, 503, false);
+    int ret = send(clnt_fd, buffer.peek(), buffer.readableBytes(), 0);
+    LOG_DEBUG("client[%d]: %s", clnt_fd, info);
     if (ret < 0) {
         LOG_WARN("send error to client[%d] error!", clnt_fd);
     }
@@ -200,13 +277,21 @@ void WebServer::sendError(int clnt_fd, const char *info) {
 void WebServer::closeConnection(HttpConnection *client) {
     std::unique_lock<std::mutex> lock(mutex_);
     assert(client != nullptr);
-    LOG_INFO("Client[%d] quit!", client->getFd());
-    // 取消监听对应客户端描述符
-    if (clients_.count(client->getFd())) {
-        clients_.erase(client->getFd());
+    int fd = client->getFd();
+    auto verifying = verifying_.find(fd);
+    if (verifying != verifying_.end()) {
+        // 验证协程还在使用该连接, 结束后由它关闭
+        verifying->second = true;
+        return;
     }
-    epoller_->delFd(client->getFd());
+    LOG_INFO("Client[%d] quit!", fd);
+    // 取消监听对应客户端描述符
+    epoller_->delFd(fd);
+    // 先关闭再从clients_中删除, erase会析构client
     client->close();
+    if (clients_.count(fd)) {
+        clients_.erase(fd);
+    }
 }
 
 /// 延长客户端的超时时间, 根据timeout_ms_
@@ -221,17 +306,26 @@ void WebServer::extendTime(HttpConnection *client) {
 void WebServer::handleRead(HttpConnection *client) {
     // 接收到http请求
     assert(client != nullptr);
+    // 广播可能在工作线程处理期间重新注册了事件, 同一连接不能同时被两个线程处理
+    WebSocket *ws = client->getWebSocket();
+    if (ws && !ws->acquire()) {
+        return;
+    }
     // 延长该客户端的超时时间
     extendTime(client);
     // 让线程池去处理实际的http业务
-    threadpool_->addTask(std::bind(&WebServer::onRead, this, client));
+    Executors::getInstance()->addTask(Executors::EXECUTOR_FAST, [this, client] { onRead(client); });
 }
 
 void WebServer::handleWrite(HttpConnection *client) {
     assert(client != nullptr);
+    WebSocket *ws = client->getWebSocket();
+    if (ws && !ws->acquire()) {
+        return;
+    }
     extendTime(client);
 
-    threadpool_->addTask(std::bind(&WebServer::onWrite, this, client));
+    Executors::getInstance()->addTask(Executors::EXECUTOR_FAST, [this, client] { onWrite(client); });
 }
 
 void WebServer::initEventMode(int trigger_mode) {
@@ -263,13 +357,67 @@ void WebServer::initEventMode(int trigger_mode) {
 }
 
 void WebServer::onProcess(HttpConnection *client) {
-    if (client->process()) {
-        epoller_->modFd(client->getFd(), conn_event_ | EPOLLOUT);
+    bool ready = client->process();
+    if (client->isVerifyPending()) {
+        // 连接是EPOLLONESHOT, 验证完成之前不会有其他线程处理它
+        // HTTP/2连接上其他流已生成的响应在验证完成后一起发送
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            verifying_[client->getFd()] = false;
+        }
+        onVerify(client).detach();
+    } else if (ready) {
+        rearm(client, EPOLLOUT);
     } else {
-        epoller_->modFd(client->getFd(), conn_event_ | EPOLLIN);
+        rearm(client, EPOLLIN);
     }
 }
 
+CoTask<> WebServer::onVerify(HttpConnection *client) {
+    UserStore *store = UserStore::getInstance();
+    if (store == nullptr || store->isBlocking()) {
+        // 之后的代码在阻塞执行器的线程中继续, 当前线程回去处理其他连接
+        co_await resumeOn(Executors::EXECUTOR_BLOCKING);
+    }
+    // 不阻塞的存储(嵌入式存储, 非阻塞的MySQL)在当前线程验证, 等待时协程挂起, 之后在快速执行器中继续
+    co_await client->verifyAsync();
+    bool closing = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = verifying_.find(client->getFd());
+        closing = it->second;
+        verifying_.erase(it);
+    }
+    if (closing) {
+        // 验证期间已超时, 定时器的结点已经删除
+        closeConnection(client);
+        co_return;
+    }
+    rearm(client, EPOLLOUT);
+}
+
+void WebServer::rearm(HttpConnection *client, uint32_t events) {
+    // WebSocket连接处理期间可能有广播的帧进入队列, 释放时一并注册EPOLLOUT
+    WebSocket *ws = client->getWebSocket();
+    if (ws) {
+        events = ws->release(events);
+    }
+    epoller_->modFd(client->getFd(), conn_event_ | events);
+}
+
+void WebServer::setWebSocketHandler(WebSocket::MessageHandler handler) {
+    WebSocket::handler = std::move(handler);
+}
+
+void WebServer::broadcast(const std::string &message, bool is_binary) {
+    // 帧只序列化一次, 所有连接共享同一块内存
+    auto frame = WebSocket::makeFrame(is_binary ? WebSocket::BINARY : WebSocket::TEXT,
+                                      message.data(), message.size());
+    WebSocket::broadcast(frame, [this](int fd) {
+        epoller_->modFd(fd, conn_event_ | EPOLLIN | EPOLLOUT);
+    });
+}
+
 void WebServer::onRead(HttpConnection *client) {
     assert(client != nullptr);
     int ret = -1;
@@ -296,11 +444,10 @@ void WebServer::onWrite(HttpConnection *client) {
             onProcess(client);
             return;
         }
-    } else if (ret < 0) {
-        if (write_errno == EAGAIN) {
-            epoller_->modFd(client->getFd(), conn_event_ | EPOLLOUT);
-            return;
-        }
+    } else if (ret > 0 || (ret < 0 && write_errno == EAGAIN)) {
+        // 发送缓冲区已满, 或LT模式下只写了一部分, 等待下一次可写
+        rearm(client, EPOLLOUT);
+        return;
     }
     closeConnection(client);
 }
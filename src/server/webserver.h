@@ -5,10 +5,21 @@
 #ifndef WEBSERVER_H
 #define WEBSERVER_H
 #include <netinet/in.h>
+#include <string.h>
 
 #include "epoller.h"
+#include "reactor.h"
+#include "async_sql.h"
+#include "async_mysql_user_store.h"
+#include "cache/fd_cache.h"
+#include "cache/file_cache.h"
+#include "cache/asset_bundle.h"
+#include "cache/session_cache.h"
+#include "cache/user_cache.h"
 #include "http/http_conn.h"
-#include "pool/threadpool.h"
+#include "pool/co_executor.h"
+#include "pool/executor.h"
+#include "store/local_user_store.h"
 #include "timer/heap_timer.h"
 
 
@@ -17,9 +28,16 @@ public:
     WebServer(int port, int trigger_mode, int timeout_ms, bool opt_linger,
               int sql_port, const char* sql_user, const char* sql_pwd,
               const char* db_name, int sql_conn_num, int threadpool_num,
-              bool open_log, int log_level, int log_que_size);
+              bool open_log, int log_level, int log_que_size,
+              size_t file_cache_size = 64 * 1024 * 1024, bool compress = false,
+              const char* cache_control = "no-cache", const char* asset_bundle = "",
+              int threadpool_max = 0, int sql_conn_max = 0, const char* user_store = "");
     ~WebServer();
     void start();
+    // 设置WebSocket消息回调, 在工作线程中执行
+    void setWebSocketHandler(WebSocket::MessageHandler handler);
+    // 向所有WebSocket连接广播一条消息, 可以在任意线程调用
+    void broadcast(const std::string &message, bool is_binary = false);
 private:
     bool initSocket();
     void initEventMode(int trigger_mode);
@@ -36,8 +54,14 @@ private:
     void onRead(HttpConnection* client);
     void onWrite(HttpConnection* client);
     void onProcess(HttpConnection* client);
+    // 协程: 通过UserStore验证用户(存储阻塞时切换到阻塞执行器), 生成响应后注册EPOLLOUT
+    CoTask<> onVerify(HttpConnection* client);
+    // 工作线程处理完毕, 重新注册连接的事件
+    void rearm(HttpConnection* client, uint32_t events);
 
     static const int MAX_FD = 65536;
+    static const int FD_CACHE_SIZE = 512; // 缓存的路径数(包括不存在的路径)
+    static const int SESSION_NUM = 65536; // 最多保存的登录会话数
     static int setFdNonBlock(int fd);
 
     int port_;          // 服务器端口号
@@ -45,16 +69,20 @@ private:
     int timeout_ms_;    // 定时时间
     bool is_closed_;    // 服务器是否关闭
     int server_fd_;     // 服务器监听的fd
-    char *src_dir_;      // 资源目录
+    std::string src_dir_; // 资源目录
+    int notify_fd_;     // 监听资源目录的inotify, 失败或使用资源包时为-1
+    int reactor_fd_;    // 协程等待的套接字和定时器的epoll fd, 可读时由主循环处理
 
     uint32_t listen_event_; // 服务器的监听事件
     uint32_t conn_event_;   // 接收后的连接事件
 
     std::mutex mutex_;  // closeConnection可能会被多个线程调用, 会操作clients_变量
     std::unique_ptr<HeapTimer> timer_;      // 堆计时器
-    std::unique_ptr<Threadpool> threadpool_;// 线程池
     std::unique_ptr<Epoller> epoller_;      // epoll封装
     std::unordered_map<int, HttpConnection> clients_;   // 客户端连接信息
+    // 正在验证的连接, 由mutex_保护: 验证协程持有连接的指针, 期间超时不能析构连接,
+    // 只标记为true, 由协程在验证结束后关闭
+    std::unordered_map<int, bool> verifying_;
 
 };
 
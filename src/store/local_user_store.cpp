@@ -0,0 +1,185 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "local_user_store.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <mutex>
+
+#include "logger/logger.h"
+
+namespace {
+// 记录: 用户名长度(4字节, 小端), 密码长度(4字节, 小端), 用户名, 密码
+const size_t RECORD_HEAD_SIZE = 8;
+
+void appendUint32(std::string &out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>(value >> (i * 8) & 0xff));
+    }
+}
+
+uint32_t readUint32(const char *data) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << (i * 8);
+    }
+    return value;
+}
+} // namespace
+
+LocalUserStore::LocalUserStore(const std::string &path, bool sync): path_(path), sync_(sync), fd_(-1), size_(0) {
+}
+
+LocalUserStore::~LocalUserStore() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool LocalUserStore::open() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    assert(fd_ < 0);
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd_ < 0) {
+        LOG_ERROR("LocalUserStore: open %s error: %s", path_.c_str(), strerror(errno));
+        return false;
+    }
+    off_t end = replay();
+    if (end < 0) {
+        // 不是用户日志或者中间的记录损坏, 不能截断, 否则之后的完整记录都会丢失
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    struct stat file_stat = {};
+    fstat(fd_, &file_stat);
+    if (file_stat.st_size != end) {
+        // 上次写入时崩溃留下的半条记录, 截掉后从完整的记录之后继续追加
+        LOG_WARN("LocalUserStore: truncate %lld bytes of incomplete record",
+                 static_cast<long long>(file_stat.st_size - end));
+        if (ftruncate(fd_, end) < 0) {
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+    }
+    if (end == 0 && !writeAll(fd_, MAGIC, MAGIC_SIZE)) {
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    size_ = end == 0 ? static_cast<off_t>(MAGIC_SIZE) : end;
+    LOG_INFO("LocalUserStore: %s, %zu users", path_.c_str(), users_.size());
+    return true;
+}
+
+off_t LocalUserStore::replay() {
+    std::string data;
+    char buf[64 * 1024];
+    ssize_t len = 0;
+    while ((len = pread(fd_, buf, sizeof(buf), data.size())) > 0) {
+        data.append(buf, len);
+    }
+    if (len < 0) {
+        LOG_ERROR("LocalUserStore: read %s error: %s", path_.c_str(), strerror(errno));
+        return -1;
+    }
+    // 空文件或者文件头没有写完整, 重新写文件头
+    if (data.size() < MAGIC_SIZE) {
+        if (data.compare(0, data.size(), MAGIC, data.size()) == 0) {
+            return 0;
+        }
+        LOG_ERROR("LocalUserStore: %s is not a user log", path_.c_str());
+        return -1;
+    }
+    if (data.compare(0, MAGIC_SIZE, MAGIC) != 0) {
+        LOG_ERROR("LocalUserStore: %s is not a user log", path_.c_str());
+        return -1;
+    }
+    size_t pos = MAGIC_SIZE;
+    while (data.size() - pos >= RECORD_HEAD_SIZE) {
+        uint32_t name_len = readUint32(data.data() + pos);
+        uint32_t pwd_len = readUint32(data.data() + pos + 4);
+        if (name_len == 0 || name_len > MAX_FIELD_SIZE || pwd_len > MAX_FIELD_SIZE) {
+            LOG_ERROR("LocalUserStore: %s has a corrupted record at offset %zu", path_.c_str(), pos);
+            return -1;
+        }
+        if (data.size() - pos - RECORD_HEAD_SIZE < name_len + pwd_len) {
+            // 长度有效但数据不够, 只可能是最后一条写了一半的记录
+            break;
+        }
+        const char *record = data.data() + pos + RECORD_HEAD_SIZE;
+        users_.emplace(std::string(record, name_len), std::string(record + name_len, pwd_len));
+        pos += RECORD_HEAD_SIZE + name_len + pwd_len;
+    }
+    return static_cast<off_t>(pos);
+}
+
+bool LocalUserStore::writeAll(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t ret = write(fd, data, len);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return false;
+        }
+        data += ret;
+        len -= ret;
+    }
+    return true;
+}
+
+UserStore::STATUS LocalUserStore::find(const std::string &name, std::string &password) {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (fd_ < 0) {
+        return ERROR;
+    }
+    auto it = users_.find(name);
+    if (it == users_.end()) {
+        return NOT_FOUND;
+    }
+    password = it->second;
+    return OK;
+}
+
+UserStore::STATUS LocalUserStore::add(const std::string &name, const std::string &password) {
+    if (name.empty() || name.size() > MAX_FIELD_SIZE || password.size() > MAX_FIELD_SIZE) {
+        return ERROR;
+    }
+    std::string record;
+    record.reserve(RECORD_HEAD_SIZE + name.size() + password.size());
+    appendUint32(record, name.size());
+    appendUint32(record, password.size());
+    record += name;
+    record += password;
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (fd_ < 0) {
+        return ERROR;
+    }
+    if (users_.count(name)) {
+        return EXISTS;
+    }
+    // 写入失败时去掉写了一半的记录, 否则之后追加的记录在重放时都会被丢弃
+    if (!writeAll(fd_, record.data(), record.size()) || (sync_ && fdatasync(fd_) < 0)) {
+        LOG_ERROR("LocalUserStore: write %s error: %s", path_.c_str(), strerror(errno));
+        if (ftruncate(fd_, size_) < 0) {
+            LOG_ERROR("LocalUserStore: truncate %s error: %s", path_.c_str(), strerror(errno));
+        }
+        return ERROR;
+    }
+    size_ += static_cast<off_t>(record.size());
+    users_.emplace(name, password);
+    return OK;
+}
+
+size_t LocalUserStore::size() {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return users_.size();
+}
@@ -0,0 +1,63 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef LOCAL_USER_STORE_H
+#define LOCAL_USER_STORE_H
+#pragma once
+
+#include <sys/types.h>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "user_store.h"
+
+// 嵌入式的用户存储: 所有用户在内存的哈希表中, 每次注册在日志文件末尾追加一条记录
+// - 启动时顺序读取日志重建哈希表, 末尾不完整的记录(写入时崩溃)被截掉;
+//   中间的记录损坏时打开失败, 不丢弃任何完整的记录
+// - 查找只读哈希表(共享锁), 不访问文件; 添加持有独占锁, 写入日志成功后才放入哈希表
+// - sync为true时每次添加后fdatasync, 此时访问会阻塞, 交给阻塞执行器
+// 只适合单进程使用: 多个进程同时追加同一个文件时彼此看不到对方的用户
+class LocalUserStore : public UserStore {
+public:
+    explicit LocalUserStore(const std::string &path, bool sync = false);
+
+    ~LocalUserStore() override;
+
+    // 打开日志文件(不存在时创建)并重放, 失败返回false
+    bool open();
+
+    STATUS find(const std::string &name, std::string &password) override;
+
+    STATUS add(const std::string &name, const std::string &password) override;
+
+    bool isBlocking() const override { return sync_; }
+
+    const char *name() const override { return "local"; }
+
+    size_t size();
+
+    // 用户名和密码的最大长度, 也用于识别损坏的记录
+    static const size_t MAX_FIELD_SIZE = 4096;
+
+private:
+    // 读取整个日志文件, 返回完整记录结束的位置, 之后只可能是末尾写了一半的记录;
+    // 不是用户日志或者记录的长度无效(中间的记录损坏)时返回-1
+    off_t replay();
+
+    static bool writeAll(int fd, const char *data, size_t len);
+
+    static constexpr char MAGIC[] = "WSUSERS1"; // 文件头, 格式改变时修改版本号
+    static const size_t MAGIC_SIZE = sizeof(MAGIC) - 1;
+
+    std::string path_;
+    bool sync_;
+    int fd_;
+    off_t size_; // 有效记录结束的位置, 写入失败时截断到这里
+    std::shared_mutex mutex_;
+    std::unordered_map<std::string, std::string> users_;
+};
+
+
+#endif //LOCAL_USER_STORE_H
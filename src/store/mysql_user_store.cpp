@@ -0,0 +1,52 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "mysql_user_store.h"
+
+#include "logger/logger.h"
+#include "pool/sqlconnRAll.h"
+
+const char *const MySQLUserStore::SELECT_USER_SQL = "SELECT username, password FROM user WHERE username=? LIMIT 1";
+const char *const MySQLUserStore::INSERT_USER_SQL = "INSERT INTO user(username, password) VALUES(?, ?)";
+const int MySQLUserStore::SELECT_USER_STMT = SQLConnPool::registerStmt(SELECT_USER_SQL);
+const int MySQLUserStore::INSERT_USER_STMT = SQLConnPool::registerStmt(INSERT_USER_SQL);
+
+UserStore::STATUS MySQLUserStore::find(const std::string &name, std::string &password) {
+    MYSQL *sql = nullptr;
+    // 连接在函数返回时归还
+    SQLConnRAll guard(&sql, SQLConnPool::getInstance());
+    // 预处理语句: 参数以二进制协议单独发送, 服务器不再解析每条SQL, 用户名也不会被当作SQL
+    SQLStmt *select = sql ? SQLConnPool::getInstance()->getStmt(sql, SELECT_USER_STMT) : nullptr;
+    if (select == nullptr || !select->execute({name})) {
+        return ERROR;
+    }
+    STATUS status = NOT_FOUND;
+    while (select->fetch()) {
+        password = select->column(1);
+        LOG_DEBUG("MYSQL ROW: %s", password.c_str());
+        status = OK;
+    }
+    return status;
+}
+
+UserStore::STATUS MySQLUserStore::add(const std::string &name, const std::string &password) {
+    MYSQL *sql = nullptr;
+    SQLConnRAll guard(&sql, SQLConnPool::getInstance());
+    SQLStmt *select = sql ? SQLConnPool::getInstance()->getStmt(sql, SELECT_USER_STMT) : nullptr;
+    if (select == nullptr || !select->execute({name})) {
+        return ERROR;
+    }
+    // 用户表的username不一定有唯一约束, 先查询是否已有相同的用户名
+    if (select->fetch()) {
+        LOG_DEBUG("user used!");
+        return EXISTS;
+    }
+    SQLStmt *insert = SQLConnPool::getInstance()->getStmt(sql, INSERT_USER_STMT);
+    if (insert == nullptr || !insert->execute({name, password})) {
+        LOG_DEBUG("Insert error!");
+        // 有唯一约束时, 并发注册的另一个请求先插入了
+        return insert != nullptr && insert->error() == DUP_ENTRY ? EXISTS : ERROR;
+    }
+    return OK;
+}
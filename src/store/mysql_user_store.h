@@ -0,0 +1,36 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef MYSQL_USER_STORE_H
+#define MYSQL_USER_STORE_H
+#pragma once
+
+#include "user_store.h"
+
+// 用户表在MySQL中, 使用SQLConnPool的连接和每个连接上缓存的预处理语句
+// 连接池由调用者初始化和关闭
+class MySQLUserStore : public UserStore {
+public:
+    STATUS find(const std::string &name, std::string &password) override;
+
+    STATUS add(const std::string &name, const std::string &password) override;
+
+    bool isBlocking() const override { return true; }
+
+    const char *name() const override { return "mysql"; }
+
+protected:
+    // 用户表的SQL, 预处理语句和非阻塞的查询(AsyncMySQLUserStore)共用
+    static const char *const SELECT_USER_SQL;
+    static const char *const INSERT_USER_SQL;
+    static const unsigned int DUP_ENTRY = 1062; // ER_DUP_ENTRY, 有唯一约束时重复插入
+
+private:
+    // 预处理语句在连接池中的编号
+    static const int SELECT_USER_STMT;
+    static const int INSERT_USER_STMT;
+};
+
+
+#endif //MYSQL_USER_STORE_H
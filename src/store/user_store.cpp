@@ -0,0 +1,31 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include "user_store.h"
+
+namespace {
+// 只在启动阶段修改, 之后只读
+std::unique_ptr<UserStore> &storeInstance() {
+    static std::unique_ptr<UserStore> store;
+    return store;
+}
+} // namespace
+
+UserStore *UserStore::getInstance() {
+    return storeInstance().get();
+}
+
+void UserStore::setInstance(std::unique_ptr<UserStore> store) {
+    storeInstance() = std::move(store);
+}
+
+CoTask<UserStore::User> UserStore::findAsync(std::string name) {
+    User user{NOT_FOUND, ""};
+    user.status = find(name, user.password);
+    co_return user;
+}
+
+CoTask<UserStore::STATUS> UserStore::addAsync(std::string name, std::string password) {
+    co_return add(name, password);
+}
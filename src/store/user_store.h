@@ -0,0 +1,60 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#ifndef USER_STORE_H
+#define USER_STORE_H
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "pool/co_task.h"
+
+// 用户数据的存储后端, 登录和注册只通过它访问用户表, 启动时选择实现:
+// - MySQLUserStore: 连接池中的MySQL连接和预处理语句
+// - LocalUserStore: 进程内的哈希表和追加写的日志文件, 不需要任何外部服务
+class UserStore {
+public:
+    enum STATUS {
+        OK,
+        NOT_FOUND, // 用户不存在(find)
+        EXISTS, // 用户名已被使用(add)
+        ERROR, // 存储不可用
+    };
+
+    // 查找的结果, 协程版本使用
+    struct User {
+        STATUS status;
+        std::string password;
+    };
+
+    virtual ~UserStore() = default;
+
+    /// 查找用户
+    /// @param password 返回OK时为用户的密码
+    virtual STATUS find(const std::string &name, std::string &password) = 0;
+
+    // 添加用户, 用户名已存在时返回EXISTS
+    virtual STATUS add(const std::string &name, const std::string &password) = 0;
+
+    // 协程版本, 默认在当前线程调用find; 不阻塞的后端在等待时挂起, 之后可能在其他线程中恢复
+    virtual CoTask<User> findAsync(std::string name);
+
+    // 协程版本, 默认在当前线程调用add
+    virtual CoTask<STATUS> addAsync(std::string name, std::string password);
+
+    // 协程版本的访问是否会阻塞当前线程(网络, 磁盘同步), 阻塞的后端只在阻塞执行器中访问
+    virtual bool isBlocking() const = 0;
+
+    virtual const char *name() const = 0;
+
+    // 当前使用的后端, 没有设置时返回nullptr
+    static UserStore *getInstance();
+
+    // 启动阶段设置使用的后端, 之前的后端被释放
+    static void setInstance(std::unique_ptr<UserStore> store);
+};
+
+
+#endif //USER_STORE_H
@@ -0,0 +1,167 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+// 非阻塞数据库测试: 测试自己启动一个说MySQL协议的替身服务器(mysql_standin.h), 每条查询延迟一段时间再回复
+// 用2个快速执行器线程和4个连接同时发出100条查询: 同时进行的查询应达到连接数, 总耗时接近 100 / 4 * 延迟
+// 需要MariaDB Connector/C的mysql.h(有非阻塞API), 使用Oracle的libmysqlclient时CMake不生成该测试
+// 用法: async_sql_test            运行测试
+//      async_sql_test --serve 端口 只运行替身服务器, 可以用其他客户端连接检查
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mysql_standin.h"
+#include "src/server/async_sql.h"
+#include "src/server/reactor.h"
+#include "src/pool/executor.h"
+
+static void testQuery() {
+    AsyncSql *sql = AsyncSql::getInstance();
+    // 参数中的引号和反斜杠被转义
+    std::vector<std::string> params = {"o'neil\\", "pwd"};
+    SqlResult insert = syncWait(sql->query("INSERT INTO user(username, password) VALUES(?, ?)", params));
+    assert(insert.ok && insert.affected_rows == 1);
+    SqlResult duplicate = syncWait(sql->query("INSERT INTO user(username, password) VALUES(?, ?)", params));
+    assert(!duplicate.ok && duplicate.error == 1062);
+    SqlResult select = syncWait(sql->query("SELECT username, password FROM user WHERE username=? LIMIT 1",
+                                           {params[0]}));
+    assert(select.ok && select.rows.size() == 1);
+    assert(select.rows[0][0] == params[0] && select.rows[0][1] == "pwd");
+    SqlResult missing = syncWait(sql->query("SELECT username, password FROM user WHERE username=? LIMIT 1",
+                                            {"nobody"}));
+    assert(missing.ok && missing.rows.empty());
+    printf("query          PASS\n");
+}
+
+static void testConcurrent(StandInServer &server, int conn_size, int delay_ms) {
+    const int count = 100;
+    std::atomic<int> done{0};
+    std::atomic<int> failed{0};
+    auto one = [&](int i) -> CoTask<> {
+        std::vector<std::string> params = {"user" + std::to_string(i % 10)};
+        SqlResult result = co_await AsyncSql::getInstance()->query(
+            "SELECT username, password FROM user WHERE username=? LIMIT 1", std::move(params));
+        if (!result.ok) {
+            failed.fetch_add(1);
+        }
+        done.fetch_add(1);
+    };
+    int before = server.queries();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        one(i).detach();
+    }
+    while (done.load() < count) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    assert(failed.load() == 0 && server.queries() - before == count);
+    // 2个线程阻塞地查询时最多同时2条, 非阻塞时等于连接数
+    assert(server.maxActive() == conn_size);
+    assert(elapsed.count() < count * delay_ms / 2);
+    printf("concurrent     PASS (%d queries x %dms on %d connections, 2 threads: %lld ms, max in flight %d)\n",
+           count, delay_ms, conn_size, static_cast<long long>(elapsed.count()), server.maxActive());
+}
+
+// 替身服务器断开所有连接(如数据库重启): 每个连接的下一条查询失败并重新连接, 之后的查询都成功
+static void testReconnect(StandInServer &server, int conn_size) {
+    int before = server.connections();
+    server.dropConnections();
+    // 同时发出conn_size条查询, 返回失败的条数
+    auto round = [conn_size]() {
+        std::atomic<int> done{0};
+        std::atomic<int> failed{0};
+        auto one = [&]() -> CoTask<> {
+            std::vector<std::string> params = {"user0"};
+            SqlResult result = co_await AsyncSql::getInstance()->query(
+                "SELECT username, password FROM user WHERE username=? LIMIT 1", std::move(params));
+            if (!result.ok) {
+                failed.fetch_add(1);
+            }
+            done.fetch_add(1);
+        };
+        for (int i = 0; i < conn_size; ++i) {
+            one().detach();
+        }
+        while (done.load() < conn_size) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return failed.load();
+    };
+    // 断开的连接被取到的顺序不确定, 一轮全部成功时所有连接都已经恢复
+    int failed = 0;
+    int rounds = 0;
+    for (int ret = -1; ret != 0 && rounds < 10; ++rounds) {
+        ret = round();
+        failed += ret;
+    }
+    assert(failed == conn_size && server.connections() - before == conn_size);
+    assert(AsyncSql::getInstance()->inFlight() == 0);
+    printf("reconnect      PASS (%d failed queries, %d rounds)\n", failed, rounds);
+}
+
+// 关闭时进行中和等待连接的查询以错误结束, 不会挂起; 和WebServer析构时一样先停止事件循环和执行器
+// 事件循环先停止, 查询都停在等待套接字或者等待连接上
+static void testClose(std::thread &loop, int conn_size) {
+    Reactor::getInstance()->stop();
+    loop.join();
+    std::atomic<int> failed{0};
+    auto one = [&]() -> CoTask<> {
+        SqlResult result = co_await AsyncSql::getInstance()->query("SELECT 1");
+        if (!result.ok) {
+            failed.fetch_add(1);
+        }
+    };
+    const int count = conn_size * 2;
+    for (int i = 0; i < count; ++i) {
+        one().detach();
+    }
+    assert(AsyncSql::getInstance()->inFlight() == static_cast<size_t>(conn_size));
+    Executors::getInstance()->shutdown();
+    AsyncSql::getInstance()->close();
+    assert(failed.load() == count);
+    printf("close          PASS\n");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 3 && strcmp(argv[1], "--serve") == 0) {
+        StandInServer server(0);
+        int port = server.start(atoi(argv[2]));
+        if (port < 0) {
+            perror("listen");
+            return 1;
+        }
+        printf("stand-in MySQL server on 127.0.0.1:%d\n", port);
+        pause();
+        return 0;
+    }
+    const int delay_ms = 20;
+    const int conn_size = 4;
+    StandInServer server(delay_ms);
+    int port = server.start(0);
+    assert(port > 0);
+    if (!AsyncSql::isSupported()) {
+        fprintf(stderr, "FAIL: mysql.h has no non-blocking API, build against MariaDB Connector/C\n");
+        return 1;
+    }
+    bool ok = Reactor::getInstance()->init();
+    assert(ok);
+    std::thread loop([] { Reactor::getInstance()->run(); });
+    Executors::getInstance()->init(Executors::EXECUTOR_FAST, Threadpool::Options{2});
+    Executors::getInstance()->init(Executors::EXECUTOR_BLOCKING, Threadpool::Options{2});
+    ok = AsyncSql::getInstance()->init("127.0.0.1", port, "root", "root", "webserver", conn_size);
+    assert(ok);
+    testQuery();
+    testConcurrent(server, conn_size, delay_ms);
+    testReconnect(server, conn_size);
+    testClose(loop, conn_size);
+    server.stop();
+    return 0;
+}
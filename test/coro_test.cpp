@@ -0,0 +1,173 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+// 协程测试: CoTask的返回值和异常, 执行器切换, 套接字可读/可写, 定时器
+// 最后用2个工作线程同时挂起1000个等待50ms的协程, 总耗时应接近50ms而不是25s
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "src/pool/co_executor.h"
+#include "src/server/reactor.h"
+
+static CoTask<int> add(int a, int b) {
+    co_return a + b;
+}
+
+static CoTask<int> sum(int n) {
+    int total = 0;
+    for (int i = 1; i <= n; ++i) {
+        total = co_await add(total, i);
+    }
+    co_return total;
+}
+
+static CoTask<> fail() {
+    throw std::runtime_error("expected");
+    co_return;
+}
+
+static void testTask() {
+    assert(syncWait(sum(100)) == 5050);
+    bool caught = false;
+    try {
+        syncWait(fail());
+    } catch (const std::runtime_error &) {
+        caught = true;
+    }
+    assert(caught);
+    printf("task          PASS\n");
+}
+
+static CoTask<bool> hop() {
+    std::thread::id caller = std::this_thread::get_id();
+    co_await resumeOn(Executors::EXECUTOR_BLOCKING);
+    bool moved = std::this_thread::get_id() != caller;
+    co_await resumeOn(Executors::EXECUTOR_FAST);
+    co_return moved;
+}
+
+static void testHop() {
+    assert(syncWait(hop()));
+    printf("executor hop  PASS\n");
+}
+
+// 逐行回显, 直到对方关闭
+static CoTask<size_t> echo(int fd) {
+    size_t total = 0;
+    char buf[256];
+    while (true) {
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if (len == 0) {
+            break;
+        }
+        if (len < 0) {
+            if (errno != EAGAIN) {
+                break;
+            }
+            co_await readable(fd);
+            continue;
+        }
+        total += len;
+        for (ssize_t sent = 0; sent < len;) {
+            ssize_t ret = write(fd, buf + sent, len - sent);
+            if (ret < 0) {
+                co_await writable(fd);
+                continue;
+            }
+            sent += ret;
+        }
+    }
+    Reactor::getInstance()->removeFd(fd);
+    close(fd);
+    co_return total;
+}
+
+static CoTask<std::string> request(int fd, std::string message) {
+    ssize_t ret = write(fd, message.data(), message.size());
+    assert(ret == static_cast<ssize_t>(message.size()));
+    std::string reply;
+    char buf[256];
+    while (reply.size() < message.size()) {
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if (len > 0) {
+            reply.append(buf, len);
+        } else {
+            co_await readable(fd);
+        }
+    }
+    co_return reply;
+}
+
+static CoTask<size_t> client(int fd, int rounds) {
+    size_t total = 0;
+    for (int i = 0; i < rounds; ++i) {
+        std::string message = "ping " + std::to_string(i) + "\n";
+        std::string reply = co_await request(fd, message);
+        assert(reply == message);
+        total += reply.size();
+        co_await sleepFor(std::chrono::milliseconds(1));
+    }
+    Reactor::getInstance()->removeFd(fd);
+    close(fd);
+    co_return total;
+}
+
+static void testSocket() {
+    int fds[2];
+    int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    assert(ret == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    std::atomic<size_t> served{0};
+    auto server = [&]() -> CoTask<> { served = co_await echo(fds[0]); };
+    server().detach();
+    size_t sent = syncWait(client(fds[1], 100));
+    while (served.load() != sent) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    printf("socket echo   PASS (%zu bytes)\n", sent);
+}
+
+static void testSleep() {
+    const int count = 1000;
+    std::atomic<int> done{0};
+    auto slow = [&]() -> CoTask<> {
+        co_await sleepFor(std::chrono::milliseconds(50));
+        done.fetch_add(1);
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        slow().detach();
+    }
+    while (done.load() < count) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    assert(elapsed.count() < 1000);
+    printf("sleep         PASS (%d x 50ms on 2 threads in %lld ms)\n", count, static_cast<long long>(elapsed.count()));
+}
+
+int main() {
+    testTask();
+    bool ok = Reactor::getInstance()->init();
+    assert(ok);
+    std::thread loop([] { Reactor::getInstance()->run(); });
+    Executors::getInstance()->init(Executors::EXECUTOR_FAST, Threadpool::Options{2});
+    Executors::getInstance()->init(Executors::EXECUTOR_BLOCKING, Threadpool::Options{1});
+    testHop();
+    testSocket();
+    testSleep();
+    Reactor::getInstance()->stop();
+    loop.join();
+    Executors::getInstance()->shutdown();
+    return 0;
+}
@@ -0,0 +1,479 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+// 测试用的MySQL替身服务器: 说MySQL协议, 不需要真正的数据库
+// 只实现握手(不检查密码), COM_QUERY的文本结果集, 预处理语句(COM_STMT_PREPARE/EXECUTE/CLOSE)的二进制结果集和OK/ERR
+// 维护一张内存中的user表: SELECT按第一个参数查找用户, INSERT插入(重复时返回1062), 其他语句回复OK
+// 每条查询延迟一段时间再回复, 记录同时在处理的查询数
+// 可以延迟握手(模拟慢的连接建立), 也可以断开所有连接(模拟数据库重启或者空闲连接被服务器关闭)
+#ifndef MYSQL_STANDIN_H
+#define MYSQL_STANDIN_H
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 每个连接一个线程, 只用于测试
+class StandInServer {
+public:
+    explicit StandInServer(int delay_ms): delay_ms_(delay_ms) {}
+
+    ~StandInServer() {
+        stop();
+    }
+
+    // 监听127.0.0.1:port, port为0时由系统分配, 返回实际的端口
+    int start(int port) {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(listen_fd_, 16) < 0) {
+            return -1;
+        }
+        socklen_t len = sizeof(addr);
+        getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&addr), &len);
+        accept_thread_ = std::thread([this] { acceptLoop(); });
+        return ntohs(addr.sin_port);
+    }
+
+    void stop() {
+        if (listen_fd_ < 0) {
+            return;
+        }
+        shutdown(listen_fd_, SHUT_RDWR);
+        accept_thread_.join();
+        close(listen_fd_);
+        listen_fd_ = -1;
+        for (auto &thread: conn_threads_) {
+            thread.join();
+        }
+        conn_threads_.clear();
+    }
+
+    int maxActive() const { return max_active_; }
+
+    int queries() const { return queries_; }
+
+    // 收到的COM_STMT_PREPARE数
+    int prepares() const { return prepares_; }
+
+    // 下一个执行预处理语句的连接丢弃它所有的语句(如服务器重启), 之后执行返回1243
+    void forgetStmts() {
+        forget_stmts_ = true;
+    }
+
+    // 之后的连接延迟这么久才发送握手包
+    void setConnectDelay(int ms) {
+        connect_delay_ms_ = ms;
+    }
+
+    // 已经接受的连接数
+    int connections() const { return connections_; }
+
+    // 当前打开的连接数
+    int openConnections() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return static_cast<int>(open_fds_.size());
+    }
+
+    // 断开所有已经建立的连接, 客户端的下一次读写失败
+    void dropConnections() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int fd: open_fds_) {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+
+private:
+    static const uint32_t CAPABILITIES = 0x1 | 0x2 | 0x4 | 0x8 | 0x200 | 0x2000 | 0x8000 | 0x80000;
+
+    // 一条语句的执行结果
+    struct Result {
+        bool is_set = false; // 结果集
+        std::vector<std::vector<std::string>> rows;
+        uint64_t affected_rows = 0;
+        int error = 0;
+        std::string message;
+    };
+
+    // 预处理语句
+    struct Stmt {
+        std::string sql;
+        uint16_t params = 0;
+        uint16_t columns = 0;
+    };
+
+    void acceptLoop() {
+        while (true) {
+            int fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) {
+                return;
+            }
+            conn_threads_.emplace_back([this, fd] { serve(fd); });
+        }
+    }
+
+    static bool readFull(int fd, char *buf, size_t len) {
+        while (len > 0) {
+            ssize_t ret = read(fd, buf, len);
+            if (ret <= 0) {
+                return false;
+            }
+            buf += ret;
+            len -= ret;
+        }
+        return true;
+    }
+
+    static bool readPacket(int fd, std::string &payload, uint8_t &seq) {
+        char head[4];
+        if (!readFull(fd, head, 4)) {
+            return false;
+        }
+        size_t len = static_cast<uint8_t>(head[0]) | static_cast<uint8_t>(head[1]) << 8 |
+                     static_cast<uint8_t>(head[2]) << 16;
+        seq = head[3];
+        payload.resize(len);
+        return readFull(fd, payload.data(), len);
+    }
+
+    static void writePacket(std::string &out, uint8_t &seq, const std::string &payload) {
+        size_t len = payload.size();
+        out.push_back(static_cast<char>(len & 0xff));
+        out.push_back(static_cast<char>(len >> 8 & 0xff));
+        out.push_back(static_cast<char>(len >> 16 & 0xff));
+        out.push_back(static_cast<char>(seq++));
+        out += payload;
+    }
+
+    static void appendInt(std::string &out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            out.push_back(static_cast<char>(value >> (8 * i) & 0xff));
+        }
+    }
+
+    static void appendLenenc(std::string &out, const std::string &value) {
+        if (value.size() < 251) {
+            out.push_back(static_cast<char>(value.size()));
+        } else {
+            out.push_back('\xfc');
+            appendInt(out, value.size(), 2);
+        }
+        out += value;
+    }
+
+    static uint64_t readInt(const std::string &in, size_t &pos, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes && pos < in.size(); ++i) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(in[pos++])) << (8 * i);
+        }
+        return value;
+    }
+
+    static std::string readLenenc(const std::string &in, size_t &pos) {
+        uint64_t len = readInt(in, pos, 1);
+        if (len == 0xfc) {
+            len = readInt(in, pos, 2);
+        } else if (len == 0xfd) {
+            len = readInt(in, pos, 3);
+        } else if (len == 0xfe) {
+            len = readInt(in, pos, 8);
+        }
+        std::string value = in.substr(std::min(pos, in.size()), len);
+        pos += len;
+        return value;
+    }
+
+    static std::string ok(uint64_t affected_rows) {
+        std::string packet(1, '\0');
+        packet.push_back(static_cast<char>(affected_rows));
+        packet.push_back('\0');
+        appendInt(packet, 0x0002, 2); // SERVER_STATUS_AUTOCOMMIT
+        appendInt(packet, 0, 2);
+        return packet;
+    }
+
+    static std::string eof() {
+        std::string packet(1, '\xfe');
+        appendInt(packet, 0, 2);
+        appendInt(packet, 0x0002, 2);
+        return packet;
+    }
+
+    static std::string error(int code, const std::string &message) {
+        std::string packet(1, '\xff');
+        appendInt(packet, code, 2);
+        packet += "#HY000";
+        packet += message;
+        return packet;
+    }
+
+    static std::string column(const std::string &name) {
+        std::string packet;
+        appendLenenc(packet, "def");
+        appendLenenc(packet, "webserver");
+        appendLenenc(packet, "user");
+        appendLenenc(packet, "user");
+        appendLenenc(packet, name);
+        appendLenenc(packet, name);
+        packet.push_back('\x0c');
+        appendInt(packet, 0x21, 2); // utf8
+        appendInt(packet, 150, 4);
+        packet.push_back('\xfd'); // VAR_STRING
+        appendInt(packet, 0, 2);
+        packet.push_back('\0');
+        appendInt(packet, 0, 2);
+        return packet;
+    }
+
+    // 依次取出sql中用单引号括起的字符串, 去掉反斜杠转义
+    static std::vector<std::string> quoted(const std::string &sql) {
+        std::vector<std::string> values;
+        for (size_t i = 0; i < sql.size(); ++i) {
+            if (sql[i] != '\'') {
+                continue;
+            }
+            std::string value;
+            for (++i; i < sql.size() && sql[i] != '\''; ++i) {
+                if (sql[i] == '\\' && i + 1 < sql.size()) {
+                    ++i;
+                }
+                value.push_back(sql[i]);
+            }
+            values.push_back(value);
+        }
+        return values;
+    }
+
+    static bool isSelect(const std::string &sql) {
+        return strncasecmp(sql.c_str(), "SELECT", 6) == 0;
+    }
+
+    // 在user表上执行, params是语句中的字符串参数
+    Result execute(const std::string &sql, const std::vector<std::string> &params) {
+        int active = ++active_;
+        int expected = max_active_;
+        while (active > expected && !max_active_.compare_exchange_weak(expected, active)) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms_));
+        Result result;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (isSelect(sql)) {
+                result.is_set = true;
+                auto it = params.empty() ? users_.end() : users_.find(params[0]);
+                if (it != users_.end()) {
+                    result.rows.push_back({it->first, it->second});
+                }
+            } else if (strncasecmp(sql.c_str(), "INSERT", 6) == 0 && params.size() == 2) {
+                if (users_.emplace(params[0], params[1]).second) {
+                    result.affected_rows = 1;
+                } else {
+                    result.error = 1062;
+                    result.message = "Duplicate entry";
+                }
+            }
+        }
+        ++queries_;
+        --active_;
+        return result;
+    }
+
+    // 文本协议的结果集, 或者二进制协议(预处理语句)的结果集
+    static void writeResult(std::string &out, const Result &result, bool binary) {
+        uint8_t seq = 1;
+        if (result.error) {
+            writePacket(out, seq, error(result.error, result.message));
+            return;
+        }
+        if (!result.is_set) {
+            writePacket(out, seq, ok(result.affected_rows));
+            return;
+        }
+        writePacket(out, seq, std::string(1, '\x02'));
+        writePacket(out, seq, column("username"));
+        writePacket(out, seq, column("password"));
+        writePacket(out, seq, eof());
+        for (auto &row: result.rows) {
+            std::string packet;
+            if (binary) {
+                // 包头和NULL位图(列数+2位), 没有NULL
+                packet.push_back('\0');
+                packet.append((row.size() + 7 + 2) / 8, '\0');
+            }
+            for (auto &value: row) {
+                appendLenenc(packet, value);
+            }
+            writePacket(out, seq, packet);
+        }
+        writePacket(out, seq, eof());
+    }
+
+    void prepare(std::string &out, const std::string &sql, std::map<uint32_t, Stmt> &stmts, uint32_t &next_id) {
+        ++prepares_;
+        Stmt stmt{sql, 0, 0};
+        for (char ch: sql) {
+            stmt.params += (ch == '?');
+        }
+        stmt.columns = isSelect(sql) ? 2 : 0;
+        uint32_t id = ++next_id;
+        stmts[id] = stmt;
+        uint8_t seq = 1;
+        std::string packet(1, '\0');
+        appendInt(packet, id, 4);
+        appendInt(packet, stmt.columns, 2);
+        appendInt(packet, stmt.params, 2);
+        packet.push_back('\0');
+        appendInt(packet, 0, 2);
+        writePacket(out, seq, packet);
+        if (stmt.params > 0) {
+            for (uint16_t i = 0; i < stmt.params; ++i) {
+                writePacket(out, seq, column("?"));
+            }
+            writePacket(out, seq, eof());
+        }
+        if (stmt.columns > 0) {
+            writePacket(out, seq, column("username"));
+            writePacket(out, seq, column("password"));
+            writePacket(out, seq, eof());
+        }
+    }
+
+    // COM_STMT_EXECUTE: 参数都按长度编码的字符串解析(客户端以MYSQL_TYPE_STRING绑定)
+    Result executeStmt(const std::string &payload, std::map<uint32_t, Stmt> &stmts) {
+        size_t pos = 1;
+        uint32_t id = readInt(payload, pos, 4);
+        auto it = stmts.find(id);
+        if (it == stmts.end()) {
+            Result result;
+            result.error = 1243;
+            result.message = "Unknown prepared statement handler";
+            return result;
+        }
+        const Stmt &stmt = it->second;
+        pos += 1 + 4; // flags, iteration count
+        std::vector<std::string> params;
+        if (stmt.params > 0) {
+            std::string nulls = payload.substr(pos, (stmt.params + 7) / 8);
+            pos += nulls.size();
+            if (readInt(payload, pos, 1) == 1) {
+                pos += 2 * stmt.params; // 参数类型
+            }
+            for (uint16_t i = 0; i < stmt.params; ++i) {
+                bool is_null = static_cast<uint8_t>(nulls[i / 8]) & (1 << (i % 8));
+                params.push_back(is_null ? std::string() : readLenenc(payload, pos));
+            }
+        }
+        return execute(stmt.sql, params);
+    }
+
+    void serve(int fd) {
+        ++connections_;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            open_fds_.insert(fd);
+        }
+        if (connect_delay_ms_ > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(connect_delay_ms_));
+        }
+        std::string out;
+        uint8_t seq = 0;
+        // Handshake V10, mysql_native_password, 不支持SSL
+        std::string greeting(1, '\x0a');
+        greeting += "5.7.0-standin";
+        greeting.push_back('\0');
+        appendInt(greeting, fd, 4);
+        greeting += "abcdefgh";
+        greeting.push_back('\0');
+        appendInt(greeting, CAPABILITIES & 0xffff, 2);
+        greeting.push_back('\x21');
+        appendInt(greeting, 0x0002, 2);
+        appendInt(greeting, CAPABILITIES >> 16, 2);
+        greeting.push_back(21);
+        greeting.append(10, '\0');
+        greeting += "ijklmnopqrst";
+        greeting.push_back('\0');
+        greeting += "mysql_native_password";
+        greeting.push_back('\0');
+        writePacket(out, seq, greeting);
+        std::string payload;
+        // 不检查密码, 直接回复OK
+        bool alive = write(fd, out.data(), out.size()) == static_cast<ssize_t>(out.size()) &&
+                     readPacket(fd, payload, seq);
+        if (alive) {
+            out.clear();
+            ++seq;
+            writePacket(out, seq, ok(0));
+            alive = write(fd, out.data(), out.size()) == static_cast<ssize_t>(out.size());
+        }
+        std::map<uint32_t, Stmt> stmts;
+        uint32_t next_id = 0;
+        while (alive && readPacket(fd, payload, seq) && !payload.empty()) {
+            uint8_t command = payload[0];
+            out.clear();
+            if (command == 0x01) {
+                // COM_QUIT
+                break;
+            } else if (command == 0x03) {
+                std::string sql = payload.substr(1);
+                writeResult(out, execute(sql, quoted(sql)), false);
+            } else if (command == 0x16) {
+                prepare(out, payload.substr(1), stmts, next_id);
+            } else if (command == 0x17) {
+                if (forget_stmts_.exchange(false)) {
+                    stmts.clear();
+                }
+                writeResult(out, executeStmt(payload, stmts), true);
+            } else if (command == 0x19) {
+                // COM_STMT_CLOSE没有回复
+                size_t pos = 1;
+                stmts.erase(readInt(payload, pos, 4));
+                continue;
+            } else {
+                // COM_PING, COM_INIT_DB, COM_STMT_RESET等
+                uint8_t reply = 1;
+                bool known = command == 0x0e || command == 0x02 || command == 0x1a;
+                writePacket(out, reply, known ? ok(0) : error(1047, "Unknown command"));
+            }
+            alive = write(fd, out.data(), out.size()) == static_cast<ssize_t>(out.size());
+        }
+        {
+            // 先移出再关闭, dropConnections不会shutdown被复用的fd
+            std::lock_guard<std::mutex> lock(mutex_);
+            open_fds_.erase(fd);
+        }
+        close(fd);
+    }
+
+    int delay_ms_;
+    int listen_fd_ = -1;
+    std::thread accept_thread_;
+    std::vector<std::thread> conn_threads_; // 只在accept线程中修改, stop时accept线程已经退出
+    std::mutex mutex_;
+    std::map<std::string, std::string> users_;
+    std::set<int> open_fds_;
+    std::atomic<int> connect_delay_ms_{0};
+    std::atomic<int> connections_{0};
+    std::atomic<int> active_{0};
+    std::atomic<int> max_active_{0};
+    std::atomic<int> queries_{0};
+    std::atomic<int> prepares_{0};
+    std::atomic<bool> forget_stmts_{false};
+};
+
+
+#endif //MYSQL_STANDIN_H
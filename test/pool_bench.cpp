@@ -0,0 +1,191 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+// 线程池基准: 两种队列方式下提交和执行任务的吞吐量, 以及每个任务的内存分配次数
+// 最后演示弹性模式: 慢任务积压时增加线程, 空闲后退回最小线程数
+// 用法: pool_bench [线程数] [任务数]
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <thread>
+
+#include "src/pool/threadpool.h"
+
+static std::atomic<size_t> alloc_count{0};
+
+void *operator new(size_t size) {
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+// 和WebServer::onRead的任务一样捕获两个指针
+struct Client {
+    std::atomic<long> handled{0};
+
+    void onRead(Client *client) {
+        client->handled.fetch_add(1);
+    }
+};
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void waitFor(const std::atomic<long> &counter, long target) {
+    while (counter.load() < target) {
+        std::this_thread::yield();
+    }
+}
+
+// 主线程提交(服务器的常见情况: epoll线程分发读写事件)
+static void benchExternal(const char *name, Threadpool &pool, long count) {
+    Client client;
+    // 预热: 填充全局队列和工作线程的缓存
+    for (long i = 0; i < 10000; ++i) {
+        pool.addTask([&client] { client.onRead(&client); });
+    }
+    waitFor(client.handled, 10000);
+    client.handled = 0;
+    // 每批不超过全局队列的容量, 衡量的是队列没有积压时的提交路径
+    const long burst = 4096;
+    count = count / burst * burst;
+    size_t allocs = alloc_count;
+    double submit = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < count; i += burst) {
+        auto burst_start = std::chrono::steady_clock::now();
+        for (long j = 0; j < burst; ++j) {
+            pool.addTask([&client] { client.onRead(&client); });
+        }
+        submit += seconds(burst_start);
+        waitFor(client.handled, i + burst);
+    }
+    double total = seconds(start);
+    printf("%-16s external  submit %6.2f Mtask/s  total %6.2f Mtask/s  allocs/task %.4f\n", name,
+           count / submit / 1e6, count / total / 1e6, static_cast<double>(alloc_count - allocs) / count);
+}
+
+// 工作线程提交(任务再派生任务)
+static void benchNested(const char *name, Threadpool &pool, long count) {
+    std::atomic<long> done{0};
+    static constexpr long fanout = 64;
+    auto run = [&] {
+        size_t allocs = alloc_count;
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < count / fanout; ++i) {
+            pool.addTask([&pool, &done] {
+                for (long j = 0; j < fanout; ++j) {
+                    pool.addTask([&done] { done.fetch_add(1); });
+                }
+            });
+        }
+        waitFor(done, count / fanout * fanout);
+        return std::make_pair(seconds(start), alloc_count - allocs);
+    };
+    run();
+    done = 0;
+    auto [total, allocs] = run();
+    printf("%-16s nested    total %6.2f Mtask/s  allocs/task %.4f\n", name, count / total / 1e6,
+           static_cast<double>(allocs) / count);
+}
+
+// 对比: 用std::function包装同样的任务
+static void benchFunction(long count) {
+    Client client;
+    size_t allocs = alloc_count;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < count; ++i) {
+        std::function<void()> func = std::bind(&Client::onRead, &client, &client);
+        Task task(std::move(func));
+        task();
+    }
+    printf("%-16s wrap+call %6.2f Mtask/s  allocs/task %.4f (std::function再包装一层)\n", "std::function",
+           count / seconds(start) / 1e6, static_cast<double>(alloc_count - allocs) / count);
+    allocs = alloc_count;
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < count; ++i) {
+        Task task(std::bind(&Client::onRead, &client, &client));
+        task();
+    }
+    printf("%-16s wrap+call %6.2f Mtask/s  allocs/task %.4f\n", "Task(bind)", count / seconds(start) / 1e6,
+           static_cast<double>(alloc_count - allocs) / count);
+}
+
+// 阻塞的慢任务(如数据库查询)使排队时间超过目标, 线程数增加到最大; 空闲超时后减少到最小
+static void benchElastic(size_t max_threads) {
+    Threadpool::Options options;
+    options.min_threads = 1;
+    options.max_threads = max_threads;
+    options.queue_target_ms = 10;
+    options.idle_timeout_ms = 200;
+    Threadpool pool(options);
+    std::atomic<long> done{0};
+    const long count = 100;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < count; ++i) {
+        pool.addTask([&done] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            done.fetch_add(1);
+        });
+    }
+    size_t peak = 0;
+    while (done.load() < count) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        Threadpool::Stats stats = pool.getStats();
+        peak = std::max(peak, stats.threads);
+        printf("elastic          threads %zu  busy %zu  queued %3zu  oldest %6lld us  avg %6lld us  max %6lld us\n",
+               stats.threads, stats.busy, stats.queued, static_cast<long long>(stats.oldest_wait_us),
+               static_cast<long long>(stats.avg_wait_us), static_cast<long long>(stats.max_wait_us));
+    }
+    double total = seconds(start);
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    printf("elastic          %ld x 5ms tasks in %.0f ms, peak threads %zu, after idle %zu\n", count, total * 1000, peak,
+           pool.threadCount());
+}
+
+int main(int argc, char *argv[]) {
+    size_t threads = argc > 1 ? atoi(argv[1]) : std::thread::hardware_concurrency();
+    long count = argc > 2 ? atol(argv[2]) : 2000000;
+    printf("threads %zu, tasks %ld, sizeof(Task) %zu\n", threads, count, sizeof(Task));
+    benchFunction(count);
+    {
+        Threadpool pool(threads, Threadpool::QUEUE_WORK_STEALING);
+        benchExternal("work-stealing", pool, count);
+        benchNested("work-stealing", pool, count);
+    }
+    {
+        Threadpool pool(threads, Threadpool::QUEUE_MPMC);
+        benchExternal("mpmc", pool, count);
+        benchNested("mpmc", pool, count);
+    }
+    benchElastic(std::max<size_t>(threads, 4));
+    return 0;
+}
@@ -0,0 +1,181 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+// 响应序列化不分配内存: 预热后重复生成响应, 统计operator new的次数和BufferPool向系统申请的次数
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <new>
+#include <string>
+
+#include "src/buffer/buffer.h"
+#include "src/buffer/buffer_pool.h"
+#include "src/buffer/chain_buffer.h"
+#include "src/cache/fd_cache.h"
+#include "src/cache/file_cache.h"
+#include "src/http/http_response.h"
+
+static std::atomic<size_t> alloc_count{0};
+
+void *operator new(size_t size) {
+    ++alloc_count;
+    void *ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+static void writeFile(const std::string &path, size_t size, char fill) {
+    FILE *fp = fopen(path.c_str(), "w");
+    std::string content(size, fill);
+    fwrite(content.data(), 1, content.size(), fp);
+    fclose(fp);
+}
+
+static int failed = 0;
+
+// 预热(填充缓存, 生成响应头, 扩充复用的容器)后, 场景重复执行不应再分配内存
+static void expectNoAlloc(const char *name, const std::function<void()> &scenario) {
+    for (int i = 0; i < 16; ++i) {
+        scenario();
+    }
+    uint64_t misses = BufferPool::getInstance()->getStats().misses;
+    size_t before = alloc_count;
+    for (int i = 0; i < 10000; ++i) {
+        scenario();
+    }
+    size_t allocs = alloc_count - before;
+    uint64_t pool_misses = BufferPool::getInstance()->getStats().misses - misses;
+    printf("%-12s allocations: %zu, pool misses: %lu\n", name, allocs, static_cast<unsigned long>(pool_misses));
+    if (allocs != 0 || pool_misses != 0) {
+        ++failed;
+    }
+}
+
+int main() {
+    char dir_template[] = "/tmp/serializer_test_XXXXXX";
+    std::string dir = mkdtemp(dir_template);
+    writeFile(dir + "/index.html", 1000, 'a');
+    writeFile(dir + "/404.html", 200, 'b');
+    writeFile(dir + "/big.mp4", 300 * 1024, 'c');
+
+    FdCache::getInstance()->init(1024, -1);
+    FileCache::getInstance()->init(8 * 1024 * 1024, 64 * 1024, -1);
+    HttpResponse::initErrorResponse(dir);
+
+    HttpResponse response;
+    Buffer buffer(0);
+    std::string path;
+    const std::string none;
+    const std::string range_mid = "bytes=100-199";
+    const std::string range_head = "bytes=0-99";
+
+    // 请求头由调用者持有, 这里不构造临时字符串
+    auto serve = [&](const char *target, const std::string &range, const std::string &if_none_match) {
+        path = target;
+        response.init(dir, path, true);
+        response.setRange(range, none);
+        response.setConditional(if_none_match, none);
+        buffer.retrieveAll();
+        response.makeResponse(buffer);
+    };
+
+    expectNoAlloc("200", [&]() {
+        serve("/index.html", none, none);
+    });
+
+    serve("/index.html", none, none);
+    std::string etag = buffer.retrieveAllAsString();
+    etag = etag.substr(etag.find("ETag: ") + 6);
+    etag = etag.substr(0, etag.find("\r\n"));
+    expectNoAlloc("304", [&]() {
+        serve("/index.html", none, etag);
+        if (response.getStatusCode() != 304) {
+            ++failed;
+        }
+    });
+
+    expectNoAlloc("206", [&]() {
+        serve("/big.mp4", range_mid, none);
+        if (response.getStatusCode() != 206) {
+            ++failed;
+        }
+    });
+
+    expectNoAlloc("404", [&]() {
+        serve("/missing.html", none, none);
+    });
+
+    // 响应头和内容挂到发送链上发送, 另一端读走
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    ChainBuffer chain;
+    char sink[4096];
+    expectNoAlloc("chain", [&]() {
+        serve("/index.html", none, none);
+        chain.append(std::move(buffer));
+        chain.appendRef(response.getFile(), response.getFileSize(), response.getKeeper());
+        serve("/big.mp4", range_head, none);
+        chain.append(std::move(buffer));
+        chain.appendFile(response.getFileFd(), 0, 100, response.getKeeper());
+        int save_errno = 0;
+        while (!chain.empty()) {
+            if (chain.writeFd(fds[0], &save_errno, sizeof(sink)) <= 0) {
+                ++failed;
+                chain.clear();
+                break;
+            }
+            while (recv(fds[1], sink, sizeof(sink), MSG_DONTWAIT) > 0) {
+            }
+        }
+    });
+
+    // 长连接上响应一个接一个排队, 每次只发送到剩最后一个字节, 链一直不空, 写完的段也要移出
+    expectNoAlloc("pipelined", [&]() {
+        serve("/index.html", none, none);
+        chain.append(std::move(buffer));
+        chain.appendRef(response.getFile(), response.getFileSize(), response.getKeeper());
+        int save_errno = 0;
+        while (chain.readableBytes() > 1) {
+            if (chain.writeFd(fds[0], &save_errno, std::min(chain.readableBytes() - 1, sizeof(sink))) <= 0) {
+                ++failed;
+                break;
+            }
+            while (recv(fds[1], sink, sizeof(sink), MSG_DONTWAIT) > 0) {
+            }
+        }
+    });
+    chain.clear();
+    close(fds[0]);
+    close(fds[1]);
+
+    response.unmapFile();
+    system(("rm -rf " + dir).c_str());
+    printf(failed == 0 ? "PASS\n" : "FAIL\n");
+    return failed == 0 ? 0 : 1;
+}
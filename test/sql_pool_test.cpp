@@ -0,0 +1,206 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+// 连接池测试: 连接池连接替身服务器(mysql_standin.h)
+// - 启动时并行建立连接, 耗时接近一次连接而不是连接数次
+// - 数据库不可达时取连接返回nullptr, 数据库恢复后按需建立连接
+// - 连接用完时等待到超时返回nullptr, 期间归还的连接交给等待者
+// - 服务器断开的连接在取出时检查并重新连接
+// - 繁忙时连接数增加到max_conn, 空闲后回到min_conn
+#include <assert.h>
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+
+#include "mysql_standin.h"
+#include "src/pool/sqlconnpool.h"
+
+using Clock = std::chrono::steady_clock;
+
+static long long elapsedMs(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+static void printStats(const char *name) {
+    SQLConnPool::Stats stats = SQLConnPool::getInstance()->getStats();
+    printf("%-14s total: %d, busy: %d, idle: %d, checkouts: %llu, timeouts: %llu, reconnects: %llu, "
+           "connect errors: %llu, avg wait: %llu us\n", name, stats.total, stats.busy, stats.idle,
+           static_cast<unsigned long long>(stats.checkouts), static_cast<unsigned long long>(stats.timeouts),
+           static_cast<unsigned long long>(stats.reconnects), static_cast<unsigned long long>(stats.connect_errors),
+           static_cast<unsigned long long>(stats.avg_wait_us));
+}
+
+static bool query(MYSQL *sql) {
+    if (mysql_query(sql, "SELECT 1")) {
+        return false;
+    }
+    MYSQL_RES *res = mysql_store_result(sql);
+    if (res) {
+        mysql_free_result(res);
+    }
+    return true;
+}
+
+static void testParallelStartup(StandInServer &server, int port) {
+    const int delay_ms = 200;
+    server.setConnectDelay(delay_ms);
+    SQLConnPool::Options options;
+    options.min_conn = 4;
+    options.max_conn = 4;
+    auto start = Clock::now();
+    SQLConnPool::getInstance()->initConnPool("127.0.0.1", port, "root", "root", "webserver", options);
+    long long ms = elapsedMs(start);
+    server.setConnectDelay(0);
+    SQLConnPool::Stats stats = SQLConnPool::getInstance()->getStats();
+    assert(stats.total == 4 && stats.idle == 4);
+    assert(ms < delay_ms * 2);
+    printf("startup        PASS %d connections in %lld ms (%d ms each)\n", stats.total, ms, delay_ms);
+    SQLConnPool::getInstance()->closeConnPool();
+}
+
+static void testUnreachable() {
+    StandInServer server(0);
+    int port = server.start(0);
+    assert(port > 0);
+    server.stop();
+    SQLConnPool::Options options;
+    options.min_conn = 2;
+    options.max_conn = 2;
+    options.connect_timeout_s = 1;
+    SQLConnPool::getInstance()->initConnPool("127.0.0.1", port, "root", "root", "webserver", options);
+    SQLConnPool::Stats stats = SQLConnPool::getInstance()->getStats();
+    assert(stats.total == 0 && stats.connect_errors == 2);
+    assert(SQLConnPool::getInstance()->getConn(100) == nullptr);
+    // 数据库恢复后按需连接
+    int ret = server.start(port);
+    assert(ret == port);
+    MYSQL *sql = SQLConnPool::getInstance()->getConn(100);
+    assert(sql && query(sql));
+    SQLConnPool::getInstance()->freeConn(sql);
+    printStats("unreachable");
+    SQLConnPool::getInstance()->closeConnPool();
+    server.stop();
+    printf("unreachable    PASS\n");
+}
+
+static void testTimeout(int port) {
+    SQLConnPool::Options options;
+    options.min_conn = 1;
+    options.max_conn = 1;
+    options.timeout_ms = 100;
+    SQLConnPool::getInstance()->initConnPool("127.0.0.1", port, "root", "root", "webserver", options);
+    MYSQL *held = SQLConnPool::getInstance()->getConn();
+    assert(held);
+    auto start = Clock::now();
+    assert(SQLConnPool::getInstance()->getConn() == nullptr);
+    long long ms = elapsedMs(start);
+    assert(ms >= 100 && ms < 1000);
+    // 等待期间归还的连接交给等待者
+    std::thread releaser([held] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        SQLConnPool::getInstance()->freeConn(held);
+    });
+    MYSQL *sql = SQLConnPool::getInstance()->getConn(1000);
+    releaser.join();
+    assert(sql == held);
+    SQLConnPool::getInstance()->freeConn(sql);
+    SQLConnPool::Stats stats = SQLConnPool::getInstance()->getStats();
+    assert(stats.timeouts == 1 && stats.checkouts == 2 && stats.total == 1);
+    printStats("timeout");
+    SQLConnPool::getInstance()->closeConnPool();
+    printf("timeout        PASS waited %lld ms\n", ms);
+}
+
+static void waitClosed(StandInServer &server, int open) {
+    for (int i = 0; i < 100 && server.openConnections() != open; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(server.openConnections() == open);
+}
+
+static void testReconnect(StandInServer &server, int port) {
+    SQLConnPool::Options options;
+    options.min_conn = 1;
+    options.max_conn = 1;
+    SQLConnPool::getInstance()->initConnPool("127.0.0.1", port, "root", "root", "webserver", options);
+    // 使用中发现连接断开, 归还后下次取出时重新连接
+    MYSQL *sql = SQLConnPool::getInstance()->getConn();
+    assert(sql && query(sql));
+    server.dropConnections();
+    waitClosed(server, 0);
+    assert(!query(sql));
+    SQLConnPool::getInstance()->freeConn(sql);
+    sql = SQLConnPool::getInstance()->getConn();
+    assert(sql && query(sql));
+    SQLConnPool::getInstance()->freeConn(sql);
+    assert(SQLConnPool::getInstance()->getStats().reconnects == 1);
+    SQLConnPool::getInstance()->closeConnPool();
+
+    // 空闲期间被断开(如服务器的wait_timeout), 取出时mysql_ping发现
+    options.ping_idle_ms = 0;
+    SQLConnPool::getInstance()->initConnPool("127.0.0.1", port, "root", "root", "webserver", options);
+    server.dropConnections();
+    waitClosed(server, 0);
+    sql = SQLConnPool::getInstance()->getConn();
+    assert(sql && query(sql));
+    SQLConnPool::getInstance()->freeConn(sql);
+    assert(SQLConnPool::getInstance()->getStats().reconnects == 1);
+    printStats("reconnect");
+    SQLConnPool::getInstance()->closeConnPool();
+    printf("reconnect      PASS\n");
+}
+
+static void testElastic(StandInServer &server, int port) {
+    SQLConnPool::Options options;
+    options.min_conn = 1;
+    options.max_conn = 3;
+    options.idle_timeout_ms = 100;
+    waitClosed(server, 0);
+    SQLConnPool::getInstance()->initConnPool("127.0.0.1", port, "root", "root", "webserver", options);
+    MYSQL *conns[3] = {};
+    for (auto &sql: conns) {
+        sql = SQLConnPool::getInstance()->getConn();
+        assert(sql && query(sql));
+    }
+    assert(server.openConnections() == 3);
+    assert(SQLConnPool::getInstance()->getConn(50) == nullptr);
+    for (auto sql: conns) {
+        SQLConnPool::getInstance()->freeConn(sql);
+    }
+    SQLConnPool::Stats stats = SQLConnPool::getInstance()->getStats();
+    assert(stats.total == 3 && stats.idle == 3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    // 归还时关闭空闲超时的多余连接
+    MYSQL *sql = SQLConnPool::getInstance()->getConn();
+    assert(sql);
+    SQLConnPool::getInstance()->freeConn(sql);
+    stats = SQLConnPool::getInstance()->getStats();
+    assert(stats.total == 1 && stats.idle == 1);
+    waitClosed(server, 1);
+    printStats("elastic");
+    SQLConnPool::getInstance()->closeConnPool();
+    printf("elastic        PASS\n");
+}
+
+int main() {
+    StandInServer server(0);
+    int port = server.start(0);
+    assert(port > 0);
+    SQLConnPool::getInstance()->initConnPool("127.0.0.1", port, "root", "root", "webserver", 1);
+    {
+        MYSQL *sql = SQLConnPool::getInstance()->getConn(100);
+        if (sql == nullptr || !query(sql)) {
+            printf("can not connect to the stand-in server, SKIP\n");
+            return 0;
+        }
+        SQLConnPool::getInstance()->freeConn(sql);
+        SQLConnPool::getInstance()->closeConnPool();
+    }
+    testParallelStartup(server, port);
+    testUnreachable();
+    testTimeout(port);
+    testReconnect(server, port);
+    testElastic(server, port);
+    server.stop();
+    return 0;
+}
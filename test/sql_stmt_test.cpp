@@ -0,0 +1,131 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+// 预处理语句测试: 连接池连接替身服务器(mysql_standin.h)
+// - 参数以二进制协议发送, 含引号的用户名原样插入和查找
+// - 每个连接上每条语句只准备一次
+// - 超过初始缓冲区的结果列扩大后完整读出
+// - 服务器丢弃语句后执行失败, 下次使用时重新准备
+// 最后比较拼接SQL(mysql_query)和预处理语句各执行若干次的耗时
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+#include "mysql_standin.h"
+#include "src/pool/sqlconnRAll.h"
+
+static const int SELECT_USER = SQLConnPool::registerStmt(
+    "SELECT username, password FROM user WHERE username=? LIMIT 1");
+static const int INSERT_USER = SQLConnPool::registerStmt(
+    "INSERT INTO user(username, password) VALUES(?, ?)");
+
+static void testBind() {
+    MYSQL *sql = nullptr;
+    SQLConnRAll guard(&sql, SQLConnPool::getInstance());
+    SQLStmt *insert = SQLConnPool::getInstance()->getStmt(sql, INSERT_USER);
+    SQLStmt *select = SQLConnPool::getInstance()->getStmt(sql, SELECT_USER);
+    assert(insert && select);
+    std::string name = "x' OR '1'='1";
+    bool ok = insert->execute({name, "pwd"});
+    assert(ok && insert->affectedRows() == 1);
+    // 重复的用户名
+    ok = insert->execute({name, "pwd"});
+    assert(!ok && insert->error() == 1062);
+    ok = select->execute({name});
+    assert(ok && select->fetch());
+    assert(select->column(0) == name && select->column(1) == "pwd");
+    assert(!select->fetch());
+    ok = select->execute({"nobody"});
+    assert(ok && !select->fetch());
+    printf("bind           PASS\n");
+}
+
+static void testLongColumn(StandInServer &server) {
+    MYSQL *sql = nullptr;
+    SQLConnRAll guard(&sql, SQLConnPool::getInstance());
+    // 重复键的错误不影响复用, 两条语句各准备过一次
+    SQLStmt *insert = SQLConnPool::getInstance()->getStmt(sql, INSERT_USER);
+    SQLStmt *select = SQLConnPool::getInstance()->getStmt(sql, SELECT_USER);
+    assert(insert && select);
+    std::string password(1000, 'p');
+    bool ok = insert->execute({"long", password});
+    assert(ok);
+    for (int i = 0; i < 2; ++i) {
+        ok = select->execute({"long"});
+        assert(ok && select->fetch());
+        assert(select->column(1) == password);
+    }
+    ok = select->execute({"x' OR '1'='1"});
+    assert(ok && select->fetch() && select->column(1) == "pwd");
+    assert(server.prepares() == 2);
+    printf("long column    PASS\n");
+}
+
+static void testReprepare(StandInServer &server) {
+    MYSQL *sql = nullptr;
+    SQLConnRAll guard(&sql, SQLConnPool::getInstance());
+    SQLStmt *select = SQLConnPool::getInstance()->getStmt(sql, SELECT_USER);
+    assert(select);
+    int prepares = server.prepares();
+    server.forgetStmts();
+    bool ok = select->execute({"long"});
+    assert(!ok && select->error() == 1243 && !select->isPrepared());
+    select = SQLConnPool::getInstance()->getStmt(sql, SELECT_USER);
+    assert(select && server.prepares() == prepares + 1);
+    ok = select->execute({"long"});
+    assert(ok && select->fetch());
+    printf("reprepare      PASS\n");
+}
+
+static void bench(StandInServer &server, int count) {
+    MYSQL *sql = nullptr;
+    SQLConnRAll guard(&sql, SQLConnPool::getInstance());
+    int prepares = server.prepares();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        char order[256] = {};
+        snprintf(order, 256, "SELECT username, password FROM user WHERE username='%s' LIMIT 1", "long");
+        int ret = mysql_query(sql, order);
+        assert(ret == 0);
+        MYSQL_RES *res = mysql_store_result(sql);
+        while (mysql_fetch_row(res)) {}
+        mysql_free_result(res);
+    }
+    auto text = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        SQLStmt *select = SQLConnPool::getInstance()->getStmt(sql, SELECT_USER);
+        bool ok = select->execute({"long"});
+        assert(ok);
+        while (select->fetch()) {}
+    }
+    auto stmt = std::chrono::steady_clock::now() - start;
+    assert(server.prepares() == prepares);
+    printf("bench          %d queries, text: %lld us, prepared: %lld us\n", count,
+           static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(text).count()),
+           static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(stmt).count()));
+}
+
+int main() {
+    StandInServer server(0);
+    int port = server.start(0);
+    assert(port > 0);
+    SQLConnPool::getInstance()->initConnPool("127.0.0.1", port, "root", "root", "webserver", 1);
+    {
+        MYSQL *sql = nullptr;
+        SQLConnRAll guard(&sql, SQLConnPool::getInstance());
+        if (sql == nullptr || SQLConnPool::getInstance()->getStmt(sql, SELECT_USER) == nullptr) {
+            printf("can not connect to the stand-in server, SKIP\n");
+            return 0;
+        }
+    }
+    testBind();
+    testLongColumn(server);
+    testReprepare(server);
+    bench(server, 2000);
+    SQLConnPool::getInstance()->closeConnPool();
+    server.stop();
+    return 0;
+}
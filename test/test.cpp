@@ -4,7 +4,13 @@
 #include <src/logger/logger.h>
 #include <src/pool/threadpool.h>
 #include <features.h>
-#include <src/pool/sqlconnRAll.h>
+#include <functional>
+#include <src/http/http_request.h>
+#include <src/store/local_user_store.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
 #if __GLIBC__ == 2 && __GLIBC_MINOR__ < 30
 #include <sys/syscall.h>
 #define gettid() syscall(SYS_gettid)
@@ -48,14 +54,115 @@ void testThreadPool() {
     getchar();
 }
 
+// 解析登录或注册的表单请求并验证, 返回验证后的页面
+std::string postForm(const char *path, const std::string &name, const std::string &pwd) {
+    std::string body = "username=" + name + "&password=" + pwd;
+    Buffer buffer;
+    buffer.append(std::string("POST ") + path + " HTTP/1.1\r\n");
+    buffer.append("Content-Type: application/x-www-form-urlencoded\r\n");
+    buffer.append("Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body);
+    HttpRequest request;
+    bool ok = request.parse(buffer);
+    assert(ok);
+    request.verify();
+    return request.path();
+}
+
+// 请求路径规范化: 同一个文件只有一种写法, 不能访问资源目录之外的文件
+std::string getPath(const std::string &path) {
+    Buffer buffer;
+    buffer.append("GET " + path + " HTTP/1.1\r\n\r\n");
+    HttpRequest request;
+    return request.parse(buffer) ? request.path() : "<invalid>";
+}
+
+void testPath() {
+    assert(getPath("/index.html") == "/index.html");
+    assert(getPath("/") == "/index.html");
+    assert(getPath("/./index.html") == "/index.html");
+    assert(getPath("//a//b/../index.html") == "/a/index.html");
+    assert(getPath("/%69ndex.html") == "/index.html");
+    assert(getPath("/../../etc/passwd") == "/etc/passwd");
+    assert(getPath("/%2e%2e/%2E%2E/etc/passwd") == "/etc/passwd");
+    assert(getPath("/a/..") == "/index.html");
+    assert(getPath("/dir/") == "/dir/");
+    assert(getPath("/my%20file.txt") == "/my file.txt");
+    assert(getPath("/a%2") == "<invalid>");
+    assert(getPath("/a%zz") == "<invalid>");
+    assert(getPath("/a%00.html") == "<invalid>");
+    printf("path PASS\n");
+}
+
+// 嵌入式用户存储: 不需要MySQL, 走完整的注册和登录流程
+void testLocalUserStore() {
+    const char *path = "./test_users.log";
+    unlink(path);
+    auto store = std::make_unique<LocalUserStore>(path);
+    assert(store->open());
+    UserStore::setInstance(std::move(store));
+    // 关闭用户缓存, 每次验证都访问存储
+    UserCache::Options options;
+    options.max_entries = 0;
+    UserCache::getInstance()->init(options);
+    assert(postForm("/login", "alice", "pwd") == "/error.html");
+    assert(postForm("/register", "alice", "pwd") == "/welcome.html");
+    assert(postForm("/register", "alice", "other") == "/error.html");
+    assert(postForm("/login", "alice", "pwd") == "/welcome.html");
+    assert(postForm("/login", "alice", "bad") == "/error.html");
+
+    // 重启后从日志恢复; 末尾写了一半的记录被截掉, 之后注册的用户不受影响
+    UserStore::setInstance(nullptr);
+    int fd = open(path, O_WRONLY | O_APPEND);
+    assert(write(fd, "\x05\x00\x00\x00\x03", 5) == 5);
+    close(fd);
+    store = std::make_unique<LocalUserStore>(path);
+    assert(store->open() && store->size() == 1);
+    UserStore::setInstance(std::move(store));
+    assert(postForm("/register", "bob", "pwd") == "/welcome.html");
+    UserStore::setInstance(nullptr);
+    store = std::make_unique<LocalUserStore>(path);
+    std::string password;
+    assert(store->open() && store->size() == 2);
+    assert(store->find("bob", password) == UserStore::OK && password == "pwd");
+    UserStore::setInstance(std::move(store));
+
+    // 第一条记录的长度损坏: 打开失败, 文件保持原样, 修复后两个用户都还在
+    struct stat before = {}, after = {};
+    stat(path, &before);
+    fd = open(path, O_RDWR);
+    char name_len[4];
+    assert(pread(fd, name_len, 4, 8) == 4);
+    assert(pwrite(fd, "\xff\xff\xff\xff", 4, 8) == 4);
+    assert(!std::make_unique<LocalUserStore>(path)->open());
+    stat(path, &after);
+    assert(after.st_size == before.st_size);
+    assert(pwrite(fd, name_len, 4, 8) == 4);
+    close(fd);
+    auto restored = std::make_unique<LocalUserStore>(path);
+    assert(restored->open() && restored->size() == 2);
+
+    // 查找用户和完整的登录流程(解析请求 + 验证)的耗时
+    const int count = 10000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        UserStore::getInstance()->find("alice", password);
+    }
+    auto find_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        postForm("/login", "alice", "pwd");
+    }
+    auto login_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    printf("local user store PASS, %d times, find: %.2f us, login: %.2f us\n", count,
+        static_cast<double>(find_us) / count, static_cast<double>(login_us) / count);
+    UserStore::setInstance(nullptr);
+    unlink(path);
+}
+
 int main() {
     //testLogger();
     // testThreadPool();
-    MYSQL *sql = nullptr;
-    auto sqlpool = SQLConnPool::getInstance();
-    sqlpool->initConnPool("localhost", 3306,
-        "root", "", "webserver", 12);
-    SQLConnRAll(&sql, SQLConnPool::getInstance());
-    assert(sql != nullptr);
+    testPath();
+    testLocalUserStore();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,228 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+// 用户缓存和会话测试
+// - 命中, 负缓存, 过期, 淘汰
+// - 同一个用户名同时查询时只有一个加载者, 其他请求等待它的结果; 查询期间失效的结果不缓存
+// - 会话的创建, 校验和过期
+// 最后通过HttpRequest连接替身服务器(mysql_standin.h): 并发登录同一个用户只查询一次数据库,
+// 之后的登录和带会话Cookie的登录不访问数据库
+#include <assert.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mysql_standin.h"
+#include "src/cache/session_cache.h"
+#include "src/cache/user_cache.h"
+#include "src/http/http_request.h"
+#include "src/pool/sqlconnRAll.h"
+#include "src/store/mysql_user_store.h"
+
+static void testCache() {
+    UserCache::Options options;
+    options.max_entries = 16;
+    options.negative_ttl_ms = 50;
+    UserCache *cache = UserCache::getInstance();
+    cache->init(options);
+    assert(cache->get("alice").status == UserCache::MISS);
+    assert(cache->lookup("alice", nullptr).status == UserCache::LOAD);
+    cache->fill("alice", true, "pwd");
+    UserCache::Result user = cache->lookup("alice", nullptr);
+    assert(user.status == UserCache::FOUND && user.password == "pwd");
+    // 负缓存比存在的用户先过期
+    assert(cache->lookup("nobody", nullptr).status == UserCache::LOAD);
+    cache->fill("nobody", false, "");
+    assert(cache->get("nobody").status == UserCache::NOT_FOUND);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    assert(cache->get("nobody").status == UserCache::MISS);
+    assert(cache->get("alice").status == UserCache::FOUND);
+    cache->invalidate("alice");
+    assert(cache->get("alice").status == UserCache::MISS);
+    // 每个分片只保留一个条目
+    for (int i = 0; i < 100; ++i) {
+        std::string name = "user" + std::to_string(i);
+        assert(cache->lookup(name, nullptr).status == UserCache::LOAD);
+        cache->fill(name, true, "pwd");
+    }
+    assert(cache->getStats().entries <= 16);
+    printf("cache          PASS\n");
+}
+
+static void testSingleFlight() {
+    UserCache *cache = UserCache::getInstance();
+    cache->init(UserCache::Options());
+    const int threads_num = 8;
+    std::atomic<int> loads{0};
+    std::atomic<int> found{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threads_num; ++i) {
+        threads.emplace_back([&] {
+            std::promise<UserCache::Result> promise;
+            UserCache::Result user = cache->lookup("bob", [&promise](const UserCache::Result &result) {
+                promise.set_value(result);
+            });
+            if (user.status == UserCache::LOAD) {
+                ++loads;
+                // 模拟数据库查询, 其他线程在此期间到达
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                cache->fill("bob", true, "secret");
+                user = {UserCache::FOUND, "secret"};
+            } else if (user.status == UserCache::WAIT) {
+                user = promise.get_future().get();
+            }
+            if (user.status == UserCache::FOUND && user.password == "secret") {
+                ++found;
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    assert(loads == 1 && found == threads_num);
+
+    // 查询期间注册了该用户: 等待者得到查询的结果, 但结果不缓存
+    assert(cache->lookup("carol", nullptr).status == UserCache::LOAD);
+    UserCache::Result waited{UserCache::MISS, ""};
+    assert(cache->lookup("carol", [&waited](const UserCache::Result &r) { waited = r; }).status ==
+           UserCache::WAIT);
+    cache->invalidate("carol");
+    cache->fill("carol", false, "");
+    assert(waited.status == UserCache::NOT_FOUND);
+    assert(cache->get("carol").status == UserCache::MISS);
+
+    // 查询失败
+    assert(cache->lookup("dave", nullptr).status == UserCache::LOAD);
+    assert(cache->lookup("dave", [&waited](const UserCache::Result &r) { waited = r; }).status ==
+           UserCache::WAIT);
+    cache->fail("dave");
+    assert(waited.status == UserCache::ERROR);
+    assert(cache->lookup("dave", nullptr).status == UserCache::LOAD);
+    cache->fail("dave");
+    UserCache::Stats stats = cache->getStats();
+    printf("single flight  PASS %d lookups, misses: %llu, coalesced: %llu\n", threads_num,
+           static_cast<unsigned long long>(stats.misses), static_cast<unsigned long long>(stats.coalesced));
+}
+
+static void testSession() {
+    SessionCache *sessions = SessionCache::getInstance();
+    sessions->init(16);
+    std::string id = sessions->create("alice");
+    assert(id.size() == 32 && id != sessions->create("alice"));
+    assert(sessions->check(id, "alice"));
+    assert(!sessions->check(id, "bob"));
+    assert(!sessions->check("0123456789abcdef0123456789abcdef", "alice"));
+    assert(sessions->makeCookie(id).find("session=" + id + ";") == 0);
+    sessions->remove(id);
+    assert(!sessions->check(id, "alice"));
+    for (int i = 0; i < 100; ++i) {
+        sessions->create("user");
+    }
+    assert(sessions->size() <= 16);
+    // 有效期为0的会话立即过期
+    sessions->init(16, 0);
+    id = sessions->create("alice");
+    assert(!sessions->check(id, "alice"));
+    printf("session        PASS\n");
+}
+
+// 解析登录或注册请求
+static bool parseForm(HttpRequest &request, const char *path, const std::string &name, const std::string &pwd,
+                      const std::string &cookie = "") {
+    std::string body = "username=" + name + "&password=" + pwd;
+    Buffer buffer;
+    buffer.append("POST " + std::string(path) + " HTTP/1.1\r\n");
+    buffer.append("Content-Type: application/x-www-form-urlencoded\r\n");
+    if (!cookie.empty()) {
+        buffer.append("Cookie: theme=dark; " + cookie + "\r\n");
+    }
+    buffer.append("Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body);
+    return request.parse(buffer);
+}
+
+static void testLogin(StandInServer &server) {
+    UserCache::getInstance()->init(UserCache::Options());
+    SessionCache::getInstance()->init(16);
+    // 注册前查询过的用户名在负缓存中, 注册后失效
+    HttpRequest request;
+    assert(parseForm(request, "/login", "erin", "pwd"));
+    request.verify();
+    assert(request.path() == "/error.html");
+    assert(UserCache::getInstance()->get("erin").status == UserCache::NOT_FOUND);
+    request.init();
+    assert(parseForm(request, "/register", "erin", "pwd") && request.needVerify());
+    request.verify();
+    assert(request.path() == "/welcome.html" && !request.getNewSession().empty());
+    assert(UserCache::getInstance()->get("erin").status == UserCache::MISS);
+
+    // 并发登录同一个用户只查询一次
+    const int threads_num = 8;
+    int queries = server.queries();
+    std::atomic<int> welcome{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threads_num; ++i) {
+        threads.emplace_back([&welcome] {
+            HttpRequest login;
+            assert(parseForm(login, "/login", "erin", "pwd") && login.needVerify());
+            login.verify();
+            if (login.path() == "/welcome.html") {
+                ++welcome;
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    assert(welcome == threads_num);
+    assert(server.queries() == queries + 1);
+
+    // 命中缓存时在解析线程中完成, 密码错误也不查询数据库
+    request.init();
+    assert(parseForm(request, "/login", "erin", "pwd") && request.tryVerify());
+    assert(request.path() == "/welcome.html");
+    std::string session = request.getNewSession();
+    request.init();
+    assert(parseForm(request, "/login", "erin", "wrong") && request.tryVerify());
+    assert(request.path() == "/error.html");
+    assert(server.queries() == queries + 1);
+
+    // 带着会话的登录不再验证, 缓存清空后也一样; 会话不属于该用户时仍然验证
+    UserCache::getInstance()->clear();
+    request.init();
+    assert(parseForm(request, "/login", "erin", "", std::string(SessionCache::COOKIE_NAME) + "=" + session));
+    assert(request.getCookie("theme") == "dark");
+    assert(request.tryVerify() && request.path() == "/welcome.html" && request.getNewSession().empty());
+    request.init();
+    assert(parseForm(request, "/login", "frank", "pwd", std::string(SessionCache::COOKIE_NAME) + "=" + session));
+    assert(!request.tryVerify());
+    assert(server.queries() == queries + 1);
+    printf("login          PASS %d concurrent logins, 1 query\n", threads_num);
+}
+
+int main() {
+    testCache();
+    testSingleFlight();
+    testSession();
+
+    StandInServer server(20);
+    int port = server.start(0);
+    assert(port > 0);
+    SQLConnPool::getInstance()->initConnPool("127.0.0.1", port, "root", "root", "webserver", 4);
+    UserStore::setInstance(std::make_unique<MySQLUserStore>());
+    {
+        MYSQL *sql = SQLConnPool::getInstance()->getConn(100);
+        if (sql == nullptr) {
+            printf("can not connect to the stand-in server, SKIP login\n");
+            return 0;
+        }
+        SQLConnPool::getInstance()->freeConn(sql);
+    }
+    testLogin(server);
+    SQLConnPool::getInstance()->closeConnPool();
+    server.stop();
+    return 0;
+}
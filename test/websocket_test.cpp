@@ -0,0 +1,118 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+// WebSocket帧解析测试: 分片消息的拼接, 超长消息, 以及伪造的64位长度
+// (最高位为1, 或者接近2^64使长度相加溢出)不能让服务器崩溃, 只能得到CLOSE帧;
+// 不读取的客户端排队的帧超过上限时, 队列被丢弃, 只发送1008关闭
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+#include "src/http/websocket.h"
+
+static std::string received;
+
+// 客户端帧, 掩码为0, 载荷不变; len为声明的长度, 实际载荷可以更短
+static std::string clientFrame(uint8_t opcode, bool fin, uint64_t len, const std::string &payload) {
+    std::string frame;
+    frame += static_cast<char>((fin ? 0x80 : 0) | opcode);
+    if (len < 126) {
+        frame += static_cast<char>(0x80 | len);
+    } else if (len <= 0xffff) {
+        frame += static_cast<char>(0x80 | 126);
+        frame += static_cast<char>(len >> 8);
+        frame += static_cast<char>(len & 0xff);
+    } else {
+        frame += static_cast<char>(0x80 | 127);
+        for (int i = 7; i >= 0; --i) {
+            frame += static_cast<char>((len >> (i * 8)) & 0xff);
+        }
+    }
+    frame.append(4, '\0');
+    return frame + payload;
+}
+
+// 返回out中CLOSE帧的关闭码, 没有CLOSE帧返回0
+static int closeCode(Buffer &out) {
+    std::string data = out.retrieveAllAsString();
+    if (data.size() < 4 || static_cast<uint8_t>(data[0]) != (0x80 | WebSocket::CLOSE)) {
+        return 0;
+    }
+    return (static_cast<uint8_t>(data[2]) << 8) | static_cast<uint8_t>(data[3]);
+}
+
+static void testFragment() {
+    WebSocket ws(-1, "/");
+    Buffer in, out;
+    received.clear();
+    in.append(clientFrame(WebSocket::TEXT, false, 3, "abc"));
+    in.append(clientFrame(WebSocket::CONTINUATION, true, 3, "def"));
+    ws.onRead(in, out);
+    assert(received == "abcdef");
+    assert(in.readableBytes() == 0 && out.readableBytes() == 0);
+    printf("fragment       PASS\n");
+}
+
+static void testOversize() {
+    WebSocket ws(-1, "/");
+    Buffer in, out;
+    in.append(clientFrame(WebSocket::BINARY, true, WebSocket::MAX_MESSAGE_SIZE + 1, ""));
+    ws.onRead(in, out);
+    assert(closeCode(out) == 1009 && ws.isClosed());
+    printf("oversize       PASS\n");
+}
+
+static void testBogusLength() {
+    // 64位长度的最高位为1
+    {
+        WebSocket ws(-1, "/");
+        Buffer in, out;
+        in.append(clientFrame(WebSocket::BINARY, true, UINT64_MAX, ""));
+        ws.onRead(in, out);
+        assert(closeCode(out) == 1002 && ws.isClosed());
+    }
+    // 分片消息之后, 长度与已收到的内容或帧头相加会溢出
+    const uint64_t lens[] = {UINT64_MAX, UINT64_MAX - 2, (1ull << 63) - 1};
+    for (uint64_t len : lens) {
+        WebSocket ws(-1, "/");
+        Buffer in, out;
+        in.append(clientFrame(WebSocket::TEXT, false, 3, "abc"));
+        in.append(clientFrame(WebSocket::CONTINUATION, true, len, "x"));
+        ws.onRead(in, out);
+        int code = closeCode(out);
+        assert((code == 1002 || code == 1009) && ws.isClosed());
+    }
+    printf("bogus length   PASS\n");
+}
+
+static void testQueueLimit() {
+    WebSocket ws(-1, "/");
+    std::string message(256 * 1024, 'x');
+    size_t accepted = 0;
+    while (!ws.isClosed()) {
+        ws.send(message);
+        ++accepted;
+        assert(accepted <= WebSocket::MAX_QUEUED_BYTES / message.size() + 1);
+    }
+    assert(accepted == WebSocket::MAX_QUEUED_BYTES / message.size());
+    // 关闭后不再接受新的帧
+    ws.send(message);
+    WebSocket::Frame frame = ws.nextFrame();
+    assert(frame && ws.nextFrame() == nullptr);
+    Buffer out;
+    out.append(*frame);
+    assert(closeCode(out) == 1008);
+    printf("queue limit    PASS\n");
+}
+
+int main() {
+    WebSocket::handler = [](WebSocket *, const std::string &message, bool) {
+        received = message;
+    };
+    testFragment();
+    testOversize();
+    testBogusLength();
+    testQueueLimit();
+    return 0;
+}
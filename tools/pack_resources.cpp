@@ -0,0 +1,176 @@
+//
+// Created by 86183 on 2026/10/19.
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cache/asset_bundle.h"
+#include "cache/fd_cache.h"
+#include "cache/file_cache.h"
+#include "http/http_response.h"
+
+namespace {
+struct PackFile {
+    std::string content;
+    struct stat file_stat;
+};
+
+bool readFile(const std::string &path, PackFile &file) {
+    int fd = ::open(path.data(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    if (fstat(fd, &file.file_stat) < 0) {
+        ::close(fd);
+        return false;
+    }
+    file.content.resize(file.file_stat.st_size);
+    size_t total = 0;
+    while (total < file.content.size()) {
+        ssize_t len = read(fd, file.content.data() + total, file.content.size() - total);
+        if (len <= 0) {
+            if (len < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        total += len;
+    }
+    ::close(fd);
+    return total == file.content.size();
+}
+
+// 递归收集目录中的普通文件, 键是相对资源目录的路径(以'/'开头)
+bool collect(const std::string &dir, const std::string &prefix, std::map<std::string, PackFile> &files) {
+    DIR *dp = opendir(dir.data());
+    if (dp == nullptr) {
+        fprintf(stderr, "opendir %s error: %s\n", dir.data(), strerror(errno));
+        return false;
+    }
+    bool ok = true;
+    while (struct dirent *ent = readdir(dp)) {
+        std::string name = ent->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        struct stat st = {};
+        if (stat((dir + name).data(), &st) < 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            ok = collect(dir + name + "/", prefix + name + "/", files) && ok;
+        } else if (S_ISREG(st.st_mode)) {
+            PackFile &file = files[prefix + name];
+            if (!readFile(dir + name, file)) {
+                fprintf(stderr, "read %s%s error: %s\n", dir.data(), name.data(), strerror(errno));
+                ok = false;
+            }
+        }
+    }
+    closedir(dp);
+    return ok;
+}
+
+bool writeAll(FILE *fp, const void *data, size_t len) {
+    return len == 0 || fwrite(data, 1, len, fp) == len;
+}
+
+size_t alignUp(size_t offset) {
+    return (offset + AssetBundle::ALIGN - 1) / AssetBundle::ALIGN * AssetBundle::ALIGN;
+}
+
+// 打包资源目录中的所有普通文件, 格式见AssetBundle
+// 可压缩的文本文件额外生成.gz版本, 已有.gz文件或压缩后不变小时不生成
+bool pack(const std::string &dir, const std::string &out) {
+    std::map<std::string, PackFile> files; // 有序, 索引按路径排序
+    if (!collect(FdCache::normalize(dir + "/"), "/", files)) {
+        return false;
+    }
+    // 已有预压缩文件时使用已有的, 否则生成.gz版本, 修改时间和原文件相同
+    // 和服务器使用同样的规则决定哪些文件生成.gz版本
+    std::map<std::string, PackFile> variants;
+    for (const auto &[path, file]: files) {
+        if (!HttpResponse::isCompressible(path) || files.count(path + ".gz")) {
+            continue;
+        }
+        PackFile variant;
+        if (FileCache::gzip(file.content, variant.content)) {
+            variant.file_stat = file.file_stat;
+            variant.file_stat.st_size = variant.content.size();
+            variants.emplace(path + ".gz", std::move(variant));
+        }
+    }
+    size_t compressed = variants.size();
+    files.merge(variants);
+
+    // 先写到临时文件, 完成后改名, 运行中的服务器不会读到写了一半的资源包
+    std::string tmp = out + ".tmp";
+    FILE *fp = fopen(tmp.data(), "wb");
+    if (fp == nullptr) {
+        fprintf(stderr, "open %s error: %s\n", tmp.data(), strerror(errno));
+        return false;
+    }
+    std::vector<AssetBundle::Index> indexes;
+    std::string paths;
+    static const char PADDING[AssetBundle::ALIGN] = {};
+    size_t offset = sizeof(AssetBundle::Header);
+    bool ok = fseek(fp, offset, SEEK_SET) == 0;
+    for (const auto &[path, file]: files) {
+        AssetBundle::Index index = {};
+        index.data_offset = offset;
+        index.size = file.content.size();
+        index.mtime_sec = file.file_stat.st_mtim.tv_sec;
+        index.mtime_nsec = file.file_stat.st_mtim.tv_nsec;
+        index.mode = file.file_stat.st_mode;
+        index.path_offset = paths.size();
+        index.path_len = path.size();
+        paths += path;
+        indexes.push_back(index);
+        size_t next = alignUp(offset + file.content.size());
+        ok = ok && writeAll(fp, file.content.data(), file.content.size()) &&
+             writeAll(fp, PADDING, next - offset - file.content.size());
+        offset = next;
+    }
+    AssetBundle::Header header = {};
+    memcpy(header.magic, AssetBundle::MAGIC, sizeof(AssetBundle::MAGIC));
+    header.version = AssetBundle::VERSION;
+    header.count = indexes.size();
+    header.index_offset = offset;
+    size_t paths_offset = offset + indexes.size() * sizeof(AssetBundle::Index);
+    for (AssetBundle::Index &index: indexes) {
+        index.path_offset += paths_offset;
+    }
+    header.total_size = paths_offset + paths.size();
+    ok = ok && writeAll(fp, indexes.data(), indexes.size() * sizeof(AssetBundle::Index)) &&
+         writeAll(fp, paths.data(), paths.size()) && fseek(fp, 0, SEEK_SET) == 0 &&
+         writeAll(fp, &header, sizeof(header));
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || rename(tmp.data(), out.data()) < 0) {
+        fprintf(stderr, "write %s error: %s\n", out.data(), strerror(errno));
+        unlink(tmp.data());
+        return false;
+    }
+    printf("packed %zu files (%zu compressed) into %s, %zu bytes\n", indexes.size(), compressed,
+           out.data(), static_cast<size_t>(header.total_size));
+    return true;
+}
+} // namespace
+
+// 把资源目录打包成一个资源包, 服务器启动时通过WebServer的asset_bundle参数加载
+// 用法: pack_resources <资源目录> <输出文件>
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <resources dir> <output bundle>\n", argv[0]);
+        return 1;
+    }
+    return pack(argv[1], argv[2]) ? 0 : 1;
+}